@@ -0,0 +1,304 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_avx2.cpp Implementation of the AVX2 32 bpp blitter. */
+
+#include "../stdafx.h"
+#include "32bpp_avx2.hpp"
+
+#ifdef WITH_AVX2
+
+#include "../zoom_func.h"
+#include "../settings_type.h"
+
+#include <immintrin.h>
+
+#include "../safeguards.h"
+
+/*
+ * GCC and Clang only compile the AVX2 intrinsics in functions targeting AVX2.
+ * Only the functions of this blitter are compiled for AVX2, so the inline
+ * functions from the headers stay usable on CPUs without AVX2.
+ */
+#if defined(__GNUC__)
+#	define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#	define AVX2_TARGET
+#endif
+
+/** Instantiation of the AVX2 32bpp blitter factory. */
+static FBlitter_32bppAVX2 iFBlitter_32bppAVX2;
+
+/* Per 128 bits lane control masks to spread the brightness of 2 map values over the channels of 2 pixels. */
+#define BRIGHTNESS_AB_CONTROL_MASK _mm256_setr_epi8( 1, -1,  1, -1,  1, -1,  0, -1,  3, -1,  3, -1,  3, -1,  2, -1,  9, -1,  9, -1,  9, -1,  8, -1, 11, -1, 11, -1, 11, -1, 10, -1)
+#define BRIGHTNESS_CD_CONTROL_MASK _mm256_setr_epi8( 5, -1,  5, -1,  5, -1,  4, -1,  7, -1,  7, -1,  7, -1,  6, -1, 13, -1, 13, -1, 13, -1, 12, -1, 15, -1, 15, -1, 15, -1, 14, -1)
+#define OVERBRIGHT_SUM_CONTROL_MASK _mm_setr_epi8( 0,  1,  0,  1,  0,  1, -1, -1,  8,  9,  8,  9,  8,  9, -1, -1)
+
+/** Copy a 128 bits value into both lanes of a 256 bits value. */
+static inline AVX2_TARGET __m256i BroadcastLanes(const __m128i from)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(from), from, 1);
+}
+
+/**
+ * Get the mask for loading and storing the last pixels of a line.
+ * @param count Number of pixels left, less than 8.
+ * @return All bits set for the 32 bits elements that are within the line.
+ */
+static inline AVX2_TARGET __m256i TailMask(uint count)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/**
+ * Blend 4 pixels, expanded to 16 bits per channel, with alpha.
+ * Only the low byte of each channel of the result is valid.
+ */
+static inline AVX2_TARGET __m256i AlphaBlendFourPixels(__m256i srcAB, const __m256i dstAB, const __m256i &distribution_mask)
+{
+	__m256i alphaAB = _mm256_cmpgt_epi16(srcAB, _mm256_setzero_si256()); // if (alpha > 0) a++;
+	alphaAB = _mm256_srli_epi16(alphaAB, 15);
+	alphaAB = _mm256_add_epi16(alphaAB, srcAB);
+	alphaAB = _mm256_shuffle_epi8(alphaAB, distribution_mask);
+
+	srcAB = _mm256_sub_epi16(srcAB, dstAB);     //   (r - Cr)
+	srcAB = _mm256_mullo_epi16(srcAB, alphaAB); // a*(r - Cr)
+	srcAB = _mm256_srli_epi16(srcAB, 8);        // a*(r - Cr)/256
+	return _mm256_add_epi16(srcAB, dstAB);      // a*(r - Cr)/256 + Cr
+}
+
+static inline AVX2_TARGET __m256i AlphaBlendEightPixels(const __m256i src, const __m256i dst, const __m256i &distribution_mask, const __m256i &clear_hi)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i AB = AlphaBlendFourPixels(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero), distribution_mask);
+	__m256i CD = AlphaBlendFourPixels(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero), distribution_mask);
+	return _mm256_packus_epi16(_mm256_and_si256(AB, clear_hi), _mm256_and_si256(CD, clear_hi));
+}
+
+/* Darken 8 pixels.
+ * rgb = rgb * ((256/4) * 4 - (alpha/4)) / ((256/4) * 4)
+ */
+static inline AVX2_TARGET __m256i DarkenEightPixels(const __m256i src, const __m256i dst, const __m256i &distribution_mask, const __m256i &tr_nom_base)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i alphaAB = _mm256_srli_epi16(_mm256_shuffle_epi8(_mm256_unpacklo_epi8(src, zero), distribution_mask), 2);
+	__m256i alphaCD = _mm256_srli_epi16(_mm256_shuffle_epi8(_mm256_unpackhi_epi8(src, zero), distribution_mask), 2);
+	__m256i dstAB = _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), _mm256_sub_epi16(tr_nom_base, alphaAB));
+	__m256i dstCD = _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), _mm256_sub_epi16(tr_nom_base, alphaCD));
+	return _mm256_packus_epi16(_mm256_srli_epi16(dstAB, 8), _mm256_srli_epi16(dstCD, 8));
+}
+
+/**
+ * Adjust the brightness of 4 pixels, expanded to 16 bits per channel.
+ * Same dataflow as AdjustBrightnessOfTwoPixels() of the SSE blitters, only
+ * the overbright is summed per pixel without horizontal adds.
+ */
+static inline AVX2_TARGET __m256i AdjustBrightnessOfFourPixels(__m256i colAB, const __m256i briAB)
+{
+	colAB = _mm256_mullo_epi16(colAB, briAB);
+	__m256i colAB_ob = _mm256_srli_epi16(colAB, 8 + 7);
+	colAB = _mm256_srli_epi16(colAB, 7);
+
+	/* Sum overbright.
+	 * Maximum for each rgb is 508 => 9 bits. The highest bit tells if there is overbright.
+	 * -255 is changed in -256 so we just have to take the 8 lower bits into account.
+	 */
+	const __m256i ob_value = BroadcastLanes(OVERBRIGHT_VALUE_MASK);
+	colAB = _mm256_and_si256(colAB, BroadcastLanes(BRIGHTNESS_DIV_CLEANER));
+	colAB_ob = _mm256_and_si256(colAB_ob, BroadcastLanes(OVERBRIGHT_PRESENCE_MASK));
+	colAB_ob = _mm256_mullo_epi16(colAB_ob, ob_value);
+	colAB_ob = _mm256_and_si256(colAB_ob, colAB);
+	__m256i obAB = _mm256_add_epi16(colAB_ob, _mm256_srli_epi64(colAB_ob, 16));
+	obAB = _mm256_add_epi16(obAB, _mm256_srli_epi64(obAB, 32));
+
+	obAB = _mm256_srli_epi16(obAB, 1);      // Reduce overbright strength.
+	obAB = _mm256_shuffle_epi8(obAB, BroadcastLanes(OVERBRIGHT_SUM_CONTROL_MASK));
+	__m256i retAB = _mm256_subs_epu16(ob_value, colAB); //    (255 - rgb)
+	retAB = _mm256_mullo_epi16(retAB, obAB);            // ob*(255 - rgb)
+	retAB = _mm256_srli_epi16(retAB, 8);                // ob*(255 - rgb)/256
+	return _mm256_add_epi16(retAB, colAB);              // ob*(255 - rgb)/256 + rgb
+}
+
+/**
+ * Remap the colours of 8 pixels and adjust their brightness.
+ * @param src The pixels to remap.
+ * @param mv The map values of the pixels.
+ * @param remap The remap table.
+ * @return The remapped pixels.
+ */
+static inline AVX2_TARGET __m256i RemapEightPixels(__m256i src, const __m128i mv, const byte *remap)
+{
+	/* Nothing to do when no pixel has a remap colour. */
+	if (_mm_testz_si128(mv, _mm_set1_epi16(0x00FF))) return src;
+
+	ALIGN(32) uint32 colours[8];
+	ALIGN(16) Blitter_32bppSSE_Base::MapValue mvs[8];
+	_mm256_store_si256((__m256i *) colours, src);
+	_mm_store_si128((__m128i *) mvs, mv);
+	for (uint i = 0; i < 8; i++) {
+		const uint m = mvs[i].m;
+		if (m == 0) continue;
+		const uint r = remap[m];
+		colours[i] = r == 0 ? 0 : (Blitter_32bppBase::LookupColourInPalette(r).data & 0x00FFFFFF) | (colours[i] & 0xFF000000);
+	}
+	src = _mm256_load_si256((const __m256i *) colours);
+
+	/* Only adjust the brightness when it is not the default one for all pixels. */
+	const __m128i v = _mm_and_si128(mv, _mm_set1_epi16((short)0xFF00));
+	const __m128i default_v = _mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS << 8);
+	if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, default_v)) == 0xFFFF) return src;
+
+	/* Keep alpha by multiplying it with DEFAULT_BRIGHTNESS, which is compensated by the division. */
+	const __m256i bri = BroadcastLanes(_mm_or_si128(v, _mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS)));
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i colAB = AdjustBrightnessOfFourPixels(_mm256_unpacklo_epi8(src, zero), _mm256_shuffle_epi8(bri, BRIGHTNESS_AB_CONTROL_MASK));
+	__m256i colCD = AdjustBrightnessOfFourPixels(_mm256_unpackhi_epi8(src, zero), _mm256_shuffle_epi8(bri, BRIGHTNESS_CD_CONTROL_MASK));
+	return _mm256_packus_epi16(colAB, colCD);
+}
+
+/**
+ * Draws a sprite to a (screen) buffer. It is templated to allow faster operation.
+ * Lines are drawn 8 pixels at a time; the last pixels of a line use masked loads and stores.
+ *
+ * @tparam mode blitter mode
+ * @param bp further blitting parameters
+ * @param zoom zoom level at which we are drawing
+ */
+template <BlitterMode mode, Blitter_32bppSSE_Base::ReadMode read_mode, bool translucent>
+inline AVX2_TARGET void Blitter_32bppAVX2::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
+{
+	const byte * const remap = bp->remap;
+	Colour *dst_line = (Colour *) bp->dst + bp->top * bp->pitch + bp->left;
+	int effective_width = bp->width;
+
+	/* Find where to start reading in the source sprite. */
+	const SpriteData * const sd = (const SpriteData *) bp->sprite;
+	const SpriteInfo * const si = &sd->infos[zoom];
+	const MapValue *src_mv_line = (const MapValue *) &sd->data[si->mv_offset] + bp->skip_top * si->sprite_width;
+	const Colour *src_rgba_line = (const Colour *) ((const byte *) &sd->data[si->sprite_offset] + bp->skip_top * si->sprite_line_size);
+
+	if (read_mode != RM_WITH_MARGIN) {
+		src_rgba_line += bp->skip_left;
+		src_mv_line += bp->skip_left;
+	}
+
+	/* Load these variables into register before loop. */
+	const __m256i a_cm        = BroadcastLanes(ALPHA_CONTROL_MASK);
+	const __m256i clear_hi    = BroadcastLanes(CLEAR_HIGH_BYTE_MASK);
+	const __m256i tr_nom_base = BroadcastLanes(TRANSPARENT_NOM_BASE);
+	const __m256i alpha_mask  = _mm256_set1_epi32(0xFF000000);
+
+	for (int y = bp->height; y != 0; y--) {
+		Colour *dst = dst_line;
+		const Colour *src = src_rgba_line + META_LENGTH;
+		const MapValue *src_mv = src_mv_line;
+
+		if (read_mode == RM_WITH_MARGIN) {
+			src += src_rgba_line[0].data;
+			dst += src_rgba_line[0].data;
+			if (mode == BM_COLOUR_REMAP) src_mv += src_rgba_line[0].data;
+			const int width_diff = si->sprite_width - bp->width;
+			effective_width = bp->width - (int) src_rgba_line[0].data;
+			const int delta_diff = (int) src_rgba_line[1].data - width_diff;
+			const int new_width = effective_width - delta_diff;
+			effective_width = delta_diff > 0 ? new_width : effective_width;
+			if (effective_width <= 0) goto next_line;
+		}
+
+		for (int x = effective_width; x > 0; x -= 8) {
+			/* Masked loads do not fault on the pixels beyond the end of the line. */
+			const bool tail = x < 8;
+			const __m256i tail_mask = tail ? TailMask(x) : _mm256_set1_epi32(-1);
+			__m256i srcABCD = tail ? _mm256_maskload_epi32((const int *) src, tail_mask) : _mm256_loadu_si256((const __m256i *) src);
+			__m256i dstABCD = tail ? _mm256_maskload_epi32((const int *) dst, tail_mask) : _mm256_loadu_si256((const __m256i *) dst);
+
+			switch (mode) {
+				default:
+					if (!translucent) {
+						/* Only fully transparent and fully opaque pixels. */
+						const __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(srcABCD, alpha_mask), _mm256_setzero_si256());
+						dstABCD = _mm256_blendv_epi8(srcABCD, dstABCD, transparent);
+						break;
+					}
+					dstABCD = AlphaBlendEightPixels(srcABCD, dstABCD, a_cm, clear_hi);
+					break;
+
+				case BM_COLOUR_REMAP: {
+					__m128i mv;
+					if (tail) {
+						ALIGN(16) MapValue mv_tail[8];
+						memset(mv_tail, 0, sizeof(mv_tail));
+						memcpy(mv_tail, src_mv, x * sizeof(MapValue));
+						mv = _mm_load_si128((const __m128i *) mv_tail);
+					} else {
+						mv = _mm_loadu_si128((const __m128i *) src_mv);
+					}
+					srcABCD = RemapEightPixels(srcABCD, mv, remap);
+					dstABCD = AlphaBlendEightPixels(srcABCD, dstABCD, a_cm, clear_hi);
+					src_mv += 8;
+					break;
+				}
+
+				case BM_TRANSPARENT:
+					/* Make the current colour a bit more black, so it looks like this image is transparent. */
+					dstABCD = DarkenEightPixels(srcABCD, dstABCD, a_cm, tr_nom_base);
+					break;
+			}
+
+			if (tail) {
+				_mm256_maskstore_epi32((int *) dst, tail_mask, dstABCD);
+			} else {
+				_mm256_storeu_si256((__m256i *) dst, dstABCD);
+			}
+			src += 8;
+			dst += 8;
+		}
+
+next_line:
+		if (mode == BM_COLOUR_REMAP) src_mv_line += si->sprite_width;
+		src_rgba_line = (const Colour*) ((const byte*) src_rgba_line + si->sprite_line_size);
+		dst_line += bp->pitch;
+	}
+}
+
+/**
+ * Draws a sprite to a (screen) buffer. Calls adequate templated function.
+ *
+ * @param bp further blitting parameters
+ * @param mode blitter mode
+ * @param zoom zoom level at which we are drawing
+ */
+AVX2_TARGET void Blitter_32bppAVX2::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
+{
+	switch (mode) {
+		default: {
+bm_normal:
+			if (bp->skip_left != 0 || bp->width <= MARGIN_NORMAL_THRESHOLD) {
+				Draw<BM_NORMAL, RM_WITH_SKIP, true>(bp, zoom);
+			} else if (((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags & SF_TRANSLUCENT) {
+				Draw<BM_NORMAL, RM_WITH_MARGIN, true>(bp, zoom);
+			} else {
+				Draw<BM_NORMAL, RM_WITH_MARGIN, false>(bp, zoom);
+			}
+			return;
+		}
+		case BM_COLOUR_REMAP:
+			if (((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags & SF_NO_REMAP) goto bm_normal;
+			if (bp->skip_left != 0 || bp->width <= MARGIN_REMAP_THRESHOLD) {
+				Draw<BM_COLOUR_REMAP, RM_WITH_SKIP, true>(bp, zoom); return;
+			} else {
+				Draw<BM_COLOUR_REMAP, RM_WITH_MARGIN, true>(bp, zoom); return;
+			}
+		case BM_TRANSPARENT:  Draw<BM_TRANSPARENT, RM_NONE, true>(bp, zoom); return;
+		case BM_CRASH_REMAP:
+		case BM_BLACK_REMAP:  Blitter_32bppSSE4::Draw(bp, mode, zoom); return;
+	}
+}
+
+#endif /* WITH_AVX2 */
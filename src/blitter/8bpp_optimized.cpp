@@ -147,9 +147,12 @@ Sprite *Blitter_8bppOptimized::Encode(const SpriteLoader::Sprite *sprite, Alloca
 
 	/* Don't allocate memory each time, but just keep some
 	 * memory around as this function is called quite often
-	 * and the memory usage is quite low. */
-	static ReusableBuffer<byte> temp_buffer;
-	SpriteData *temp_dst = (SpriteData *)temp_buffer.Allocate(memory);
+	 * and the memory usage is quite low. Sprites are also
+	 * encoded by the threads prefetching sprites, so each
+	 * thread has its own buffer. */
+	static THREAD_LOCAL ReusableBuffer<byte> *temp_buffer = NULL;
+	if (temp_buffer == NULL) temp_buffer = new ReusableBuffer<byte>();
+	SpriteData *temp_dst = (SpriteData *)temp_buffer->Allocate(memory);
 	memset(temp_dst, 0, sizeof(*temp_dst));
 	byte *dst = temp_dst->data;
 
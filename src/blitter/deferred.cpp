@@ -0,0 +1,240 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file deferred.cpp The blitter that records the drawing of another blitter to do it later on several threads. */
+
+#include "../stdafx.h"
+#include "deferred.hpp"
+#include "../thread/thread.h"
+
+#include "../safeguards.h"
+
+Blitter_Deferred *Blitter_Deferred::active = NULL;
+
+/** Start recording the operations for the current blitter, and replace it. */
+void Blitter_Deferred::Start()
+{
+	assert(this->blitter == NULL);
+	this->previous = active;
+	this->blitter = BlitterFactory::ReplaceCurrentBlitter(this);
+	active = this;
+}
+
+/** Draw everything that is recorded, and restore the replaced blitter. */
+void Blitter_Deferred::Stop()
+{
+	this->Flush();
+	BlitterFactory::ReplaceCurrentBlitter(this->blitter);
+	this->blitter = NULL;
+	active = this->previous;
+}
+
+/**
+ * Start a new batch of operations. The operations of the batch must not draw
+ * on pixels the operations of the other batches draw on.
+ */
+void Blitter_Deferred::BeginBatch()
+{
+	Batch *last = this->batches.Length() == 0 ? NULL : this->batches.End() - 1;
+	if (last != NULL && last->first == last->last) return;
+
+	Batch *batch = this->batches.Append();
+	batch->first = this->operations.Length();
+	batch->last = batch->first;
+	batch->serial = false;
+}
+
+/**
+ * Record an operation in the current batch.
+ * @param type The type of the operation.
+ * @param video The destination of the operation.
+ * @return The operation to fill in.
+ */
+Blitter_Deferred::Operation *Blitter_Deferred::Record(OperationType type, void *video)
+{
+	if (this->batches.Length() == 0) this->BeginBatch();
+
+	Operation *op = this->operations.Append();
+	op->type = type;
+	op->video = video;
+	this->batches.End()[-1].last = this->operations.Length();
+	return op;
+}
+
+/**
+ * Draw the operations of a batch with the replaced blitter.
+ * @param batch The batch to draw.
+ */
+void Blitter_Deferred::Replay(const Batch *batch)
+{
+	const Operation *end = this->operations.Get(0) + batch->last;
+	for (const Operation *op = this->operations.Get(0) + batch->first; op != end; op++) {
+		switch (op->type) {
+			case OT_DRAW: {
+				DrawOperation *draw = this->draws.Get(op->x);
+				this->blitter->Draw(&draw->bp, draw->mode, draw->zoom);
+				break;
+			}
+
+			case OT_COLOUR_MAPPING_RECT:
+				this->blitter->DrawColourMappingRect(op->video, op->x, op->y, (PaletteID)op->value);
+				break;
+
+			case OT_SET_PIXEL:
+				this->blitter->SetPixel(op->video, op->x, op->y, (uint8)op->value);
+				break;
+
+			case OT_DRAW_RECT:
+				this->blitter->DrawRect(op->video, op->x, op->y, (uint8)op->value);
+				break;
+
+			case OT_DRAW_LINE: {
+				const LineOperation *line = this->lines.Get(op->x);
+				this->blitter->DrawLine(op->video, line->x, line->y, line->x2, line->y2, line->screen_width, line->screen_height, (uint8)op->value, line->width, line->dash);
+				break;
+			}
+
+			default: NOT_REACHED();
+		}
+	}
+}
+
+/**
+ * Draw the batches that do not need the main thread; for #RunParallel.
+ * @param param The recording blitter.
+ * @param first The first batch to draw.
+ * @param last  One past the last batch to draw.
+ */
+/* static */ void Blitter_Deferred::ReplayBatches(void *param, uint first, uint last)
+{
+	Blitter_Deferred *deferred = (Blitter_Deferred *)param;
+	for (uint i = first; i < last; i++) {
+		const Batch *batch = deferred->batches.Get(i);
+		if (!batch->serial) deferred->Replay(batch);
+	}
+}
+
+/** Draw all recorded operations, the batches in parallel, and forget them. */
+void Blitter_Deferred::Flush()
+{
+	if (this->operations.Length() == 0) {
+		this->batches.Clear();
+		return;
+	}
+
+	RunParallel(&ReplayBatches, this, this->batches.Length(), 1);
+	for (const Batch *batch = this->batches.Begin(); batch != this->batches.End(); batch++) {
+		if (batch->serial) this->Replay(batch);
+	}
+
+	this->operations.Clear();
+	this->draws.Clear();
+	this->lines.Clear();
+	this->batches.Clear();
+}
+
+/**
+ * Draw all operations recorded by the active recording blitter, if any.
+ * Needed before the data used by the recorded operations, e.g. sprites, goes away.
+ */
+/* static */ void Blitter_Deferred::FlushActive()
+{
+	if (active != NULL) active->Flush();
+}
+
+void Blitter_Deferred::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
+{
+	Operation *op = this->Record(OT_DRAW, bp->dst);
+	op->x = this->draws.Length();
+
+	DrawOperation *draw = this->draws.Append();
+	draw->bp = *bp;
+	draw->mode = mode;
+	draw->zoom = zoom;
+}
+
+void Blitter_Deferred::DrawColourMappingRect(void *dst, int width, int height, PaletteID pal)
+{
+	Operation *op = this->Record(OT_COLOUR_MAPPING_RECT, dst);
+	op->x = width;
+	op->y = height;
+	op->value = pal;
+
+	/* The 8bpp blitters get the recolour sprite from the sprite cache. */
+	this->batches.End()[-1].serial = true;
+}
+
+void Blitter_Deferred::SetPixel(void *video, int x, int y, uint8 colour)
+{
+	Operation *op = this->Record(OT_SET_PIXEL, video);
+	op->x = x;
+	op->y = y;
+	op->value = colour;
+}
+
+void Blitter_Deferred::DrawRect(void *video, int width, int height, uint8 colour)
+{
+	Operation *op = this->Record(OT_DRAW_RECT, video);
+	op->x = width;
+	op->y = height;
+	op->value = colour;
+}
+
+void Blitter_Deferred::DrawLine(void *video, int x, int y, int x2, int y2, int screen_width, int screen_height, uint8 colour, int width, int dash)
+{
+	Operation *op = this->Record(OT_DRAW_LINE, video);
+	op->x = this->lines.Length();
+	op->value = colour;
+
+	LineOperation *line = this->lines.Append();
+	line->x = x;
+	line->y = y;
+	line->x2 = x2;
+	line->y2 = y2;
+	line->screen_width = screen_width;
+	line->screen_height = screen_height;
+	line->width = width;
+	line->dash = dash;
+}
+
+void Blitter_Deferred::CopyFromBuffer(void *video, const void *src, int width, int height)
+{
+	this->Flush();
+	this->blitter->CopyFromBuffer(video, src, width, height);
+}
+
+void Blitter_Deferred::CopyToBuffer(const void *video, void *dst, int width, int height)
+{
+	this->Flush();
+	this->blitter->CopyToBuffer(video, dst, width, height);
+}
+
+void Blitter_Deferred::CopyImageToBuffer(const void *video, void *dst, int width, int height, int dst_pitch)
+{
+	this->Flush();
+	this->blitter->CopyImageToBuffer(video, dst, width, height, dst_pitch);
+}
+
+void Blitter_Deferred::ScrollBuffer(void *video, int &left, int &top, int &width, int &height, int scroll_x, int scroll_y)
+{
+	this->Flush();
+	this->blitter->ScrollBuffer(video, left, top, width, height, scroll_x, scroll_y);
+}
+
+void Blitter_Deferred::PaletteAnimate(const Palette &palette)
+{
+	this->Flush();
+	this->blitter->PaletteAnimate(palette);
+}
+
+void Blitter_Deferred::PostResize()
+{
+	this->Flush();
+	this->blitter->PostResize();
+}
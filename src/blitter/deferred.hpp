@@ -0,0 +1,110 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file deferred.hpp The blitter that records the drawing of another blitter to do it later on several threads. */
+
+#ifndef BLITTER_DEFERRED_HPP
+#define BLITTER_DEFERRED_HPP
+
+#include "factory.hpp"
+
+/**
+ * Blitter that records the drawing operations for the current blitter, so
+ * the drawing of disjoint parts of the screen can be done by several threads.
+ * While it records it replaces the current blitter. One instance can record
+ * many times, so the memory for the operations is only allocated once. The operations are
+ * recorded in batches that must not draw on the same pixels; #Flush draws
+ * the batches in parallel. Operations that read from or move the screen
+ * contents flush the recorded operations first.
+ */
+class Blitter_Deferred : public Blitter {
+public:
+	Blitter_Deferred() : blitter(NULL), previous(NULL) {}
+
+	void Start();
+	void Stop();
+	void BeginBatch();
+	void Flush();
+	static void FlushActive();
+
+	/* virtual */ uint8 GetScreenDepth() { return this->blitter->GetScreenDepth(); }
+	/* virtual */ void Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom);
+	/* virtual */ void DrawColourMappingRect(void *dst, int width, int height, PaletteID pal);
+	/* virtual */ Sprite *Encode(const SpriteLoader::Sprite *sprite, AllocatorProc *allocator) { return this->blitter->Encode(sprite, allocator); }
+	/* virtual */ void *MoveTo(void *video, int x, int y) { return this->blitter->MoveTo(video, x, y); }
+	/* virtual */ void SetPixel(void *video, int x, int y, uint8 colour);
+	/* virtual */ void DrawRect(void *video, int width, int height, uint8 colour);
+	/* virtual */ void DrawLine(void *video, int x, int y, int x2, int y2, int screen_width, int screen_height, uint8 colour, int width, int dash);
+	/* virtual */ void CopyFromBuffer(void *video, const void *src, int width, int height);
+	/* virtual */ void CopyToBuffer(const void *video, void *dst, int width, int height);
+	/* virtual */ void CopyImageToBuffer(const void *video, void *dst, int width, int height, int dst_pitch);
+	/* virtual */ void ScrollBuffer(void *video, int &left, int &top, int &width, int &height, int scroll_x, int scroll_y);
+	/* virtual */ int BufferSize(int width, int height) { return this->blitter->BufferSize(width, height); }
+	/* virtual */ void PaletteAnimate(const Palette &palette);
+	/* virtual */ Blitter::PaletteAnimation UsePaletteAnimation() { return this->blitter->UsePaletteAnimation(); }
+	/* virtual */ const char *GetName() { return this->blitter->GetName(); }
+	/* virtual */ int GetBytesPerPixel() { return this->blitter->GetBytesPerPixel(); }
+	/* virtual */ void PostResize();
+
+private:
+	/** Types of the recorded operations. */
+	enum OperationType {
+		OT_DRAW,                ///< #Draw; its parameters are in #draws.
+		OT_COLOUR_MAPPING_RECT, ///< #DrawColourMappingRect.
+		OT_SET_PIXEL,           ///< #SetPixel.
+		OT_DRAW_RECT,           ///< #DrawRect.
+		OT_DRAW_LINE,           ///< #DrawLine; its parameters are in #lines.
+	};
+
+	/** A recorded operation. */
+	struct Operation {
+		OperationType type; ///< The type of the operation.
+		void *video;        ///< The destination of the operation.
+		int x;              ///< Horizontal offset, width, or the index in #draws or #lines.
+		int y;              ///< Vertical offset or height.
+		uint32 value;       ///< Colour or palette.
+	};
+
+	/** Parameters of a recorded #Draw. */
+	struct DrawOperation {
+		Blitter::BlitterParams bp; ///< Parameters of the sprite drawing.
+		BlitterMode mode;          ///< The mode to draw in.
+		ZoomLevel zoom;            ///< The zoom level of the sprite.
+	};
+
+	/** Parameters of a recorded #DrawLine. */
+	struct LineOperation {
+		int x, y, x2, y2;                ///< The end points.
+		int screen_width, screen_height; ///< The size of the area to draw in.
+		int width;                       ///< The width of the line.
+		int dash;                        ///< The length of the dashes, or 0.
+	};
+
+	/** Operations that must not overlap the other batches. */
+	struct Batch {
+		uint first;  ///< The first operation of the batch.
+		uint last;   ///< One past the last operation of the batch.
+		bool serial; ///< The batch reads from the sprite cache, so it must be drawn by the main thread.
+	};
+
+	Blitter *blitter;                        ///< The blitter doing the actual drawing, or \c NULL when not recording.
+	Blitter_Deferred *previous;              ///< The recording blitter that was active before this one.
+	SmallVector<Operation, 256> operations;  ///< The recorded operations.
+	SmallVector<DrawOperation, 64> draws;    ///< Parameters of the recorded sprite drawing.
+	SmallVector<LineOperation, 16> lines;    ///< Parameters of the recorded lines.
+	SmallVector<Batch, 16> batches;          ///< The batches of operations.
+
+	static Blitter_Deferred *active;         ///< The recording blitter that records at the moment.
+
+	Operation *Record(OperationType type, void *video);
+	void Replay(const Batch *batch);
+	static void ReplayBatches(void *param, uint first, uint last);
+};
+
+#endif /* BLITTER_DEFERRED_HPP */
@@ -16,6 +16,7 @@
 #include "../debug.h"
 #include "../string_func.h"
 #include "../core/string_compare_type.hpp"
+#include "../core/smallvec_type.hpp"
 #include <map>
 
 #if defined(WITH_COCOA)
@@ -149,6 +150,32 @@ public:
 		return *GetActiveBlitter();
 	}
 
+	/**
+	 * Let another blitter do the drawing for a while, without selecting it.
+	 * The factory does not take ownership of the blitter, so the replaced
+	 * blitter must be restored before the other blitter is deleted.
+	 * @param blitter The blitter to draw with.
+	 * @return The blitter that was drawing until now.
+	 */
+	static Blitter *ReplaceCurrentBlitter(Blitter *blitter)
+	{
+		Blitter *old = *GetActiveBlitter();
+		*GetActiveBlitter() = blitter;
+		return old;
+	}
+
+	/**
+	 * Get the names of the blitters that are usable on this computer.
+	 * @param[out] names The names, valid as long as the blitter factories exist.
+	 */
+	static void GetBlitterNames(SmallVector<const char *, 16> *names)
+	{
+		Blitters::iterator it = GetBlitters().begin();
+		for (; it != GetBlitters().end(); it++) {
+			*names->Append() = (*it).second->name;
+		}
+	}
+
 	/**
 	 * Fill a buffer with information about the blitters.
 	 * @param p The buffer to fill.
@@ -37,7 +37,12 @@
 #include "newgrf.h"
 #include "console_func.h"
 #include "engine_base.h"
+#include "vehicle_func.h"
 #include "game/game.hpp"
+#include "spritecache.h"
+#include "gfx_func.h"
+#include "blitter/factory.hpp"
+#include "pathfinder/pf_profile.h"
 #include "table/strings.h"
 
 #include "safeguards.h"
@@ -1307,6 +1312,200 @@ DEF_CONSOLE_CMD(ConGetSeed)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConVehicleHash)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show the usage of the hash of vehicles on tiles, and how often it was updated. Usage: 'vehicle_hash'");
+		return true;
+	}
+
+	uint occupied, longest;
+	uint size = GetVehicleTileHashUsage(&occupied, &longest);
+	IConsolePrintF(CC_DEFAULT, "Buckets: %u, occupied: %u, most vehicles in a bucket: %u", size, occupied, longest);
+	IConsolePrintF(CC_DEFAULT, "Position updates: " OTTD_PRINTF64 ", moves to another bucket: " OTTD_PRINTF64, _vehicle_tile_hash_stats.updates, _vehicle_tile_hash_stats.moves);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConSpriteCache)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show the usage of the sprite cache, and how often sprites were found in it. Usage: 'sprite_cache [reset]'");
+		return true;
+	}
+
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset") != 0)) return false;
+	if (argc == 2) {
+		MemSetT(&_sprite_cache_stats, 0);
+		return true;
+	}
+
+	size_t size;
+	size_t used = GetSpriteCacheUsage(&size);
+	uint64 requests = _sprite_cache_stats.hits + _sprite_cache_stats.misses;
+	IConsolePrintF(CC_DEFAULT, "In use: " PRINTF_SIZE " of " PRINTF_SIZE " KiB", used / 1024, size / 1024);
+	IConsolePrintF(CC_DEFAULT, "Hits: " OTTD_PRINTF64 ", misses: " OTTD_PRINTF64 ", hit rate: %u%%", _sprite_cache_stats.hits, _sprite_cache_stats.misses, requests == 0 ? 0 : (uint)(_sprite_cache_stats.hits * 100 / requests));
+	IConsolePrintF(CC_DEFAULT, "Evictions: " OTTD_PRINTF64 ", reclaimed slabs: " OTTD_PRINTF64, _sprite_cache_stats.evictions, _sprite_cache_stats.slab_reclaims);
+	IConsolePrintF(CC_DEFAULT, "Loaded ahead of use: " OTTD_PRINTF64, _sprite_cache_stats.prefetches);
+	return true;
+}
+
+/**
+ * Print the counters of an interval of the pathfinder profiling.
+ * @param title What the interval is.
+ * @param profile The counters of the interval.
+ */
+static void PrintPathfinderProfile(const char *title, const PathfinderProfile *profile)
+{
+	static const char * const vehicle_names[] = { "train", "road vehicle", "ship", "aircraft" };
+	static const char * const pathfinder_names[] = { "OPF", "NPF", "YAPF" };
+	assert_compile(lengthof(vehicle_names) == VEH_COMPANY_END);
+	assert_compile(lengthof(pathfinder_names) == PF_PROFILE_PATHFINDERS);
+
+	YearMonthDay start, end;
+	ConvertDateToYMD(profile->start, &start);
+	ConvertDateToYMD(profile->end, &end);
+	IConsolePrintF(CC_WARNING, "%s, %d-%d-%d to %d-%d-%d:", title, start.day, start.month + 1, start.year, end.day, end.month + 1, end.year);
+
+	for (uint type = 0; type < VEH_COMPANY_END; type++) {
+		for (uint pf = 0; pf < PF_PROFILE_PATHFINDERS; pf++) {
+			const PathfinderStats &stats = profile->totals[type][pf];
+			if (stats.calls == 0) continue;
+			IConsolePrintF(CC_DEFAULT, "  %s, %s: %u searches, %u cached, %u aborted, " OTTD_PRINTF64 " nodes, " OTTD_PRINTF64 " ms",
+					vehicle_names[type], pathfinder_names[pf], stats.calls, stats.cache_hits, stats.aborts, stats.nodes, stats.time / 1000);
+		}
+	}
+
+	const PathfinderProfile::VehicleMap::value_type *worst[PF_PROFILE_WORST_VEHICLES];
+	uint count = profile->GetWorstVehicles(worst, lengthof(worst));
+	for (uint i = 0; i < count; i++) {
+		const PathfinderVehicleStats &stats = worst[i]->second;
+		IConsolePrintF(CC_DEFAULT, "  %s %u of company %u (vehicle %u): %u searches, %u aborted, " OTTD_PRINTF64 " nodes, " OTTD_PRINTF64 " ms",
+				vehicle_names[stats.type], stats.unitnumber, stats.owner + 1, worst[i]->first, stats.calls, stats.aborts, stats.nodes, stats.time / 1000);
+	}
+}
+
+DEF_CONSOLE_CMD(ConPathfinderProfile)
+{
+	if (argc == 0) {
+		IConsoleHelp("Count the searches of the pathfinders by vehicle type and pathfinder, and find the vehicles expanding the most nodes. Usage: 'pf_profile [start [<days>] | stop]'");
+		IConsoleHelp("  'start' starts counting, in intervals of the given number of days (default 30)");
+		IConsoleHelp("  'stop' finishes the running interval early");
+		IConsoleHelp("  Without parameters the last finished and the running interval are shown");
+		return true;
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "start") == 0) {
+		uint days = 30;
+		if (argc > 3 || (argc == 3 && (!GetArgumentInteger(&days, argv[2]) || days == 0))) return false;
+		StartPathfinderProfiling(days);
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+		StopPathfinderProfiling();
+		return true;
+	}
+
+	if (argc != 1) return false;
+
+	if (_pf_profiling.has_last) PrintPathfinderProfile("Last interval", &_pf_profiling.last);
+	if (_pf_profiling.enabled) {
+		PrintPathfinderProfile("Running interval", &_pf_profiling.current);
+	} else if (!_pf_profiling.has_last) {
+		IConsolePrint(CC_DEFAULT, "The pathfinders are not being profiled; use 'pf_profile start' to start.");
+	}
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkMap)
+{
+	if (argc == 0) {
+		IConsoleHelp("Measure the speed of accessing the map arrays in the patterns of the tile loop, viewport, pathfinders and catchment searches. Usage: 'benchmark_map [<repeats>]'");
+		return true;
+	}
+
+	uint repeats = 1;
+	if (argc > 2 || (argc == 2 && !GetArgumentInteger(&repeats, argv[1]))) return false;
+
+	static const char * const names[] = { "tile loop", "viewport", "pathfinder", "catchment" };
+	assert_compile(lengthof(names) == MB_END);
+
+	uint64 time[MB_END];
+	uint32 checksum;
+	BenchmarkMapAccess(max(repeats, 1U), time, &checksum);
+
+#if defined(WITH_TILED_MAP)
+	IConsolePrintF(CC_DEFAULT, "Map of %ux%u tiles, stored in blocks of %ux%u tiles:", MapSizeX(), MapSizeY(), MAP_BLOCK_SIZE, MAP_BLOCK_SIZE);
+#else
+	IConsolePrintF(CC_DEFAULT, "Map of %ux%u tiles, stored row after row:", MapSizeX(), MapSizeY());
+#endif
+	for (uint i = 0; i < MB_END; i++) {
+		IConsolePrintF(CC_DEFAULT, "  %-10s " OTTD_PRINTF64 " us", names[i], time[i]);
+	}
+	IConsolePrintF(CC_DEFAULT, "Checksum: %08x", checksum);
+	return true;
+}
+
+/**
+ * Print the results of #BenchmarkBlitter for one blitter.
+ * @param name Name of the blitter.
+ * @param sprites Number of sprites to take from the loaded graphics.
+ */
+static void PrintBlitterBenchmark(const char *name, uint sprites)
+{
+	static const char * const names[] = { "draw normal", "draw remap", "draw transparent", "colour mapping", "scroll", "palette animate" };
+	assert_compile(lengthof(names) == BB_END);
+
+	double ns_per_pixel[BB_END][ZOOM_LVL_COUNT];
+	uint sprite_count;
+	if (!BenchmarkBlitter(name, sprites, ns_per_pixel, &sprite_count)) {
+		IConsolePrintF(CC_ERROR, "Unknown blitter '%s'.", name);
+		return;
+	}
+
+	IConsolePrintF(CC_DEFAULT, "%s, %u sprites, ns/pixel:", name, sprite_count);
+	char buf[256];
+	char *p = buf + seprintf(buf, lastof(buf), "  %-18s", "zoom level");
+	for (ZoomLevel zoom = ZOOM_LVL_BEGIN; zoom != ZOOM_LVL_END; zoom++) p += seprintf(p, lastof(buf), " %7d", zoom);
+	IConsolePrint(CC_DEFAULT, buf);
+	for (uint i = 0; i < BB_END; i++) {
+		p = buf + seprintf(buf, lastof(buf), "  %-18s", names[i]);
+		for (ZoomLevel zoom = ZOOM_LVL_BEGIN; zoom != ZOOM_LVL_END; zoom++) {
+			if (ns_per_pixel[i][zoom] < 0) {
+				p += seprintf(p, lastof(buf), " %7s", "-");
+			} else {
+				p += seprintf(p, lastof(buf), " %7.3f", ns_per_pixel[i][zoom]);
+			}
+		}
+		IConsolePrint(CC_DEFAULT, buf);
+	}
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkBlitter)
+{
+	if (argc == 0) {
+		IConsoleHelp("Measure the speed of the blitters on sprites of the loaded graphics, drawn into an off-screen buffer. Usage: 'benchmark_blitter [<blitter> [<sprites>]]'");
+		IConsoleHelp("Without a blitter all usable blitters are measured. By default 1000 sprites are used.");
+		return true;
+	}
+
+	uint sprites = 1000;
+	if (argc > 3 || (argc == 3 && !GetArgumentInteger(&sprites, argv[2]))) return false;
+	sprites = max(sprites, 1U);
+
+	if (argc >= 2) {
+		PrintBlitterBenchmark(argv[1], sprites);
+		return true;
+	}
+
+	SmallVector<const char *, 16> names;
+	BlitterFactory::GetBlitterNames(&names);
+	for (uint i = 0; i < names.Length(); i++) {
+		PrintBlitterBenchmark(names[i], sprites);
+	}
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConGetDate)
 {
 	if (argc == 0) {
@@ -1910,6 +2109,11 @@ void IConsoleStdLibRegister()
 	IConsoleCmdRegister("restart",      ConRestart);
 	IConsoleCmdRegister("getseed",      ConGetSeed);
 	IConsoleCmdRegister("getdate",      ConGetDate);
+	IConsoleCmdRegister("vehicle_hash", ConVehicleHash);
+	IConsoleCmdRegister("benchmark_map", ConBenchmarkMap);
+	IConsoleCmdRegister("sprite_cache", ConSpriteCache);
+	IConsoleCmdRegister("pf_profile",   ConPathfinderProfile);
+	IConsoleCmdRegister("benchmark_blitter", ConBenchmarkBlitter);
 	IConsoleCmdRegister("quit",         ConExit);
 	IConsoleCmdRegister("resetengines", ConResetEngines, ConHookNoNetwork);
 	IConsoleCmdRegister("reset_enginepool", ConResetEnginePool, ConHookNoNetwork);
@@ -12,6 +12,14 @@
 #include "stdafx.h"
 #include "core/bitmath_func.hpp"
 
+#if defined(WIN32)
+#include <windows.h>
+#elif defined(PSVITA)
+#include <psp2/kernel/processmgr.h>
+#else
+#include <sys/time.h>
+#endif
+
 #include "safeguards.h"
 
 #undef RDTSC_AVAILABLE
@@ -78,6 +86,32 @@ uint64 ottd_rdtsc()
 uint64 ottd_rdtsc() {return 0;}
 #endif
 
+/* A clock in microseconds, from the timer of the OS. */
+#if defined(WIN32)
+uint64 GetMicroseconds()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	/* Split the conversion, so multiplying the counter does not overflow. */
+	return (uint64)(counter.QuadPart / frequency.QuadPart) * 1000000 + (uint64)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+#elif defined(PSVITA)
+uint64 GetMicroseconds()
+{
+	return sceKernelGetProcessTimeWide();
+}
+#else
+uint64 GetMicroseconds()
+{
+	struct timeval tim;
+	gettimeofday(&tim, NULL);
+	return (uint64)tim.tv_sec * 1000000 + tim.tv_usec;
+}
+#endif
+
 
 /**
  * Definitions for CPU detection:
@@ -93,7 +127,12 @@ uint64 ottd_rdtsc() {return 0;}
 #if defined(_MSC_VER)
 void ottd_cpuid(int info[4], int type)
 {
+#if _MSC_VER >= 1600
+	__cpuidex(info, type, 0);
+#else
+	/* __cpuidex is only available since VS2010; the sub-leaf is undefined. */
 	__cpuid(info, type);
+#endif
 }
 #elif defined(__x86_64__) || defined(__i386)
 void ottd_cpuid(int info[4], int type)
@@ -113,13 +152,13 @@ void ottd_cpuid(int info[4], int type)
 			/* It is safe to write "=r" for (info[1]) as in case that PIC is enabled for i386,
 			 * the compiler will not choose EBX as target register (but something else).
 			 */
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #else
 	__asm__ __volatile__ (
 			"cpuid           \n\t"
 			: "=a" (info[0]), "=b" (info[1]), "=c" (info[2]), "=d" (info[3])
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #endif /* i386 PIC */
 }
@@ -140,3 +179,34 @@ bool HasCPUIDFlag(uint type, uint index, uint bit)
 	ottd_cpuid(cpu_info, type);
 	return HasBit(cpu_info[index], bit);
 }
+
+/**
+ * Check whether both the CPU and the OS support AVX2. Next to the CPUID flag
+ * the OS must save the upper halves of the YMM registers on context switches,
+ * otherwise the AVX instructions fault.
+ * @return True when AVX2 instructions can be used.
+ */
+bool HasCPUAVX2Support()
+{
+	/* OSXSAVE and AVX. */
+	if (!HasCPUIDFlag(1, 2, 27) || !HasCPUIDFlag(1, 2, 28)) return false;
+
+#if defined(_MSC_VER) && _MSC_VER >= 1700
+	uint64 xcr0 = _xgetbv(0);
+#elif defined(__x86_64__) || defined(__i386)
+	uint32 xcr0_low, xcr0_high;
+	__asm__ __volatile__ ("xgetbv" : "=a" (xcr0_low), "=d" (xcr0_high) : "c" (0));
+	uint64 xcr0 = ((uint64)xcr0_high << 32) | xcr0_low;
+#else
+	uint64 xcr0 = 0;
+#endif
+	/* The OS saves both the XMM and the YMM state. */
+	if ((xcr0 & 0x6) != 0x6) return false;
+
+#if defined(_MSC_VER) && _MSC_VER < 1600
+	/* The AVX2 flag is in sub-leaf 0 of leaf 7, which cannot be queried. */
+	return false;
+#else
+	return HasCPUIDFlag(7, 1, 5);
+#endif
+}
@@ -18,10 +18,19 @@
  */
 uint64 ottd_rdtsc();
 
+/**
+ * Get the time of a clock that counts in microseconds. Unlike #ottd_rdtsc
+ * its rate does not depend on the CPU, and it also works on CPUs without a
+ * tick counter. Only the difference between two times is meaningful.
+ * @return The time in microseconds.
+ */
+uint64 GetMicroseconds();
+
 /**
  * Get the CPUID information from the CPU.
  * @param info The retrieved info. All zeros on architectures without CPUID.
- * @param type The information this instruction should retrieve.
+ * @param type The information this instruction should retrieve; sub-leaf 0 is queried for types that have them,
+ *             except with MSVC before VS2010, where the sub-leaf is undefined.
  */
 void ottd_cpuid(int info[4], int type);
 
@@ -34,4 +43,6 @@ void ottd_cpuid(int info[4], int type);
  */
 bool HasCPUIDFlag(uint type, uint index, uint bit);
 
+bool HasCPUAVX2Support();
+
 #endif /* CPU_H */
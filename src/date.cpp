@@ -20,6 +20,7 @@
 #include "rail_gui.h"
 #include "linkgraph/linkgraph.h"
 #include "saveload/saveload.h"
+#include "pathfinder/pf_profile.h"
 
 #include "safeguards.h"
 
@@ -263,6 +264,7 @@ static void OnNewDay()
 
 	SetWindowWidgetDirty(WC_STATUS_BAR, 0, 0);
 	EnginesDailyLoop();
+	PathfinderProfilingDailyLoop();
 
 	/* Refresh after possible snowline change */
 	SetWindowClassesDirty(WC_TOWN_VIEW);
@@ -51,7 +51,7 @@ struct Fio {
 	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];      ///< array of short names for spriteloader's use
-#if defined(PSVITA)
+#if 1
 	Subdirectory cur_subdirectory;		   ///< current subdirectory
 	Subdirectory subdirectories[MAX_FILE_SLOTS]; ///< subdirectories
 #endif
@@ -162,7 +162,11 @@ extern int closedir(DIR d);
  * @param path string to open directory of
  * @return DIR pointer
  */
+#if defined(PSVITA)
 static inline DIR ttd_opendir(const char *path)
+#else
+static inline DIR *ttd_opendir(const char *path)
+#endif
 {
 	return opendir(OTTD2FS(path));
 }
@@ -34,6 +34,7 @@
 #include "game/game.hpp"
 #include "game/game_instance.hpp"
 #include "string_func.h"
+#include "pathfinder/pf_performance_timer.hpp"
 
 #include "safeguards.h"
 
@@ -60,6 +61,32 @@ GenWorldInfo _gw;
 /** Whether we are generating the map or not. */
 bool _generating_world;
 
+static CPerformanceTimer _gw_phase_time[GWP_CLASS_COUNT]; ///< Time spent in each phase of the last world generation.
+static GenWorldProgress _gw_phase = GWP_CLASS_COUNT;     ///< Phase of the world generation being timed, GWP_CLASS_COUNT if none.
+
+/**
+ * Add the time since the current phase of the world generation started to
+ * that phase, and start timing the next one.
+ * @param cls The phase that starts now, or GWP_CLASS_COUNT when the generation is done.
+ */
+void SetGeneratingWorldPhase(GenWorldProgress cls)
+{
+	if (_gw_phase != GWP_CLASS_COUNT) _gw_phase_time[_gw_phase].Stop();
+	_gw_phase = cls;
+	if (_gw_phase != GWP_CLASS_COUNT) _gw_phase_time[_gw_phase].Start();
+}
+
+/**
+ * Get the time spent in a phase of the last world generation.
+ * @param cls The phase.
+ * @return Time of the phase in microseconds, as measured by #CPerformanceTimer.
+ */
+uint64 GetGeneratingWorldPhaseTime(GenWorldProgress cls)
+{
+	assert(cls < GWP_CLASS_COUNT);
+	return _gw_phase_time[cls].Get(1000000);
+}
+
 /**
  * Tells if the world generation is done in a thread or not.
  * @return the 'threaded' status
@@ -76,6 +103,7 @@ bool IsGenerateWorldThreaded()
 static void CleanupGeneration()
 {
 	_generating_world = false;
+	SetGeneratingWorldPhase(GWP_CLASS_COUNT);
 
 	SetMouseCursorBusy(false);
 	/* Show all vital windows again, because we have hidden them */
@@ -105,6 +133,7 @@ static void _GenerateWorld(void *)
 		/* Set the Random() seed to generation_seed so we produce the same map with the same seed */
 		if (_settings_game.game_creation.generation_seed == GENERATE_NEW_SEED) _settings_game.game_creation.generation_seed = _settings_newgame.game_creation.generation_seed = InteractiveRandom();
 		_random.SetSeed(_settings_game.game_creation.generation_seed);
+		for (uint i = 0; i < GWP_CLASS_COUNT; i++) _gw_phase_time[i] = CPerformanceTimer();
 		SetGeneratingWorldProgress(GWP_MAP_INIT, 2);
 		SetObjectToPlace(SPR_CURSOR_ZZZ, PAL_NONE, HT_NONE, WC_MAIN_WINDOW, 0);
 
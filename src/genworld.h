@@ -90,6 +90,8 @@ void GenerateWorld(GenWorldMode mode, uint size_x, uint size_y, bool reset_setti
 void AbortGeneratingWorld();
 bool IsGeneratingWorldAborted();
 void HandleGeneratingWorldAbortion();
+void SetGeneratingWorldPhase(GenWorldProgress cls);
+uint64 GetGeneratingWorldPhaseTime(GenWorldProgress cls);
 
 /* genworld_gui.cpp */
 void SetNewLandscapeType(byte landscape);
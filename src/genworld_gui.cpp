@@ -1341,6 +1341,7 @@ void SetGeneratingWorldProgress(GenWorldProgress cls, uint total)
 {
 	if (total == 0) return;
 
+	SetGeneratingWorldPhase(cls);
 	_SetGeneratingWorldProgress(cls, 0, total);
 }
 
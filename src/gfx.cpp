@@ -14,6 +14,7 @@
 #include "progress.h"
 #include "zoom_func.h"
 #include "blitter/factory.hpp"
+#include "blitter/deferred.hpp"
 #include "video/video_driver.hpp"
 #include "strings_func.h"
 #include "settings_type.h"
@@ -21,6 +22,7 @@
 #include "network/network_func.h"
 #include "window_func.h"
 #include "newgrf_debug.h"
+#include "thread/thread.h"
 
 #include "table/palettes.h"
 #include "table/string_colours.h"
@@ -68,11 +70,14 @@ ZoomLevelByte _gui_zoom; ///< GUI Zoom level
  */
 static Rect _invalid_rect;
 static const byte *_colour_remap_ptr;
-static byte _string_colourremap[3]; ///< Recoloursprite for stringdrawing. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
+static byte _string_colourremaps[2][256][3]; ///< Recoloursprites for stringdrawing, per shading and colour; they never change, so deferred drawing can use them. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
 
 static const uint DIRTY_BLOCK_HEIGHT   = 8;
 static const uint DIRTY_BLOCK_WIDTH    = 64;
 
+static const uint PARALLEL_REPAINT_TILE_HEIGHT = 32 * DIRTY_BLOCK_HEIGHT; ///< Height of the parts of the screen that are blitted separately with #GUISettings::parallel_repaint.
+static const uint PARALLEL_REPAINT_TILE_WIDTH  =  4 * DIRTY_BLOCK_WIDTH;  ///< Width of the parts of the screen that are blitted separately with #GUISettings::parallel_repaint.
+
 static uint _dirty_bytes_per_line = 0;
 static byte *_dirty_blocks = NULL;
 extern uint _dirty_block_colour;
@@ -320,9 +325,11 @@ static void SetColourRemap(TextColour colour)
 	bool raw_colour = (colour & TC_IS_PALETTE_COLOUR) != 0;
 	colour &= ~(TC_NO_SHADE | TC_IS_PALETTE_COLOUR);
 
-	_string_colourremap[1] = raw_colour ? (byte)colour : _string_colourmap[colour];
-	_string_colourremap[2] = no_shade ? 0 : 1;
-	_colour_remap_ptr = _string_colourremap;
+	byte c = raw_colour ? (byte)colour : _string_colourmap[colour];
+	byte *remap = _string_colourremaps[no_shade ? 0 : 1][c];
+	remap[1] = c;
+	remap[2] = no_shade ? 0 : 1;
+	_colour_remap_ptr = remap;
 }
 
 /**
@@ -474,7 +481,7 @@ static int DrawLayoutLine(const ParagraphLayouter::Line *line, int y, int left,
 	}
 
 	if (underline) {
-		GfxFillRect(left, y + h, right, y + h, _string_colourremap[1]);
+		GfxFillRect(left, y + h, right, y + h, _colour_remap_ptr[1]);
 	}
 
 	return (align & SA_HOR_MASK) == SA_RIGHT ? left : right;
@@ -1336,6 +1343,13 @@ void DrawDirtyBlocks()
 		if (_switch_mode != SM_NONE && !HasModalProgress()) return;
 	}
 
+	/* Record the blitting of the dirty parts of the screen, and let the
+	 * worker threads do it afterwards. Those parts are split in tiles, so
+	 * there are enough parts to divide over the threads. */
+	static Blitter_Deferred deferred;
+	const bool tiled = _settings_client.gui.parallel_repaint && GetWorkerThreadCount() > 1 && BlitterFactory::GetCurrentBlitter()->GetScreenDepth() != 0;
+	if (tiled) deferred.Start();
+
 	y = 0;
 	do {
 		x = 0;
@@ -1353,14 +1367,14 @@ void DrawDirtyBlocks()
 					*p = 0;
 					p += _dirty_bytes_per_line;
 					bottom += DIRTY_BLOCK_HEIGHT;
-				} while (bottom != h && *p != 0);
+				} while (bottom != h && *p != 0 && (!tiled || bottom % PARALLEL_REPAINT_TILE_HEIGHT != 0));
 
 				/* Try coalescing to the right too. */
 				h2 = (bottom - y) / DIRTY_BLOCK_HEIGHT;
 				assert(h2 > 0);
 				p = b;
 
-				while (right != w) {
+				while (right != w && (!tiled || right % PARALLEL_REPAINT_TILE_WIDTH != 0)) {
 					byte *p2 = ++p;
 					int h = h2;
 					/* Check if a full line of dirty flags is set. */
@@ -1391,6 +1405,7 @@ void DrawDirtyBlocks()
 				if (bottom > _invalid_rect.bottom) bottom = _invalid_rect.bottom;
 
 				if (left < right && top < bottom) {
+					if (tiled) deferred.BeginBatch();
 					RedrawScreenRect(left, top, right, bottom);
 				}
 
@@ -1398,6 +1413,9 @@ void DrawDirtyBlocks()
 		} while (b++, (x += DIRTY_BLOCK_WIDTH) != w);
 	} while (b += -(int)(w / DIRTY_BLOCK_WIDTH) + _dirty_bytes_per_line, (y += DIRTY_BLOCK_HEIGHT) != h);
 
+	/* Blit what is recorded, and draw with the normal blitter again. */
+	if (tiled) deferred.Stop();
+
 	++_dirty_block_colour;
 	_invalid_rect.left = w;
 	_invalid_rect.top = h;
@@ -140,6 +140,19 @@ void MarkWholeScreenDirty();
 void GfxInitPalettes();
 void CheckBlitter();
 
+/** Operations of the blitters that are measured by #BenchmarkBlitter. */
+enum BlitterBenchmark {
+	BB_DRAW_NORMAL,      ///< Draw sprites with #BM_NORMAL, per zoom level.
+	BB_DRAW_REMAP,       ///< Draw sprites with #BM_COLOUR_REMAP, per zoom level.
+	BB_DRAW_TRANSPARENT, ///< Draw sprites with #BM_TRANSPARENT, per zoom level.
+	BB_COLOUR_MAPPING,   ///< Darken the buffer with Blitter::DrawColourMappingRect.
+	BB_SCROLL,           ///< Scroll the buffer with Blitter::ScrollBuffer.
+	BB_PALETTE_ANIMATE,  ///< Animate the palette with Blitter::PaletteAnimate.
+	BB_END,              ///< End marker.
+};
+
+bool BenchmarkBlitter(const char *name, uint sprites, double ns_per_pixel[BB_END][ZOOM_LVL_COUNT], uint *sprite_count);
+
 bool FillDrawPixelInfo(DrawPixelInfo *n, int left, int top, int width, int height);
 
 /* window.cpp */
@@ -19,6 +19,10 @@
 #include "blitter/factory.hpp"
 #include "video/video_driver.hpp"
 #include "window_func.h"
+#include "zoom_func.h"
+#include "settings_type.h"
+#include "spritecache.h"
+#include "pathfinder/pf_performance_timer.hpp"
 
 /* The type of set we're replacing */
 #define SET_TYPE "graphics"
@@ -277,6 +281,7 @@ static bool SwitchNewGRFBlitter()
 		uint min_base_depth, max_base_depth, min_grf_depth, max_grf_depth;
 	} replacement_blitters[] = {
 #ifdef WITH_SSE
+		{ "32bpp-avx2",      0, 32, 32,  8, 32 },
 		{ "32bpp-sse4",      0, 32, 32,  8, 32 },
 		{ "32bpp-ssse3",     0, 32, 32,  8, 32 },
 		{ "32bpp-sse2",      0, 32, 32,  8, 32 },
@@ -306,6 +311,8 @@ static bool SwitchNewGRFBlitter()
 		}
 		if (BlitterFactory::GetBlitterFactory(repl_blitter) == NULL) continue;
 
+		/* The sprites being prefetched are encoded for the old blitter, which gets deleted. */
+		CancelSpritePrefetch();
 		DEBUG(misc, 1, "Switching blitter from '%s' to '%s'... ", cur_blitter, repl_blitter);
 		Blitter *new_blitter = BlitterFactory::SelectBlitter(repl_blitter);
 		if (new_blitter == NULL) NOT_REACHED();
@@ -347,6 +354,164 @@ void GfxLoadSprites()
 	UpdateCursorSize();
 }
 
+/** Number of times each operation is repeated by #BenchmarkBlitter. */
+static const uint BLITTER_BENCHMARK_REPEATS = 4;
+
+/** Allocator for the sprites encoded by #BenchmarkBlitter. */
+static void *BenchmarkAllocSprite(size_t size)
+{
+	return MallocT<byte>(size);
+}
+
+/**
+ * Get the time measured by a timer, in nanoseconds. Unlike
+ * CPerformanceTimer::Get this does not overflow after a few seconds.
+ * The timer runs on the microsecond clock of the OS (#GetMicroseconds),
+ * so it means the same on every CPU, including those without a tick
+ * counter; the operations are repeated often enough for its resolution.
+ * @param timer The stopped timer.
+ * @return The measured time.
+ */
+static inline double BenchmarkNanoseconds(CPerformanceTimer &timer)
+{
+	return (double)timer.m_acc * 1000000000 / timer.QueryFrequency();
+}
+
+/**
+ * Measure the speed of a blitter on sprites of the loaded graphics. The
+ * sprites are encoded by the blitter itself and drawn into an off-screen
+ * buffer of the size of the screen, so neither the current blitter nor
+ * the screen are affected.
+ * @param name Name of the blitter.
+ * @param sprites Number of sprites to take from the loaded graphics.
+ * @param[out] ns_per_pixel Nanoseconds per pixel for each #BlitterBenchmark, as measured by #CPerformanceTimer. Drawing is
+ *                          measured per zoom level, the other operations only at #ZOOM_LVL_NORMAL. Negative when not measured.
+ * @param[out] sprite_count Number of sprites that were loaded.
+ * @return False when there is no usable blitter with the given name.
+ */
+bool BenchmarkBlitter(const char *name, uint sprites, double ns_per_pixel[BB_END][ZOOM_LVL_COUNT], uint *sprite_count)
+{
+	for (uint i = 0; i < BB_END; i++) {
+		for (ZoomLevel zoom = ZOOM_LVL_BEGIN; zoom != ZOOM_LVL_END; zoom++) ns_per_pixel[i][zoom] = -1;
+	}
+	*sprite_count = 0;
+
+	BlitterFactory *factory = BlitterFactory::GetBlitterFactory(name);
+	if (factory == NULL) return false;
+
+	Blitter *blitter = factory->CreateInstance();
+	if (blitter->GetScreenDepth() == 0) {
+		/* The null blitter draws nothing. */
+		delete blitter;
+		return true;
+	}
+
+	/* Take the sprites evenly from all loaded sprites. */
+	SmallVector<Sprite *, 64> encoded;
+	uint max_id = GetMaxSpriteID();
+	for (uint i = 0; i < sprites; i++) {
+		SpriteID id = (SpriteID)((uint64)i * max_id / sprites);
+		if (!SpriteExists(id) || GetSpriteType(id) != ST_NORMAL) continue;
+		*encoded.Append() = (Sprite *)GetRawSpriteForBlitter(id, blitter, BenchmarkAllocSprite);
+	}
+	*sprite_count = encoded.Length();
+
+	const int width = _screen.width > 0 ? _screen.width : 640;
+	const int height = _screen.height > 0 ? _screen.height : 480;
+	const uint64 buffer_pixels = (uint64)width * height;
+	byte *buffer = CallocT<byte>(buffer_pixels * blitter->GetScreenDepth() / 8);
+
+	/* Blitters with palette animation keep track of the screen, so let the buffer be the screen. */
+	VideoDriver::GetInstance()->AcquireBlitterLock();
+	DrawPixelInfo old_screen = _screen;
+	_screen.dst_ptr = buffer;
+	_screen.width = width;
+	_screen.height = height;
+	_screen.pitch = width;
+	blitter->PostResize();
+
+	static const BlitterMode modes[] = { BM_NORMAL, BM_COLOUR_REMAP, BM_TRANSPARENT };
+	static const PaletteID palettes[] = { PAL_NONE, PALETTE_TO_RED, PALETTE_TO_TRANSPARENT };
+	for (uint m = 0; m < lengthof(modes); m++) {
+		Blitter::BlitterParams bp;
+		bp.remap = palettes[m] == PAL_NONE ? NULL : GetNonSprite(GB(palettes[m], 0, PALETTE_WIDTH), ST_RECOLOUR) + 1;
+		bp.skip_left = 0;
+		bp.skip_top = 0;
+		bp.dst = buffer;
+		bp.pitch = width;
+
+		for (ZoomLevel zoom = _settings_client.gui.zoom_min; zoom <= _settings_client.gui.zoom_max; zoom++) {
+			uint64 pixels = 0;
+			CPerformanceTimer timer;
+			timer.Start();
+			for (uint r = 0; r < BLITTER_BENCHMARK_REPEATS; r++) {
+				for (uint i = 0; i < encoded.Length(); i++) {
+					const Sprite *sprite = encoded[i];
+					bp.width = UnScaleByZoom(sprite->width, zoom);
+					bp.height = UnScaleByZoom(sprite->height, zoom);
+					if (bp.width > width || bp.height > height) continue;
+
+					/* Spread the sprites over the buffer. */
+					bp.left = (i * 97) % (width - bp.width + 1);
+					bp.top = (i * 53) % (height - bp.height + 1);
+					bp.sprite = sprite->data;
+					bp.sprite_width = sprite->width;
+					bp.sprite_height = sprite->height;
+					blitter->Draw(&bp, modes[m], zoom);
+					pixels += bp.width * bp.height;
+				}
+			}
+			timer.Stop();
+			if (pixels != 0) ns_per_pixel[BB_DRAW_NORMAL + m][zoom] = BenchmarkNanoseconds(timer) / pixels;
+		}
+	}
+
+	CPerformanceTimer timer;
+	timer.Start();
+	for (uint r = 0; r < BLITTER_BENCHMARK_REPEATS; r++) {
+		blitter->DrawColourMappingRect(buffer, width, height, PALETTE_TO_TRANSPARENT);
+	}
+	timer.Stop();
+	ns_per_pixel[BB_COLOUR_MAPPING][ZOOM_LVL_NORMAL] = BenchmarkNanoseconds(timer) / (buffer_pixels * BLITTER_BENCHMARK_REPEATS);
+
+	uint64 pixels = 0;
+	timer = CPerformanceTimer();
+	timer.Start();
+	for (uint r = 0; r < BLITTER_BENCHMARK_REPEATS; r++) {
+		/* Scroll back and forth; the scrolled area is returned in left, top, w and h. */
+		int left = 0;
+		int top = 0;
+		int w = width;
+		int h = height;
+		int scroll = (r % 2 == 0) ? 8 : -8;
+		blitter->ScrollBuffer(buffer, left, top, w, h, scroll, scroll);
+		pixels += w * h;
+	}
+	timer.Stop();
+	if (pixels != 0) ns_per_pixel[BB_SCROLL][ZOOM_LVL_NORMAL] = BenchmarkNanoseconds(timer) / pixels;
+
+	if (blitter->UsePaletteAnimation() == Blitter::PALETTE_ANIMATION_BLITTER) {
+		Palette palette = _cur_palette;
+		palette.first_dirty = PALETTE_ANIM_START;
+		palette.count_dirty = PALETTE_ANIM_SIZE;
+		timer = CPerformanceTimer();
+		timer.Start();
+		for (uint r = 0; r < BLITTER_BENCHMARK_REPEATS; r++) {
+			blitter->PaletteAnimate(palette);
+		}
+		timer.Stop();
+		ns_per_pixel[BB_PALETTE_ANIMATE][ZOOM_LVL_NORMAL] = BenchmarkNanoseconds(timer) / (buffer_pixels * BLITTER_BENCHMARK_REPEATS);
+	}
+
+	_screen = old_screen;
+	VideoDriver::GetInstance()->ReleaseBlitterLock();
+
+	delete blitter;
+	free(buffer);
+	for (uint i = 0; i < encoded.Length(); i++) free(encoded[i]);
+	return true;
+}
+
 bool GraphicsSet::FillSetDetails(IniFile *ini, const char *path, const char *full_filename)
 {
 	bool ret = this->BaseSet<GraphicsSet, MAX_GFT, true>::FillSetDetails(ini, path, full_filename, false);
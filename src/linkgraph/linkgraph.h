@@ -14,11 +14,11 @@
 
 #include "../core/pool_type.hpp"
 #include "../core/smallmap_type.hpp"
-#include "../core/smallmatrix_type.hpp"
 #include "../station_base.h"
 #include "../cargotype.h"
 #include "../date_func.h"
 #include "linkgraph_type.h"
+#include <vector>
 
 struct SaveLoad;
 class LinkGraph;
@@ -55,20 +55,25 @@ public:
 	};
 
 	/**
-	 * An edge in the link graph. Corresponds to a link between two stations or at
-	 * least the distance between them. Edges from one node to itself contain the
-	 * ID of the opposite Node of the first active edge (i.e. not just distance) in
-	 * the column as next_edge.
+	 * An edge in the link graph. Corresponds to a link between two stations.
+	 * Only existing links are stored, in the edge list of their source node.
 	 */
 	struct BaseEdge {
 		uint capacity;                 ///< Capacity of the link.
 		uint usage;                    ///< Usage of the link.
 		Date last_unrestricted_update; ///< When the unrestricted part of the link was last updated.
 		Date last_restricted_update;   ///< When the restricted part of the link was last updated.
-		NodeID next_edge;              ///< Destination of next valid edge starting at the same source node.
-		void Init();
+		NodeID dest;                   ///< Destination of the link.
+		void Init(NodeID dest = INVALID_NODE);
 	};
 
+	/**
+	 * Outgoing edges of a node in the order they were added. They are iterated
+	 * from the back so that the most recently added edge comes first, which is
+	 * the order savegames store them in.
+	 */
+	typedef std::vector<BaseEdge> EdgeList;
+
 	/**
 	 * Wrapper for an edge (const or not) allowing retrieval, but no modification.
 	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
@@ -119,15 +124,30 @@ public:
 
 	/**
 	 * Wrapper for a node (const or not) allowing retrieval, but no modification.
-	 * @tparam Tedge Actual node class, may be "const BaseNode" or just "BaseNode".
-	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
+	 * @tparam Tnode Actual node class, may be "const BaseNode" or just "BaseNode".
+	 * @tparam Tedge_list Actual edge list class, may be "const EdgeList" or just "EdgeList".
 	 */
-	template<typename Tnode, typename Tedge>
+	template<typename Tnode, typename Tedge_list>
 	class NodeWrapper {
 	protected:
-		Tnode &node;  ///< Node being wrapped.
-		Tedge *edges; ///< Outgoing edges for wrapped node.
-		NodeID index; ///< ID of wrapped node.
+		Tnode &node;       ///< Node being wrapped.
+		Tedge_list &edges; ///< Outgoing edges for wrapped node.
+		NodeID index;      ///< ID of wrapped node.
+
+		/**
+		 * Find the outgoing edge to the given node.
+		 * @param to Remote end of the edge.
+		 * @return Position of the edge in the edge list or the size of the
+		 *         list if there is no such edge.
+		 */
+		uint FindEdge(NodeID to) const
+		{
+			uint num_edges = (uint)this->edges.size();
+			for (uint i = 0; i < num_edges; ++i) {
+				if (this->edges[i].dest == to) return i;
+			}
+			return num_edges;
+		}
 
 	public:
 
@@ -137,7 +157,7 @@ public:
 		 * @param edges Outgoing edges for node to be wrapped.
 		 * @param index ID of node to be wrapped.
 		 */
-		NodeWrapper(Tnode &node, Tedge *edges, NodeID index) : node(node),
+		NodeWrapper(Tnode &node, Tedge_list &edges, NodeID index) : node(node),
 			edges(edges), index(index) {}
 
 		/**
@@ -172,17 +192,18 @@ public:
 	};
 
 	/**
-	 * Base class for iterating across outgoing edges of a node. Only the real
-	 * edges (those with capacity) are iterated. The ones with only distance
-	 * information are skipped.
-	 * @tparam Tedge Actual edge class. May be "BaseEdge" or "const BaseEdge".
+	 * Base class for iterating across outgoing edges of a node, most recently
+	 * added edge first. The iterator keeps the position counted from the front
+	 * of the edge list, so edges may be added or the edges already visited may
+	 * be removed while iterating.
+	 * @tparam Tedge_list Actual edge list class. May be "EdgeList" or "const EdgeList".
 	 * @tparam Titer Actual iterator class.
 	 */
-	template <class Tedge, class Tedge_wrapper, class Titer>
+	template <class Tedge_list, class Tedge_wrapper, class Titer>
 	class BaseEdgeIterator {
 	protected:
-		Tedge *base;    ///< Array of edges being iterated.
-		NodeID current; ///< Current offset in edges array.
+		Tedge_list *base; ///< List of edges being iterated.
+		uint current;     ///< Number of edges not visited yet, including the current one.
 
 		/**
 		 * A "fake" pointer to enable operator-> on temporaries. As the objects
@@ -209,12 +230,11 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param current ID of current node (to locate the first edge).
+		 * @param base List of edges to be iterated.
+		 * @param current Number of edges to be iterated; 0 for the end.
 		 */
-		BaseEdgeIterator (Tedge *base, NodeID current) :
-			base(base),
-			current(current == INVALID_NODE ? current : base[current].next_edge)
+		BaseEdgeIterator (Tedge_list *base, uint current) :
+			base(base), current(current)
 		{}
 
 		/**
@@ -223,7 +243,7 @@ public:
 		 */
 		Titer &operator++()
 		{
-			this->current = this->base[this->current].next_edge;
+			--this->current;
 			return static_cast<Titer &>(*this);
 		}
 
@@ -234,7 +254,7 @@ public:
 		Titer operator++(int)
 		{
 			Titer ret(static_cast<Titer &>(*this));
-			this->current = this->base[this->current].next_edge;
+			--this->current;
 			return ret;
 		}
 
@@ -243,7 +263,7 @@ public:
 		 * child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If the iterators have the same edge array and current node.
+		 * @return If the iterators have the same edge list and position.
 		 */
 		template<class Tother>
 		bool operator==(const Tother &other)
@@ -256,7 +276,7 @@ public:
 		 * may be of a child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If either the edge arrays or the current nodes differ.
+		 * @return If either the edge lists or the positions differ.
 		 */
 		template<class Tother>
 		bool operator!=(const Tother &other)
@@ -270,7 +290,7 @@ public:
 		 */
 		SmallPair<NodeID, Tedge_wrapper> operator*() const
 		{
-			return SmallPair<NodeID, Tedge_wrapper>(this->current, Tedge_wrapper(this->base[this->current]));
+			return SmallPair<NodeID, Tedge_wrapper>((*this->base)[this->current - 1].dest, Tedge_wrapper((*this->base)[this->current - 1]));
 		}
 
 		/**
@@ -306,37 +326,37 @@ public:
 	 * An iterator for const edges. Cannot be typedef'ed because of
 	 * template-reference to ConstEdgeIterator itself.
 	 */
-	class ConstEdgeIterator : public BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator> {
+	class ConstEdgeIterator : public BaseEdgeIterator<const EdgeList, ConstEdge, ConstEdgeIterator> {
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param edges List of edges to be iterated over.
+		 * @param current Number of edges to be iterated.
 		 */
-		ConstEdgeIterator(const BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(edges, current) {}
+		ConstEdgeIterator(const EdgeList *edges, uint current) :
+			BaseEdgeIterator<const EdgeList, ConstEdge, ConstEdgeIterator>(edges, current) {}
 	};
 
 	/**
 	 * An iterator for non-const edges. Cannot be typedef'ed because of
 	 * template-reference to EdgeIterator itself.
 	 */
-	class EdgeIterator : public BaseEdgeIterator<BaseEdge, Edge, EdgeIterator> {
+	class EdgeIterator : public BaseEdgeIterator<EdgeList, Edge, EdgeIterator> {
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param edges List of edges to be iterated over.
+		 * @param current Number of edges to be iterated.
 		 */
-		EdgeIterator(BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(edges, current) {}
+		EdgeIterator(EdgeList *edges, uint current) :
+			BaseEdgeIterator<EdgeList, Edge, EdgeIterator>(edges, current) {}
 	};
 
 	/**
 	 * Constant node class. Only retrieval operations are allowed on both the
 	 * node itself and its edges.
 	 */
-	class ConstNode : public NodeWrapper<const BaseNode, const BaseEdge> {
+	class ConstNode : public NodeWrapper<const BaseNode, const EdgeList> {
 	public:
 		/**
 		 * Constructor.
@@ -344,34 +364,39 @@ public:
 		 * @param node ID of the node.
 		 */
 		ConstNode(const LinkGraph *lg, NodeID node) :
-			NodeWrapper<const BaseNode, const BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<const BaseNode, const EdgeList>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
 		 * Get a ConstEdge. This is not a reference as the wrapper objects are
-		 * not actually persistent.
+		 * not actually persistent. If there is no edge to the given node an
+		 * empty edge is returned.
 		 * @param to ID of end node of edge.
 		 * @return Constant edge wrapper.
 		 */
-		ConstEdge operator[](NodeID to) const { return ConstEdge(this->edges[to]); }
+		ConstEdge operator[](NodeID to) const
+		{
+			uint i = this->FindEdge(to);
+			return ConstEdge(i < this->edges.size() ? this->edges[i] : LinkGraph::empty_edge);
+		}
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the start of the edge list.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges, this->index); }
+		ConstEdgeIterator Begin() const { return ConstEdgeIterator(&this->edges, (uint)this->edges.size()); }
 
 		/**
-		 * Get an iterator pointing beyond the end of the edges array.
+		 * Get an iterator pointing beyond the end of the edge list.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges, INVALID_NODE); }
+		ConstEdgeIterator End() const { return ConstEdgeIterator(&this->edges, 0); }
 	};
 
 	/**
 	 * Updatable node class. The node itself as well as its edges can be modified.
 	 */
-	class Node : public NodeWrapper<BaseNode, BaseEdge> {
+	class Node : public NodeWrapper<BaseNode, EdgeList> {
 	public:
 		/**
 		 * Constructor.
@@ -379,28 +404,34 @@ public:
 		 * @param node ID of the node.
 		 */
 		Node(LinkGraph *lg, NodeID node) :
-			NodeWrapper<BaseNode, BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<BaseNode, EdgeList>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
 		 * Get an Edge. This is not a reference as the wrapper objects are not
-		 * actually persistent.
+		 * actually persistent. The edge has to exist; use a ConstNode to
+		 * inspect edges which might not.
 		 * @param to ID of end node of edge.
 		 * @return Edge wrapper.
 		 */
-		Edge operator[](NodeID to) { return Edge(this->edges[to]); }
+		Edge operator[](NodeID to)
+		{
+			uint i = this->FindEdge(to);
+			assert(i < this->edges.size());
+			return Edge(this->edges[i]);
+		}
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the start of the edge list.
 		 * @return Edge iterator.
 		 */
-		EdgeIterator Begin() { return EdgeIterator(this->edges, this->index); }
+		EdgeIterator Begin() { return EdgeIterator(&this->edges, (uint)this->edges.size()); }
 
 		/**
-		 * Get an iterator pointing beyond the end of the edges array.
-		 * @return Constant edge iterator.
+		 * Get an iterator pointing beyond the end of the edge list.
+		 * @return Edge iterator.
 		 */
-		EdgeIterator End() { return EdgeIterator(this->edges, INVALID_NODE); }
+		EdgeIterator End() { return EdgeIterator(&this->edges, 0); }
 
 		/**
 		 * Update the node's supply and set last_update to the current date.
@@ -436,7 +467,10 @@ public:
 	};
 
 	typedef SmallVector<BaseNode, 16> NodeVector;
-	typedef SmallMatrix<BaseEdge> EdgeMatrix;
+	typedef std::vector<EdgeList> EdgeListVector;
+
+	/** Edge returned when asking for an edge that doesn't exist. */
+	static const BaseEdge empty_edge;
 
 	/** Minimum effective distance for timeout calculation. */
 	static const uint MIN_TIMEOUT_DISTANCE = 32;
@@ -526,14 +560,16 @@ public:
 protected:
 	friend class LinkGraph::ConstNode;
 	friend class LinkGraph::Node;
+	friend class LinkGraphJob;
 	friend const SaveLoad *GetLinkGraphDesc();
 	friend const SaveLoad *GetLinkGraphJobDesc();
-	friend void SaveLoad_LinkGraph(LinkGraph &lg);
+	friend void Save_LinkGraph(LinkGraph &lg);
+	friend void Load_LinkGraph(LinkGraph &lg);
 
 	CargoID cargo;         ///< Cargo of this component's link graph.
 	Date last_compression; ///< Last time the capacities and supplies were compressed.
 	NodeVector nodes;      ///< Nodes in the component.
-	EdgeMatrix edges;      ///< Edges in the component.
+	EdgeListVector edges;  ///< Outgoing edges of each node in the component.
 };
 
 #define FOR_ALL_LINK_GRAPHS(var) FOR_ALL_ITEMS_FROM(LinkGraph, link_graph_index, var, 0)
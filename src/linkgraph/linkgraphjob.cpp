@@ -14,6 +14,7 @@
 #include "../window_func.h"
 #include "linkgraphjob.h"
 #include "linkgraphschedule.h"
+#include <algorithm>
 
 #include "../safeguards.h"
 
@@ -39,7 +40,7 @@ LinkGraphJob::LinkGraphJob(const LinkGraph &orig) :
 		 * This is on purpose. */
 		link_graph(orig),
 		settings(_settings_game.linkgraph),
-		thread(NULL),
+		range(NULL),
 		join_date(_date + _settings_game.linkgraph.recalc_time)
 {
 }
@@ -56,21 +57,92 @@ void LinkGraphJob::EraseFlows(NodeID from)
 }
 
 /**
- * Spawn a thread if possible and run the link graph job in the thread. If
- * that's not possible run the job right now in the current thread.
+ * A share of the link graph jobs spawned together, to be run one after another
+ * in a single thread. The range owns the thread and is shared by all its jobs;
+ * whichever job is joined first joins the thread, so none of the jobs can be
+ * destroyed while the thread still runs any of them.
  */
-void LinkGraphJob::SpawnThread()
+struct LinkGraphJobRange {
+	LinkGraphJob **jobs;  ///< Jobs to be run.
+	uint count;           ///< Number of jobs.
+	uint refs;            ///< Number of jobs still referring to the range.
+	ThreadObject *thread; ///< Thread running the jobs, or NULL if it has been joined or was never started.
+
+	/**
+	 * Create a range of jobs.
+	 * @param jobs  Jobs to be run; they are copied.
+	 * @param count Number of jobs.
+	 */
+	LinkGraphJobRange(LinkGraphJob * const *jobs, uint count) : jobs(MallocT<LinkGraphJob *>(count)), count(count), refs(count), thread(NULL)
+	{
+		MemCpyT(this->jobs, jobs, count);
+	}
+
+	~LinkGraphJobRange()
+	{
+		assert(this->thread == NULL);
+		free(this->jobs);
+	}
+
+	/** Wait for the thread to finish all jobs of the range. */
+	void Join()
+	{
+		if (this->thread != NULL) {
+			this->thread->Join();
+			delete this->thread;
+			this->thread = NULL;
+		}
+	}
+
+	/** Drop the reference of one job and destroy the range if it was the last one. */
+	void Release()
+	{
+		assert(this->refs > 0);
+		if (--this->refs == 0) delete this;
+	}
+
+	/**
+	 * Run all jobs of the range. This method is tailored to ThreadObject::New.
+	 * @param r Pointer to a range of link graph jobs.
+	 */
+	static void Run(void *r)
+	{
+		LinkGraphJobRange *range = (LinkGraphJobRange *)r;
+		for (uint i = 0; i < range->count; i++) {
+			LinkGraphSchedule::Run(range->jobs[i]);
+		}
+	}
+};
+
+/**
+ * Spawn threads if possible and run the given link graph jobs in them. The
+ * jobs are divided over at most GetWorkerThreadCount() threads, each running
+ * its share of the jobs one after another. All jobs of a share refer to the
+ * same range, so joining any of them waits for the whole share. If spawning
+ * a thread is not possible, run its jobs right now in the current thread.
+ * @param jobs  Link graph jobs to be run.
+ * @param count Number of jobs.
+ */
+/* static */ void LinkGraphJob::SpawnThreads(LinkGraphJob **jobs, uint count)
 {
-	if (!ThreadObject::New(&(LinkGraphSchedule::Run), this, &this->thread, "ottd:linkgraph")) {
-		this->thread = NULL;
-		/* Of course this will hang a bit.
-		 * On the other hand, if you want to play games which make this hang noticably
-		 * on a platform without threads then you'll probably get other problems first.
-		 * OK:
-		 * If someone comes and tells me that this hangs for him/her, I'll implement a
-		 * smaller grained "Step" method for all handlers and add some more ticks where
-		 * "Step" is called. No problem in principle. */
-		LinkGraphSchedule::Run(this);
+	uint threads = min(count, GetWorkerThreadCount());
+	for (uint i = 0; i < threads; i++) {
+		uint first = count * i / threads;
+		uint last = count * (i + 1) / threads;
+
+		LinkGraphJobRange *range = new LinkGraphJobRange(jobs + first, last - first);
+		if (!ThreadObject::New(&LinkGraphJobRange::Run, range, &range->thread, "ottd:linkgraph")) {
+			range->thread = NULL;
+			/* Of course this will hang a bit.
+			 * On the other hand, if you want to play games which make this hang noticably
+			 * on a platform without threads then you'll probably get other problems first.
+			 * OK:
+			 * If someone comes and tells me that this hangs for him/her, I'll implement a
+			 * smaller grained "Step" method for all handlers and add some more ticks where
+			 * "Step" is called. No problem in principle. */
+			LinkGraphJobRange::Run(range);
+		}
+		for (uint j = first; j < last; j++) jobs[j]->range = range;
 	}
 }
 
@@ -79,10 +151,10 @@ void LinkGraphJob::SpawnThread()
  */
 void LinkGraphJob::JoinThread()
 {
-	if (this->thread != NULL) {
-		this->thread->Join();
-		delete this->thread;
-		this->thread = NULL;
+	if (this->range != NULL) {
+		this->range->Join();
+		this->range->Release();
+		this->range = NULL;
 	}
 }
 
@@ -119,7 +191,7 @@ LinkGraphJob::~LinkGraphJob()
 			continue;
 		}
 
-		LinkGraph *lg = LinkGraph::Get(ge.link_graph);
+		const LinkGraph *lg = LinkGraph::Get(ge.link_graph);
 		FlowStatMap &flows = from.Flows();
 
 		for (EdgeIterator it(from.Begin()); it != from.End(); ++it) {
@@ -180,13 +252,15 @@ void LinkGraphJob::Init()
 {
 	uint size = this->Size();
 	this->nodes.Resize(size);
-	this->edges.Resize(size, size);
+	this->demands.resize(size);
+	uint num_edges = 0;
 	for (uint i = 0; i < size; ++i) {
-		this->nodes[i].Init(this->link_graph[i].Supply());
-		EdgeAnnotation *node_edges = this->edges[i];
-		for (uint j = 0; j < size; ++j) {
-			node_edges[j].Init();
-		}
+		this->nodes[i].Init(this->link_graph[i].Supply(), num_edges);
+		num_edges += (uint)this->link_graph.edges[i].size();
+	}
+	this->edges.Resize(num_edges);
+	for (uint i = 0; i < num_edges; ++i) {
+		this->edges[i].Init();
 	}
 }
 
@@ -195,23 +269,53 @@ void LinkGraphJob::Init()
  */
 void LinkGraphJob::EdgeAnnotation::Init()
 {
-	this->demand = 0;
 	this->flow = 0;
-	this->unsatisfied_demand = 0;
 }
 
 /**
  * Initialize a Linkgraph job node. The underlying memory is expected to be
  * freshly allocated, without any constructors having been called.
  * @param supply Initial undelivered supply.
+ * @param first_edge Position of the annotation of the node's first edge.
  */
-void LinkGraphJob::NodeAnnotation::Init(uint supply)
+void LinkGraphJob::NodeAnnotation::Init(uint supply, uint first_edge)
 {
 	this->undelivered_supply = supply;
+	this->first_edge = first_edge;
 	new (&this->flows) FlowStatMap;
 	new (&this->paths) PathList;
 }
 
+/**
+ * Compare a demand with a node ID for sorting demands by destination.
+ * @param demand Demand to be compared.
+ * @param to Node to compare the destination of the demand with.
+ * @return If the demand is directed at a node before "to".
+ */
+static bool DemandIsBefore(const LinkGraphJob::DemandAnnotation &demand, NodeID to)
+{
+	return demand.dest < to;
+}
+
+/**
+ * Deliver some supply, adding demand towards the given node.
+ * @param to Destination for supply.
+ * @param amount Amount of supply to be delivered.
+ */
+void LinkGraphJob::Node::DeliverSupply(NodeID to, uint amount)
+{
+	this->node_anno.undelivered_supply -= amount;
+	if (amount == 0) return;
+
+	DemandAnnotationVector::iterator it = std::lower_bound(this->demands.begin(), this->demands.end(), to, &DemandIsBefore);
+	if (it == this->demands.end() || it->dest != to) {
+		DemandAnnotation demand = { to, 0, 0 };
+		it = this->demands.insert(it, demand);
+	}
+	it->demand += amount;
+	it->unsatisfied_demand += amount;
+}
+
 /**
  * Add this path as a new child to the given base path, thus making this path
  * a "fork" of the base path.
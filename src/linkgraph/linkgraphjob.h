@@ -15,9 +15,11 @@
 #include "../thread/thread.h"
 #include "linkgraph.h"
 #include <list>
+#include <vector>
 
 class LinkGraphJob;
 class Path;
+struct LinkGraphJobRange;
 typedef std::list<Path *> PathList;
 
 /** Type of the pool for link graph jobs. */
@@ -34,8 +36,6 @@ private:
 	 * Annotation for a link graph edge.
 	 */
 	struct EdgeAnnotation {
-		uint demand;             ///< Transport demand between the nodes.
-		uint unsatisfied_demand; ///< Demand over this edge that hasn't been satisfied yet.
 		uint flow;               ///< Planned flow over this edge.
 		void Init();
 	};
@@ -45,13 +45,40 @@ private:
 	 */
 	struct NodeAnnotation {
 		uint undelivered_supply; ///< Amount of supply that hasn't been distributed yet.
+		uint first_edge;         ///< Position of the annotation of the node's first edge in the edge annotations.
 		PathList paths;          ///< Paths through this node, sorted so that those with flow == 0 are in the back.
 		FlowStatMap flows;       ///< Planned flows to other nodes.
-		void Init(uint supply);
+		void Init(uint supply, uint first_edge);
 	};
 
+public:
+	/**
+	 * Transport demand from one node to another. Only pairs of nodes which
+	 * have been assigned demand get one of these.
+	 */
+	struct DemandAnnotation {
+		NodeID dest;             ///< Node the demand is directed at.
+		uint demand;             ///< Transport demand between the nodes.
+		uint unsatisfied_demand; ///< Demand that hasn't been satisfied yet.
+
+		/**
+		 * Satisfy some demand.
+		 * @param amount Demand to be satisfied.
+		 */
+		void Satisfy(uint amount)
+		{
+			assert(amount <= this->unsatisfied_demand);
+			this->unsatisfied_demand -= amount;
+		}
+	};
+
+	/** Demands of a node, sorted by destination. */
+	typedef std::vector<DemandAnnotation> DemandAnnotationVector;
+
+private:
 	typedef SmallVector<NodeAnnotation, 16> NodeAnnotationVector;
-	typedef SmallMatrix<EdgeAnnotation> EdgeAnnotationMatrix;
+	typedef SmallVector<EdgeAnnotation, 16> EdgeAnnotationVector;
+	typedef std::vector<DemandAnnotationVector> DemandMatrix;
 
 	friend const SaveLoad *GetLinkGraphJobDesc();
 	friend class LinkGraphSchedule;
@@ -59,20 +86,22 @@ private:
 protected:
 	const LinkGraph link_graph;       ///< Link graph to by analyzed. Is copied when job is started and mustn't be modified later.
 	const LinkGraphSettings settings; ///< Copy of _settings_game.linkgraph at spawn time.
-	ThreadObject *thread;             ///< Thread the job is running in or NULL if it's running in the main thread.
+	LinkGraphJobRange *range;         ///< Jobs spawned together with this one in the same thread, or NULL if the job isn't running in a thread.
 	Date join_date;                   ///< Date when the job is to be joined.
 	NodeAnnotationVector nodes;       ///< Extra node data necessary for link graph calculation.
-	EdgeAnnotationMatrix edges;       ///< Extra edge data necessary for link graph calculation.
+	EdgeAnnotationVector edges;       ///< Extra edge data necessary for link graph calculation, for each node in the order of its edge list.
+	DemandMatrix demands;             ///< Demands assigned between the nodes.
 
 	void EraseFlows(NodeID from);
 	void JoinThread();
-	void SpawnThread();
+	static void SpawnThreads(LinkGraphJob **jobs, uint count);
 
 public:
 
 	/**
 	 * A job edge. Wraps a link graph edge and an edge annotation. The
-	 * annotation can be modified, the edge is constant.
+	 * annotation can be modified, the edge is constant. Demand is kept
+	 * separately, see DemandAnnotation.
 	 */
 	class Edge : public LinkGraph::ConstEdge {
 	private:
@@ -86,18 +115,6 @@ public:
 		Edge(const LinkGraph::BaseEdge &edge, EdgeAnnotation &anno) :
 				LinkGraph::ConstEdge(edge), anno(anno) {}
 
-		/**
-		 * Get the transport demand between end the points of the edge.
-		 * @return Demand.
-		 */
-		uint Demand() const { return this->anno.demand; }
-
-		/**
-		 * Get the transport demand that hasn't been satisfied by flows, yet.
-		 * @return Unsatisfied demand.
-		 */
-		uint UnsatisfiedDemand() const { return this->anno.unsatisfied_demand; }
-
 		/**
 		 * Get the total flow on the edge.
 		 * @return Flow.
@@ -119,42 +136,22 @@ public:
 			assert(flow <= this->anno.flow);
 			this->anno.flow -= flow;
 		}
-
-		/**
-		 * Add some (not yet satisfied) demand.
-		 * @param demand Demand to be added.
-		 */
-		void AddDemand(uint demand)
-		{
-			this->anno.demand += demand;
-			this->anno.unsatisfied_demand += demand;
-		}
-
-		/**
-		 * Satisfy some demand.
-		 * @param demand Demand to be satisfied.
-		 */
-		void SatisfyDemand(uint demand)
-		{
-			assert(demand <= this->anno.unsatisfied_demand);
-			this->anno.unsatisfied_demand -= demand;
-		}
 	};
 
 	/**
 	 * Iterator for job edges.
 	 */
-	class EdgeIterator : public LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator> {
-		EdgeAnnotation *base_anno; ///< Array of annotations to be (indirectly) iterated.
+	class EdgeIterator : public LinkGraph::BaseEdgeIterator<const LinkGraph::EdgeList, Edge, EdgeIterator> {
+		EdgeAnnotation *base_anno; ///< Array of annotations to be iterated along with the edges.
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
+		 * @param base List of edges to be iterated.
 		 * @param base_anno Array of annotations to be iterated.
-		 * @param current Start offset of iteration.
+		 * @param current Number of edges to be iterated.
 		 */
-		EdgeIterator(const LinkGraph::BaseEdge *base, EdgeAnnotation *base_anno, NodeID current) :
-				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(base, current),
+		EdgeIterator(const LinkGraph::EdgeList *base, EdgeAnnotation *base_anno, uint current) :
+				LinkGraph::BaseEdgeIterator<const LinkGraph::EdgeList, Edge, EdgeIterator>(base, current),
 				base_anno(base_anno) {}
 
 		/**
@@ -164,7 +161,8 @@ public:
 		 */
 		SmallPair<NodeID, Edge> operator*() const
 		{
-			return SmallPair<NodeID, Edge>(this->current, Edge(this->base[this->current], this->base_anno[this->current]));
+			return SmallPair<NodeID, Edge>((*this->base)[this->current - 1].dest,
+					Edge((*this->base)[this->current - 1], this->base_anno[this->current - 1]));
 		}
 
 		/**
@@ -183,8 +181,9 @@ public:
 	 */
 	class Node : public LinkGraph::ConstNode {
 	private:
-		NodeAnnotation &node_anno;  ///< Annotation being wrapped.
-		EdgeAnnotation *edge_annos; ///< Edge annotations belonging to this node.
+		NodeAnnotation &node_anno;        ///< Annotation being wrapped.
+		EdgeAnnotation *edge_annos;       ///< Edge annotations belonging to this node.
+		DemandAnnotationVector &demands;  ///< Demands from this node to other nodes.
 	public:
 
 		/**
@@ -194,30 +193,41 @@ public:
 		 */
 		Node (LinkGraphJob *lgj, NodeID node) :
 			LinkGraph::ConstNode(&lgj->link_graph, node),
-			node_anno(lgj->nodes[node]), edge_annos(lgj->edges[node])
+			node_anno(lgj->nodes[node]), edge_annos(lgj->edges.Begin() + lgj->nodes[node].first_edge),
+			demands(lgj->demands[node])
 		{}
 
 		/**
 		 * Retrieve an edge starting at this node. Mind that this returns an
-		 * object, not a reference.
+		 * object, not a reference. The edge has to exist.
 		 * @param to Remote end of the edge.
 		 * @return Edge between this node and "to".
 		 */
-		Edge operator[](NodeID to) const { return Edge(this->edges[to], this->edge_annos[to]); }
+		Edge operator[](NodeID to) const
+		{
+			uint i = this->FindEdge(to);
+			assert(i < this->edges.size());
+			return Edge(this->edges[i], this->edge_annos[i]);
+		}
 
 		/**
-		 * Iterator for the "begin" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the "begin" of the edge list.
 		 * @return Iterator pointing to the first edge.
 		 */
-		EdgeIterator Begin() const { return EdgeIterator(this->edges, this->edge_annos, index); }
+		EdgeIterator Begin() const { return EdgeIterator(&this->edges, this->edge_annos, (uint)this->edges.size()); }
 
 		/**
-		 * Iterator for the "end" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the "end" of the edge list.
 		 * @return Iterator pointing beyond the last edge.
 		 */
-		EdgeIterator End() const { return EdgeIterator(this->edges, this->edge_annos, INVALID_NODE); }
+		EdgeIterator End() const { return EdgeIterator(&this->edges, this->edge_annos, 0); }
+
+		/**
+		 * Get the demands from this node to other nodes, sorted by
+		 * destination.
+		 * @return Demands.
+		 */
+		DemandAnnotationVector &Demands() { return this->demands; }
 
 		/**
 		 * Get amount of supply that hasn't been delivered, yet.
@@ -250,23 +260,14 @@ public:
 		 */
 		const PathList &Paths() const { return this->node_anno.paths; }
 
-		/**
-		 * Deliver some supply, adding demand to the respective edge.
-		 * @param to Destination for supply.
-		 * @param amount Amount of supply to be delivered.
-		 */
-		void DeliverSupply(NodeID to, uint amount)
-		{
-			this->node_anno.undelivered_supply -= amount;
-			(*this)[to].AddDemand(amount);
-		}
+		void DeliverSupply(NodeID to, uint amount);
 	};
 
 	/**
 	 * Bare constructor, only for save/load. link_graph, join_date and actually
 	 * settings have to be brutally const-casted in order to populate them.
 	 */
-	LinkGraphJob() : settings(_settings_game.linkgraph), thread(NULL),
+	LinkGraphJob() : settings(_settings_game.linkgraph), range(NULL),
 			join_date(INVALID_DATE) {}
 
 	LinkGraphJob(const LinkGraph &orig);
@@ -26,44 +26,63 @@
 /* static */ LinkGraphSchedule LinkGraphSchedule::instance;
 
 /**
- * Start the next job in the schedule.
+ * Take the next link graph worth calculating from the schedule.
+ * @return The link graph or NULL if there is none.
  */
-void LinkGraphSchedule::SpawnNext()
+LinkGraph *LinkGraphSchedule::PopNext()
 {
-	if (this->schedule.empty()) return;
+	if (this->schedule.empty()) return NULL;
 	LinkGraph *next = this->schedule.front();
 	LinkGraph *first = next;
 	while (next->Size() < 2) {
 		this->schedule.splice(this->schedule.end(), this->schedule, this->schedule.begin());
 		next = this->schedule.front();
-		if (next == first) return;
+		if (next == first) return NULL;
 	}
 	assert(next == LinkGraph::Get(next->index));
 	this->schedule.pop_front();
-	if (LinkGraphJob::CanAllocateItem()) {
-		LinkGraphJob *job = new LinkGraphJob(*next);
-		job->SpawnThread();
-		this->running.push_back(job);
-	} else {
-		NOT_REACHED();
+	return next;
+}
+
+/**
+ * Start the next jobs in the schedule. Up to recalc_jobs jobs are started
+ * together; they share the same join date.
+ */
+void LinkGraphSchedule::SpawnNext()
+{
+	LinkGraphJob **jobs = AllocaM(LinkGraphJob *, _settings_game.linkgraph.recalc_jobs);
+	uint count = 0;
+	while (count < _settings_game.linkgraph.recalc_jobs) {
+		LinkGraph *next = this->PopNext();
+		if (next == NULL) break;
+		if (LinkGraphJob::CanAllocateItem()) {
+			jobs[count] = new LinkGraphJob(*next);
+			this->running.push_back(jobs[count++]);
+		} else {
+			NOT_REACHED();
+		}
 	}
+	LinkGraphJob::SpawnThreads(jobs, count);
 }
 
 /**
- * Join the next finished job, if available.
+ * Join the next finished job and the jobs started together with it, if available.
  */
 void LinkGraphSchedule::JoinNext()
 {
 	if (this->running.empty()) return;
-	LinkGraphJob *next = this->running.front();
-	if (!next->IsFinished()) return;
-	this->running.pop_front();
-	LinkGraphID id = next->LinkGraphIndex();
-	delete next; // implicitly joins the thread
-	if (LinkGraph::IsValidID(id)) {
-		LinkGraph *lg = LinkGraph::Get(id);
-		this->Unqueue(lg); // Unqueue to avoid double-queueing recycled IDs.
-		this->Queue(lg);
+	Date join_date = this->running.front()->JoinDate();
+	while (!this->running.empty()) {
+		LinkGraphJob *next = this->running.front();
+		if (!next->IsFinished() || next->JoinDate() != join_date) return;
+		this->running.pop_front();
+		LinkGraphID id = next->LinkGraphIndex();
+		delete next; // implicitly joins the thread
+		if (LinkGraph::IsValidID(id)) {
+			LinkGraph *lg = LinkGraph::Get(id);
+			this->Unqueue(lg); // Unqueue to avoid double-queueing recycled IDs.
+			this->Queue(lg);
+		}
 	}
 }
 
@@ -82,13 +101,21 @@ void LinkGraphSchedule::JoinNext()
 
 /**
  * Start all threads in the running list. This is only useful for save/load.
- * Usually threads are started when the job is created.
+ * Usually threads are started when the job is created. Jobs that share
+ * their join date were started together, so they are spawned together.
  */
 void LinkGraphSchedule::SpawnAll()
 {
+	LinkGraphJob **jobs = AllocaM(LinkGraphJob *, this->running.size());
+	uint count = 0;
 	for (JobList::iterator i = this->running.begin(); i != this->running.end(); ++i) {
-		(*i)->SpawnThread();
+		if (count != 0 && jobs[0]->JoinDate() != (*i)->JoinDate()) {
+			LinkGraphJob::SpawnThreads(jobs, count);
+			count = 0;
+		}
+		jobs[count++] = *i;
 	}
+	LinkGraphJob::SpawnThreads(jobs, count);
 }
 
 /**
@@ -3,12 +3,13 @@
 #include "../stdafx.h"
 #include "../core/math_func.hpp"
 #include "mcf.h"
-#include <set>
 
 #include "../safeguards.h"
 
 typedef std::map<NodeID, Path *> PathViaMap;
 
+static const uint INVALID_POSITION = UINT_MAX; ///< Position in the Dijkstra queue of annotations not queued.
+
 /**
  * Distance-based annotation for use in the Dijkstra algorithm. This is close
  * to the original meaning of "annotation" in this context. Paths are rated
@@ -88,14 +89,15 @@ public:
 };
 
 /**
- * Iterator class for getting the edges in the order of their next_edge
- * members.
+ * Iterator class for getting the edges in the order of the nodes' edge
+ * lists.
  */
 class GraphEdgeIterator {
 private:
-	LinkGraphJob &job; ///< Job being executed
-	EdgeIterator i;    ///< Iterator pointing to current edge.
-	EdgeIterator end;  ///< Iterator pointing beyond last edge.
+	LinkGraphJob &job;    ///< Job being executed
+	EdgeIterator i;       ///< Iterator pointing to next edge.
+	EdgeIterator end;     ///< Iterator pointing beyond last edge.
+	EdgeIterator current; ///< Iterator pointing to the edge last returned by Next().
 
 public:
 
@@ -104,7 +106,7 @@ public:
 	 * @param job Job to iterate on.
 	 */
 	GraphEdgeIterator(LinkGraphJob &job) : job(job),
-		i(NULL, NULL, INVALID_NODE), end(NULL, NULL, INVALID_NODE)
+		i(NULL, NULL, 0), end(NULL, NULL, 0), current(NULL, NULL, 0)
 	{}
 
 	/**
@@ -124,7 +126,21 @@ public:
 	 */
 	NodeID Next()
 	{
-		return this->i != this->end ? (this->i++)->first : INVALID_NODE;
+		if (this->i == this->end) return INVALID_NODE;
+		this->current = this->i++;
+		return this->current->first;
+	}
+
+	/**
+	 * Retrieve the edge the node last returned by Next() was found by,
+	 * without searching the edge list for it.
+	 * @param from Unused.
+	 * @param to Unused.
+	 * @return The edge.
+	 */
+	Edge GetEdge(NodeID from, NodeID to)
+	{
+		return this->current->second;
 	}
 };
 
@@ -187,6 +203,141 @@ public:
 		if (this->it == this->end) return INVALID_NODE;
 		return this->station_to_node[(this->it++)->second];
 	}
+
+	/**
+	 * Retrieve the edge between two nodes. The flows only know the next
+	 * station, so the edge has to be searched for.
+	 * @param from Node the edge starts at.
+	 * @param to Node the edge ends at.
+	 * @return The edge.
+	 */
+	Edge GetEdge(NodeID from, NodeID to)
+	{
+		return this->job[from][to];
+	}
+};
+
+/**
+ * Priority queue of annotations for the Dijkstra algorithm. It is a binary
+ * heap which knows the position of each node's annotation, so that an
+ * annotation can be moved after its value has changed. The annotation's
+ * comparator gives a strict order, so the annotations are taken out in the
+ * same order as they would be from a sorted set.
+ * @tparam Tannotation Annotation to be used.
+ */
+template<class Tannotation>
+class AnnotationQueue {
+private:
+	typename Tannotation::Comparator comp; ///< Comparator defining the order of the annotations.
+	PathVector &heap;                      ///< The heap.
+	std::vector<uint> &positions;          ///< Position of each node's annotation in the heap.
+
+	/**
+	 * Get the annotation at some position in the heap.
+	 * @param pos Position in the heap.
+	 * @return Annotation.
+	 */
+	inline Tannotation *At(uint pos) const { return static_cast<Tannotation *>(this->heap[pos]); }
+
+	/**
+	 * Put an annotation to a position in the heap.
+	 * @param pos Position in the heap.
+	 * @param anno Annotation.
+	 */
+	inline void Place(uint pos, Tannotation *anno)
+	{
+		this->heap[pos] = anno;
+		this->positions[anno->GetNode()] = pos;
+	}
+
+	/**
+	 * Move an annotation towards the top of the heap as far as necessary.
+	 * @param pos Position of the annotation.
+	 * @return New position of the annotation.
+	 */
+	uint SiftUp(uint pos)
+	{
+		Tannotation *anno = this->At(pos);
+		while (pos > 0) {
+			uint parent = (pos - 1) / 2;
+			if (!this->comp(anno, this->At(parent))) break;
+			this->Place(pos, this->At(parent));
+			pos = parent;
+		}
+		this->Place(pos, anno);
+		return pos;
+	}
+
+	/**
+	 * Move an annotation towards the bottom of the heap as far as necessary.
+	 * @param pos Position of the annotation.
+	 */
+	void SiftDown(uint pos)
+	{
+		Tannotation *anno = this->At(pos);
+		uint size = (uint)this->heap.size();
+		for (;;) {
+			uint child = 2 * pos + 1;
+			if (child >= size) break;
+			if (child + 1 < size && this->comp(this->At(child + 1), this->At(child))) ++child;
+			if (!this->comp(this->At(child), anno)) break;
+			this->Place(pos, this->At(child));
+			pos = child;
+		}
+		this->Place(pos, anno);
+	}
+
+public:
+	/**
+	 * Create an empty queue on the given storage.
+	 * @param heap Storage for the heap.
+	 * @param positions Storage for the positions of the annotations.
+	 * @param size Number of nodes in the graph.
+	 */
+	AnnotationQueue(PathVector &heap, std::vector<uint> &positions, uint size) :
+		heap(heap), positions(positions)
+	{
+		this->heap.clear();
+		this->positions.assign(size, INVALID_POSITION);
+	}
+
+	/**
+	 * Check if the queue is empty.
+	 * @return If there are no annotations in the queue.
+	 */
+	inline bool IsEmpty() const { return this->heap.empty(); }
+
+	/**
+	 * Take the best annotation out of the queue.
+	 * @return Best annotation.
+	 */
+	Tannotation *Pop()
+	{
+		Tannotation *top = this->At(0);
+		this->positions[top->GetNode()] = INVALID_POSITION;
+		Tannotation *last = this->At((uint)this->heap.size() - 1);
+		this->heap.pop_back();
+		if (last != top) {
+			this->Place(0, last);
+			this->SiftDown(0);
+		}
+		return top;
+	}
+
+	/**
+	 * Insert an annotation into the queue or, if it is queued already, move it
+	 * to the right position after its value has changed.
+	 * @param anno Annotation.
+	 */
+	void Update(Tannotation *anno)
+	{
+		uint pos = this->positions[anno->GetNode()];
+		if (pos == INVALID_POSITION) {
+			pos = (uint)this->heap.size();
+			this->heap.push_back(anno);
+		}
+		if (this->SiftUp(pos) == pos) this->SiftDown(pos);
+	}
 };
 
 /**
@@ -258,26 +409,24 @@ bool CapacityAnnotation::IsBetter(const CapacityAnnotation *base, uint cap,
 template<class Tannotation, class Tedge_iterator>
 void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 {
-	typedef std::set<Tannotation *, typename Tannotation::Comparator> AnnoSet;
 	Tedge_iterator iter(this->job);
 	uint size = this->job.Size();
-	AnnoSet annos;
+	AnnotationQueue<Tannotation> annos(this->queue, this->queue_positions, size);
 	paths.resize(size, NULL);
 	for (NodeID node = 0; node < size; ++node) {
 		Tannotation *anno = new Tannotation(node, node == source_node);
 		anno->UpdateAnnotation();
-		annos.insert(anno);
+		annos.Update(anno);
 		paths[node] = anno;
 	}
-	while (!annos.empty()) {
-		typename AnnoSet::iterator i = annos.begin();
-		Tannotation *source = *i;
-		annos.erase(i);
+	while (!annos.IsEmpty()) {
+		Tannotation *source = annos.Pop();
 		NodeID from = source->GetNode();
+		TileIndex from_xy = this->job[from].XY();
 		iter.SetNode(source_node, from);
 		for (NodeID to = iter.Next(); to != INVALID_NODE; to = iter.Next()) {
 			if (to == from) continue; // Not a real edge but a consumption sign.
-			Edge edge = this->job[from][to];
+			Edge edge = iter.GetEdge(from, to);
 			uint capacity = edge.Capacity();
 			if (this->max_saturation != UINT_MAX) {
 				capacity *= this->max_saturation;
@@ -285,13 +434,12 @@ void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 				if (capacity == 0) capacity = 1;
 			}
 			/* punish in-between stops a little */
-			uint distance = DistanceMaxPlusManhattan(this->job[from].XY(), this->job[to].XY()) + 1;
+			uint distance = DistanceMaxPlusManhattan(from_xy, this->job[to].XY()) + 1;
 			Tannotation *dest = static_cast<Tannotation *>(paths[to]);
 			if (dest->IsBetter(source, capacity, capacity - edge.Flow(), distance)) {
-				annos.erase(dest);
 				dest->Fork(source, capacity, capacity - edge.Flow(), distance);
 				dest->UpdateAnnotation();
-				annos.insert(dest);
+				annos.Update(dest);
 			}
 		}
 	}
@@ -325,21 +473,21 @@ void MultiCommodityFlow::CleanupPaths(NodeID source_id, PathVector &paths)
 }
 
 /**
- * Push flow along a path and update the unsatisfied_demand of the associated
- * edge.
- * @param edge Edge whose ends the path connects.
+ * Push flow along a path and update the unsatisfied demand of the associated
+ * pair of nodes.
+ * @param demand Demand between the nodes the path connects.
  * @param path End of the path the flow should be pushed on.
  * @param accuracy Accuracy of the calculation.
  * @param max_saturation If < UINT_MAX only push flow up to the given
  *                       saturation, otherwise the path can be "overloaded".
  */
-uint MultiCommodityFlow::PushFlow(Edge &edge, Path *path, uint accuracy,
+uint MultiCommodityFlow::PushFlow(DemandAnnotation &demand, Path *path, uint accuracy,
 		uint max_saturation)
 {
-	assert(edge.UnsatisfiedDemand() > 0);
-	uint flow = Clamp(edge.Demand() / accuracy, 1, edge.UnsatisfiedDemand());
+	assert(demand.unsatisfied_demand > 0);
+	uint flow = Clamp(demand.demand / accuracy, 1, demand.unsatisfied_demand);
 	flow = path->AddFlow(flow, this->job, max_saturation);
-	edge.SatisfyDemand(flow);
+	demand.Satisfy(flow);
 	return flow;
 }
 
@@ -501,22 +649,23 @@ MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 			/* First saturate the shortest paths. */
 			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(source, paths);
 
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = job[source][dest];
-				if (edge.UnsatisfiedDemand() > 0) {
-					Path *path = paths[dest];
+			DemandAnnotationVector &demands = job[source].Demands();
+			for (DemandAnnotationVector::iterator it = demands.begin(); it != demands.end(); ++it) {
+				DemandAnnotation &demand = *it;
+				if (demand.unsatisfied_demand > 0) {
+					Path *path = paths[demand.dest];
 					assert(path != NULL);
 					/* Generally only allow paths that don't exceed the
 					 * available capacity. But if no demand has been assigned
 					 * yet, make an exception and allow any valid path *once*. */
-					if (path->GetFreeCapacity() > 0 && this->PushFlow(edge, path,
+					if (path->GetFreeCapacity() > 0 && this->PushFlow(demand, path,
 							accuracy, this->max_saturation) > 0) {
 						/* If a path has been found there is a chance we can
 						 * find more. */
-						more_loops = more_loops || (edge.UnsatisfiedDemand() > 0);
-					} else if (edge.UnsatisfiedDemand() == edge.Demand() &&
+						more_loops = more_loops || (demand.unsatisfied_demand > 0);
+					} else if (demand.unsatisfied_demand == demand.demand &&
 							path->GetFreeCapacity() > INT_MIN) {
-						this->PushFlow(edge, path, accuracy, UINT_MAX);
+						this->PushFlow(demand, path, accuracy, UINT_MAX);
 					}
 				}
 			}
@@ -541,12 +690,13 @@ MCF2ndPass::MCF2ndPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 		demand_left = false;
 		for (NodeID source = 0; source < size; ++source) {
 			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(source, paths);
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = this->job[source][dest];
-				Path *path = paths[dest];
-				if (edge.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
-					this->PushFlow(edge, path, accuracy, UINT_MAX);
-					if (edge.UnsatisfiedDemand() > 0) demand_left = true;
+			DemandAnnotationVector &demands = this->job[source].Demands();
+			for (DemandAnnotationVector::iterator it = demands.begin(); it != demands.end(); ++it) {
+				DemandAnnotation &demand = *it;
+				Path *path = paths[demand.dest];
+				if (demand.unsatisfied_demand > 0 && path->GetFreeCapacity() > INT_MIN) {
+					this->PushFlow(demand, path, accuracy, UINT_MAX);
+					if (demand.unsatisfied_demand > 0) demand_left = true;
 				}
 			}
 			this->CleanupPaths(source, paths);
@@ -24,12 +24,14 @@ protected:
 	template<class Tannotation, class Tedge_iterator>
 	void Dijkstra(NodeID from, PathVector &paths);
 
-	uint PushFlow(Edge &edge, Path *path, uint accuracy, uint max_saturation);
+	uint PushFlow(DemandAnnotation &demand, Path *path, uint accuracy, uint max_saturation);
 
 	void CleanupPaths(NodeID source, PathVector &paths);
 
-	LinkGraphJob &job;   ///< Job we're working with.
-	uint max_saturation; ///< Maximum saturation for edges.
+	LinkGraphJob &job;                 ///< Job we're working with.
+	uint max_saturation;               ///< Maximum saturation for edges.
+	PathVector queue;                  ///< Heap of annotations for Dijkstra, kept to reuse its storage.
+	std::vector<uint> queue_positions; ///< Position of each node's annotation in the heap.
 };
 
 /**
@@ -14,6 +14,8 @@
 #include "core/alloc_func.hpp"
 #include "water_map.h"
 #include "string_func.h"
+#include "vehicle_func.h"
+#include "pathfinder/pf_performance_timer.hpp"
 
 #include "safeguards.h"
 
@@ -29,8 +31,13 @@ uint _map_size_y;    ///< Size of the map along the Y
 uint _map_size;      ///< The number of tiles on the map
 uint _map_tile_mask; ///< _map_size - 1 (to mask the mapsize)
 
+#if defined(WITH_TILED_MAP)
+TiledMapArray<Tile> _m;          ///< Tiles of the map
+TiledMapArray<TileExtended> _me; ///< Extended Tiles of the map
+#else
 Tile *_m = NULL;          ///< Tiles of the map
 TileExtended *_me = NULL; ///< Extended Tiles of the map
+#endif
 
 
 /**
@@ -63,6 +70,144 @@ void AllocateMap(uint size_x, uint size_y)
 
 	_m = CallocT<Tile>(_map_size);
 	_me = CallocT<TileExtended>(_map_size);
+
+	/* The vehicle tile hash is scaled to the map. */
+	ResetVehicleHash();
+}
+
+/**
+ * Read the data of a tile that most map accessors need.
+ * @param tile The tile to read.
+ * @return Some combination of the data, to not let the reads be optimised away.
+ */
+static inline uint32 BenchmarkReadTile(TileIndex tile)
+{
+	return _m[tile].type + _m[tile].height + _m[tile].m5 + _me[tile].m6;
+}
+
+/**
+ * Visit the tiles in the order of the tile loop, i.e. #RunTileLoop,
+ * and read each tile and its four neighbours.
+ * @return Checksum of the read data.
+ */
+static uint32 BenchmarkMapTileLoop()
+{
+	static const uint32 feedbacks[] = {
+		0xD8F, 0x1296, 0x2496, 0x4357, 0x8679, 0x1030E, 0x206CD, 0x403FE, 0x807B8, 0x1004B2, 0x2006A8, 0x4004B2, 0x800B87
+	};
+	const uint32 feedback = feedbacks[MapLogX() + MapLogY() - 2 * MIN_MAP_SIZE_BITS];
+
+	uint32 checksum = 0;
+	TileIndex tile = 1;
+	do {
+		checksum += BenchmarkReadTile(tile);
+		checksum += BenchmarkReadTile(TILE_MASK(tile + TileDiffXY(1, 0)));
+		checksum += BenchmarkReadTile(TILE_MASK(tile + TileDiffXY(-1, 0)));
+		checksum += BenchmarkReadTile(TILE_MASK(tile + TileDiffXY(0, 1)));
+		checksum += BenchmarkReadTile(TILE_MASK(tile + TileDiffXY(0, -1)));
+		tile = (tile >> 1) ^ (-(int32)(tile & 1) & feedback);
+	} while (tile != 1);
+	return checksum;
+}
+
+/**
+ * Visit all tiles in the order the viewport draws them: row after row
+ * of tiles with the same X + Y.
+ * @return Checksum of the read data.
+ */
+static uint32 BenchmarkMapViewport()
+{
+	uint32 checksum = 0;
+	for (uint row = 0; row <= MapMaxX() + MapMaxY(); row++) {
+		uint x_min = row > MapMaxY() ? row - MapMaxY() : 0;
+		uint x_max = min(row, MapMaxX());
+		for (uint x = x_min; x <= x_max; x++) {
+			checksum += BenchmarkReadTile(TileXY(x, row - x));
+		}
+	}
+	return checksum;
+}
+
+/**
+ * Visit the tiles breadth first from the centre of the map, like a
+ * pathfinder that does not find its destination.
+ * @return Checksum of the read data.
+ */
+static uint32 BenchmarkMapPathfinder()
+{
+	/* Visit up to a million tiles, which is about as far as a pathfinder goes. */
+	uint count = min<uint>(MapSize(), 1 << 20);
+	TileIndex *queue = MallocT<TileIndex>(count);
+	uint32 *visited = CallocT<uint32>(MapSize() / 32);
+
+	static const TileIndexDiffC neighbours[] = { {1, 0}, {0, 1}, {-1, 0}, {0, -1} };
+
+	uint32 checksum = 0;
+	uint head = 0;
+	uint tail = 0;
+	queue[tail++] = TileXY(MapSizeX() / 2, MapSizeY() / 2);
+	SetBit(visited[queue[0] / 32], queue[0] % 32);
+	while (head != tail) {
+		TileIndex tile = queue[head++];
+		for (uint i = 0; i < lengthof(neighbours); i++) {
+			TileIndex next = TILE_MASK(tile + ToTileIndexDiff(neighbours[i]));
+			checksum += BenchmarkReadTile(next);
+			if (tail == count || HasBit(visited[next / 32], next % 32)) continue;
+			SetBit(visited[next / 32], next % 32);
+			queue[tail++] = next;
+		}
+	}
+
+	free(visited);
+	free(queue);
+	return checksum;
+}
+
+/**
+ * Visit squares of tiles around tiles spread over the map, like the
+ * catchment area of stations and the surroundings of industries.
+ * @return Checksum of the read data.
+ */
+static uint32 BenchmarkMapCatchment()
+{
+	static const uint RADIUS = 10; ///< Largest catchment radius of a station.
+	static const uint SPACING = 32; ///< Distance between the centres of the squares.
+
+	uint32 checksum = 0;
+	for (uint cy = RADIUS; cy + RADIUS < MapSizeY(); cy += SPACING) {
+		for (uint cx = RADIUS; cx + RADIUS < MapSizeX(); cx += SPACING) {
+			for (uint y = cy - RADIUS; y <= cy + RADIUS; y++) {
+				for (uint x = cx - RADIUS; x <= cx + RADIUS; x++) {
+					checksum += BenchmarkReadTile(TileXY(x, y));
+				}
+			}
+		}
+	}
+	return checksum;
+}
+
+/**
+ * Measure how fast the map arrays are accessed in the patterns of the
+ * tile loop, viewport drawing, pathfinders and catchment searches, to
+ * compare the layouts of the map arrays. The map is only read.
+ * @param repeats Number of times to repeat each pattern.
+ * @param[out] time The time in microseconds spent on each #MapBenchmark pattern, as measured by #CPerformanceTimer.
+ * @param[out] checksum Checksum of all read data; equal for all layouts.
+ */
+void BenchmarkMapAccess(uint repeats, uint64 *time, uint32 *checksum)
+{
+	typedef uint32 (*BenchmarkProc)();
+	static const BenchmarkProc procs[] = { &BenchmarkMapTileLoop, &BenchmarkMapViewport, &BenchmarkMapPathfinder, &BenchmarkMapCatchment };
+	assert_compile(lengthof(procs) == MB_END);
+
+	*checksum = 0;
+	for (uint i = 0; i < MB_END; i++) {
+		CPerformanceTimer timer;
+		timer.Start();
+		for (uint r = 0; r < repeats; r++) *checksum += procs[i]();
+		timer.Stop();
+		time[i] = timer.Get(1000000);
+	}
 }
 
 
@@ -27,6 +27,47 @@ extern uint _map_tile_mask;
 
 #define TILE_MASK(x) ((x) & _map_tile_mask)
 
+#if defined(WITH_TILED_MAP)
+
+static const uint MAP_BLOCK_BITS = 4;                   ///< Size of the blocks of tiles in the map arrays is 2 ^ MAP_BLOCK_BITS.
+static const uint MAP_BLOCK_SIZE = 1 << MAP_BLOCK_BITS; ///< Size of the blocks of tiles in the map arrays.
+
+/**
+ * Array with an item for every tile of the map, stored in blocks of
+ * #MAP_BLOCK_SIZE x #MAP_BLOCK_SIZE tiles instead of row after row.
+ * Tiles that are near each other in the Y direction are then near each
+ * other in memory as well. Tile indices are not affected, only where the
+ * item of a tile is stored. Enabled by configuring with --enable-tiled-map.
+ * @tparam T The type of the items.
+ */
+template <typename T>
+struct TiledMapArray {
+	T *data; ///< The items of the tiles, block after block.
+
+	/**
+	 * Get the position of the item of a tile in the storage.
+	 * @param tile The tile to get the position of.
+	 * @return The index of the item in #data.
+	 */
+	static inline uint GetStorageIndex(TileIndex tile)
+	{
+		extern uint _map_log_x;
+		uint x = tile & ((1 << _map_log_x) - 1);
+		uint y = tile >> _map_log_x;
+		return (tile & ~((MAP_BLOCK_SIZE << _map_log_x) - 1)) | (x & ~(MAP_BLOCK_SIZE - 1)) << MAP_BLOCK_BITS |
+				(y & (MAP_BLOCK_SIZE - 1)) << MAP_BLOCK_BITS | (x & (MAP_BLOCK_SIZE - 1));
+	}
+
+	inline T &operator[](TileIndex tile) const { return this->data[GetStorageIndex(tile)]; }
+	inline operator T *() const { return this->data; }
+	inline TiledMapArray &operator=(T *data) { this->data = data; return *this; }
+};
+
+extern TiledMapArray<Tile> _m;
+extern TiledMapArray<TileExtended> _me;
+
+#else /* WITH_TILED_MAP */
+
 /**
  * Pointer to the tile-array.
  *
@@ -43,8 +84,21 @@ extern Tile *_m;
  */
 extern TileExtended *_me;
 
+#endif /* WITH_TILED_MAP */
+
 void AllocateMap(uint size_x, uint size_y);
 
+/** Access patterns of the map arrays that are measured by #BenchmarkMapAccess. */
+enum MapBenchmark {
+	MB_TILE_LOOP,  ///< Tiles in the order of the tile loop, with their neighbours.
+	MB_VIEWPORT,   ///< Tiles in the rows of the viewport.
+	MB_PATHFINDER, ///< Tiles in breadth first order from the centre of the map.
+	MB_CATCHMENT,  ///< Squares of tiles around tiles spread over the map.
+	MB_END,
+};
+
+void BenchmarkMapAccess(uint repeats, uint64 *time, uint32 *checksum);
+
 /**
  * Logarithm of the map size along the X side.
  * @note try to avoid using this one
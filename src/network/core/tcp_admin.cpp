@@ -94,6 +94,8 @@ NetworkRecvStatus NetworkAdminSocketHandler::HandlePacket(Packet *p)
 		case ADMIN_PACKET_SERVER_CMD_LOGGING:     return this->Receive_SERVER_CMD_LOGGING(p);
 		case ADMIN_PACKET_SERVER_RCON_END:        return this->Receive_SERVER_RCON_END(p);
 		case ADMIN_PACKET_SERVER_PONG:            return this->Receive_SERVER_PONG(p);
+		case ADMIN_PACKET_SERVER_PATHFINDER:      return this->Receive_SERVER_PATHFINDER(p);
+		case ADMIN_PACKET_SERVER_PATHFINDER_VEHICLE: return this->Receive_SERVER_PATHFINDER_VEHICLE(p);
 
 		default:
 			if (this->HasClientQuit()) {
@@ -172,5 +174,7 @@ NetworkRecvStatus NetworkAdminSocketHandler::Receive_SERVER_CMD_NAMES(Packet *p)
 NetworkRecvStatus NetworkAdminSocketHandler::Receive_SERVER_CMD_LOGGING(Packet *p) { return this->ReceiveInvalidPacket(ADMIN_PACKET_SERVER_CMD_LOGGING); }
 NetworkRecvStatus NetworkAdminSocketHandler::Receive_SERVER_RCON_END(Packet *p) { return this->ReceiveInvalidPacket(ADMIN_PACKET_SERVER_RCON_END); }
 NetworkRecvStatus NetworkAdminSocketHandler::Receive_SERVER_PONG(Packet *p) { return this->ReceiveInvalidPacket(ADMIN_PACKET_SERVER_PONG); }
+NetworkRecvStatus NetworkAdminSocketHandler::Receive_SERVER_PATHFINDER(Packet *p) { return this->ReceiveInvalidPacket(ADMIN_PACKET_SERVER_PATHFINDER); }
+NetworkRecvStatus NetworkAdminSocketHandler::Receive_SERVER_PATHFINDER_VEHICLE(Packet *p) { return this->ReceiveInvalidPacket(ADMIN_PACKET_SERVER_PATHFINDER_VEHICLE); }
 
 #endif /* ENABLE_NETWORK */
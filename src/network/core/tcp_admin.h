@@ -63,6 +63,8 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_PATHFINDER,      ///< The server gives the admin the profile of the pathfinders by vehicle type.
+	ADMIN_PACKET_SERVER_PATHFINDER_VEHICLE, ///< The server gives the admin the profile of the pathfinders for a vehicle.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -86,6 +88,7 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_PATHFINDER,      ///< The admin would like to have the profiles of the pathfinders.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
@@ -481,6 +484,42 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_RCON_END(Packet *p);
 
+	/**
+	 * Send the counters of the pathfinder searches of one vehicle type and
+	 * pathfinder during an interval of the profiling:
+	 * uint32  First day of the interval.
+	 * uint32  First day after the interval.
+	 * uint8   Vehicle type (0 = train, 1 = road vehicle, 2 = ship).
+	 * uint8   Pathfinder (0 = OPF, 1 = NPF, 2 = YAPF).
+	 * uint32  Number of searches.
+	 * uint32  Number of searches answered from a cache.
+	 * uint32  Number of searches stopped at the maximum number of nodes.
+	 * uint64  Number of expanded nodes.
+	 * uint64  Time spent searching in microseconds (wall clock time).
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_PATHFINDER(Packet *p);
+
+	/**
+	 * Send the counters of the pathfinder searches of one of the vehicles
+	 * that expanded the most nodes during an interval of the profiling:
+	 * uint32  First day of the interval.
+	 * uint32  First day after the interval.
+	 * uint32  ID of the vehicle.
+	 * uint8   Vehicle type (0 = train, 1 = road vehicle, 2 = ship).
+	 * uint16  Unit number of the vehicle.
+	 * uint8   ID of the company owning the vehicle.
+	 * uint32  Number of searches.
+	 * uint32  Number of searches answered from a cache.
+	 * uint32  Number of searches stopped at the maximum number of nodes.
+	 * uint64  Number of expanded nodes.
+	 * uint64  Time spent searching in microseconds (wall clock time).
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_PATHFINDER_VEHICLE(Packet *p);
+
 	NetworkRecvStatus HandlePacket(Packet *p);
 public:
 	NetworkRecvStatus CloseConnection(bool error = true);
@@ -24,6 +24,7 @@
 #include "../map_func.h"
 #include "../rev.h"
 #include "../game/game.hpp"
+#include "../pathfinder/pf_profile.h"
 
 #include "../safeguards.h"
 
@@ -56,6 +57,7 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_PATHFINDER
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
@@ -599,6 +601,58 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendGameScript(const char *js
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Send the counters of an interval of the profiling of the pathfinders.
+ * @param profile The counters to send.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendPathfinderProfile(const PathfinderProfile *profile)
+{
+	for (uint type = 0; type < VEH_COMPANY_END; type++) {
+		for (uint pf = 0; pf < PF_PROFILE_PATHFINDERS; pf++) {
+			const PathfinderStats &stats = profile->totals[type][pf];
+			if (stats.calls == 0) continue;
+
+			Packet *p = new Packet(ADMIN_PACKET_SERVER_PATHFINDER);
+
+			p->Send_uint32(profile->start);
+			p->Send_uint32(profile->end);
+			p->Send_uint8 (type);
+			p->Send_uint8 (pf);
+			p->Send_uint32(stats.calls);
+			p->Send_uint32(stats.cache_hits);
+			p->Send_uint32(stats.aborts);
+			p->Send_uint64(stats.nodes);
+			p->Send_uint64(stats.time);
+
+			this->SendPacket(p);
+		}
+	}
+
+	const PathfinderProfile::VehicleMap::value_type *worst[PF_PROFILE_WORST_VEHICLES];
+	uint count = profile->GetWorstVehicles(worst, lengthof(worst));
+	for (uint i = 0; i < count; i++) {
+		const PathfinderVehicleStats &stats = worst[i]->second;
+
+		Packet *p = new Packet(ADMIN_PACKET_SERVER_PATHFINDER_VEHICLE);
+
+		p->Send_uint32(profile->start);
+		p->Send_uint32(profile->end);
+		p->Send_uint32(worst[i]->first);
+		p->Send_uint8 (stats.type);
+		p->Send_uint16(stats.unitnumber);
+		p->Send_uint8 (stats.owner);
+		p->Send_uint32(stats.calls);
+		p->Send_uint32(stats.cache_hits);
+		p->Send_uint32(stats.aborts);
+		p->Send_uint64(stats.nodes);
+		p->Send_uint64(stats.time);
+
+		this->SendPacket(p);
+	}
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /** Send ping-reply (pong) to admin **/
 NetworkRecvStatus ServerNetworkAdminSocketHandler::SendPong(uint32 d1)
 {
@@ -778,6 +832,15 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCmdNames();
 			break;
 
+		case ADMIN_UPDATE_PATHFINDER:
+			/* The admin is requesting the last finished (d1 == 0) or the running interval of the pathfinder profile. */
+			if (d1 != 0) {
+				if (_pf_profiling.enabled) this->SendPathfinderProfile(&_pf_profiling.current);
+			} else {
+				if (_pf_profiling.has_last) this->SendPathfinderProfile(&_pf_profiling.last);
+			}
+			break;
+
 		default:
 			/* An unsupported "poll" update type. */
 			DEBUG(net, 3, "[admin] Not supported poll %d (%d) from '%s' (%s).", type, d1, this->admin_name, this->admin_version);
@@ -1004,6 +1067,21 @@ void NetworkAdminCmdLogging(const NetworkClientSocket *owner, const CommandPacke
 	}
 }
 
+/**
+ * Send the counters of a finished interval of the profiling of the pathfinders
+ * to the admin network (if they did opt in for the respective update).
+ * @param profile The counters of the interval.
+ */
+void NetworkAdminPathfinderProfile(const PathfinderProfile *profile)
+{
+	ServerNetworkAdminSocketHandler *as;
+	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
+		if (as->update_frequency[ADMIN_UPDATE_PATHFINDER] & ADMIN_FREQUENCY_AUTOMATIC) {
+			as->SendPathfinderProfile(profile);
+		}
+	}
+}
+
 /**
  * Send a Welcome packet to all connected admins
  */
@@ -72,6 +72,7 @@ public:
 	NetworkRecvStatus SendCmdNames();
 	NetworkRecvStatus SendCmdLogging(ClientID client_id, const CommandPacket *cp);
 	NetworkRecvStatus SendRconEnd(const char *command);
+	NetworkRecvStatus SendPathfinderProfile(const struct PathfinderProfile *profile);
 
 	static void Send();
 	static void AcceptConnection(SOCKET s, const NetworkAddress &address);
@@ -123,6 +124,7 @@ void NetworkServerSendAdminRcon(AdminIndex admin_index, TextColour colour_code,
 void NetworkAdminConsole(const char *origin, const char *string);
 void NetworkAdminGameScript(const char *json);
 void NetworkAdminCmdLogging(const NetworkClientSocket *owner, const CommandPacket *cp);
+void NetworkAdminPathfinderProfile(const struct PathfinderProfile *profile);
 
 #endif /* ENABLE_NETWORK */
 #endif /* NETWORK_ADMIN_H */
@@ -54,19 +54,27 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
+/** The savegame that is being sent to the clients currently downloading the map. */
+static struct PacketWriter *_network_map_savegame = NULL;
+
+/**
+ * Writing a savegame directly to a number of packets. The savegame is made
+ * only once for all clients that start downloading the map in the same frame;
+ * every client keeps track of its own position within the packets, which are
+ * never changed after they have been made. The writer is destroyed when the
+ * last client has stopped reading from it.
+ */
 struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
+	uint32 frame;                       ///< The frame in which the savegame was made.
+	uint clients;                       ///< Number of clients still reading from this savegame.
 	Packet *current;                    ///< The packet we're currently writing to.
 	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
+	bool finished;                      ///< Whether the savegame has been written completely.
+	SmallVector<Packet *, 256> packets; ///< Packets of the savegame; send copies of these "slowly" to the clients.
 	ThreadMutex *mutex;                 ///< Mutex for making threaded saving safe.
 
-	/**
-	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
-	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(NULL), cs(cs), current(NULL), total_size(0), packets(NULL)
+	/** Create the packet writer for the current frame. */
+	PacketWriter() : SaveFilter(NULL), frame(_frame_counter), clients(0), current(NULL), total_size(0), finished(false)
 	{
 		this->mutex = ThreadMutex::New();
 	}
@@ -76,16 +84,14 @@ struct PacketWriter : SaveFilter {
 	{
 		if (this->mutex != NULL) this->mutex->BeginCritical();
 
-		if (this->cs != NULL && this->mutex != NULL) {
+		if (this->clients != 0 && this->mutex != NULL) {
 			this->mutex->WaitForSignal();
 		}
 
-		/* This must all wait until the Destroy function is called. */
+		/* This must all wait until the last client called Release. */
 
-		while (this->packets != NULL) {
-			Packet *p = this->packets->next;
-			delete this->packets;
-			this->packets = p;
+		for (Packet **p = this->packets.Begin(); p != this->packets.End(); p++) {
+			delete *p;
 		}
 
 		delete this->current;
@@ -96,26 +102,39 @@ struct PacketWriter : SaveFilter {
 		this->mutex = NULL;
 	}
 
+	/** Let one more client read from this savegame. */
+	void AddClient()
+	{
+		if (this->mutex != NULL) this->mutex->BeginCritical();
+
+		this->clients++;
+
+		if (this->mutex != NULL) this->mutex->EndCritical();
+	}
+
 	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to NULL, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
-	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
+	 * A client stops reading from this savegame. When it is the last one, the
+	 * destruction of this packet writer begins. It can happen in two ways: in
+	 * the first case the saving has not finished yet, in which case the
+	 * appending will fail due to there not being any clients and eventually
+	 * that triggers the destructor. In the second case the destructor is
+	 * already called, and it is waiting for our signal which we will send.
+	 * Only then the packets will be removed by the destructor.
 	 */
-	void Destroy()
+	void Release()
 	{
 		if (this->mutex != NULL) this->mutex->BeginCritical();
 
-		this->cs = NULL;
+		assert(this->clients != 0);
+		bool last = --this->clients == 0;
+		if (last && _network_map_savegame == this) _network_map_savegame = NULL;
 
-		if (this->mutex != NULL) this->mutex->SendSignal();
+		if (last && this->mutex != NULL) this->mutex->SendSignal();
 
 		if (this->mutex != NULL) this->mutex->EndCritical();
 
+		if (!last) return;
+
 		/* Make sure the saving is completely cancelled. Yes,
 		 * we need to handle the save finish as well as the
 		 * next connection might just be requesting a map. */
@@ -124,51 +143,50 @@ struct PacketWriter : SaveFilter {
 	}
 
 	/**
-	 * Checks whether there are packets.
-	 * It's not 100% threading safe, but this is only asked for when checking
-	 * whether there still is something to send. Then another call will be made
-	 * to actually get the Packet, which will be the only one popping packets
-	 * and thus eventually setting this on false.
+	 * Checks whether the savegame has been written completely.
+	 * It's not 100% threading safe, but once set this is never reset.
 	 */
-	bool HasPackets()
+	bool IsFinished()
 	{
-		return this->packets != NULL;
+		return this->finished;
 	}
 
 	/**
-	 * Pop a single created packet from the queue with packets.
+	 * Make a copy of one of the created packets, so it can be queued to a client.
+	 * @param index The index of the packet within the savegame.
+	 * @return The copy of the packet, or NULL when it has not been created yet.
 	 */
-	Packet *PopPacket()
+	Packet *CopyPacket(uint index)
 	{
 		if (this->mutex != NULL) this->mutex->BeginCritical();
 
-		Packet *p = this->packets;
-		this->packets = p->next;
-		p->next = NULL;
+		Packet *p = NULL;
+		if (index < this->packets.Length()) {
+			const Packet *source = this->packets[index];
+			p = new Packet(source->buffer[sizeof(PacketSize)]);
+			memcpy(p->buffer, source->buffer, source->size);
+			p->size = source->size;
+		}
 
 		if (this->mutex != NULL) this->mutex->EndCritical();
 
 		return p;
 	}
 
-	/** Append the current packet to the queue. */
+	/** Append the current packet to the list of packets. */
 	void AppendQueue()
 	{
 		if (this->current == NULL) return;
 
-		Packet **p = &this->packets;
-		while (*p != NULL) {
-			p = &(*p)->next;
-		}
-		*p = this->current;
+		*this->packets.Append() = this->current;
 
 		this->current = NULL;
 	}
 
 	/* virtual */ void Write(byte *buf, size_t size)
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		/* We want to abort the saving when all sockets are closed. */
+		if (this->clients == 0) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
 		if (this->current == NULL) this->current = new Packet(PACKET_SERVER_MAP_DATA);
 
@@ -194,8 +212,8 @@ struct PacketWriter : SaveFilter {
 
 	/* virtual */ void Finish()
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		/* We want to abort the saving when all sockets are closed. */
+		if (this->clients == 0) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
 		if (this->mutex != NULL) this->mutex->BeginCritical();
 
@@ -206,10 +224,8 @@ struct PacketWriter : SaveFilter {
 		this->current = new Packet(PACKET_SERVER_MAP_DONE);
 		this->AppendQueue();
 
-		/* Fast-track the size to the client. */
-		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
-		p->Send_uint32((uint32)this->total_size);
-		this->cs->NetworkTCPSocketHandler::SendPacket(p);
+		/* The clients fast-track the size themselves. */
+		this->finished = true;
 
 		if (this->mutex != NULL) this->mutex->EndCritical();
 	}
@@ -241,7 +257,7 @@ ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 	OrderBackup::ResetUser(this->client_id);
 
 	if (this->savegame != NULL) {
-		this->savegame->Destroy();
+		this->savegame->Release();
 		this->savegame = NULL;
 	}
 }
@@ -575,15 +591,21 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
 /** This sends the map to the client */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 {
-	static uint sent_packets; // How many packets we did send successfully last time
-
 	if (this->status < STATUS_AUTHORIZED) {
 		/* Illegal call, return error and ignore the packet */
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
+		/* Everyone starting to download in the same frame shares a single savegame. */
+		bool new_savegame = _network_map_savegame == NULL;
+		if (new_savegame) _network_map_savegame = new PacketWriter();
+		assert(_network_map_savegame->frame == _frame_counter);
+
+		this->savegame = _network_map_savegame;
+		this->savegame->AddClient();
+		this->savegame_packet = 0;
+		this->savegame_size_sent = false;
 
 		/* Now send the _frame_counter and how many packets are coming */
 		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
@@ -596,20 +618,35 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 		this->last_frame = _frame_counter;
 		this->last_frame_server = _frame_counter;
 
-		sent_packets = 4; // We start with trying 4 packets
+		this->savegame_window = 4; // We start with trying 4 packets
 
 		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
+		if (new_savegame) {
+			if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
+		} else {
+			DEBUG(net, 1, "Sharing map of frame %d with client %d", this->savegame->frame, this->client_id);
+		}
 	}
 
 	if (this->status == STATUS_MAP) {
 		bool last_packet = false;
 		bool has_packets = false;
 
-		for (uint i = 0; (has_packets = this->savegame->HasPackets()) && i < sent_packets; i++) {
-			Packet *p = this->savegame->PopPacket();
+		for (uint i = 0; i < this->savegame_window; i++) {
+			Packet *p = this->savegame->CopyPacket(this->savegame_packet);
+			if (!(has_packets = p != NULL)) break;
+
+			this->savegame_packet++;
 			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
 
+			/* Fast-track the size to the client once it is known. */
+			if (!this->savegame_size_sent && this->savegame->IsFinished()) {
+				Packet *size = new Packet(PACKET_SERVER_MAP_SIZE);
+				size->Send_uint32((uint32)this->savegame->total_size);
+				this->SendPacket(size);
+				this->savegame_size_sent = true;
+			}
+
 			this->SendPacket(p);
 
 			if (last_packet) {
@@ -619,34 +656,23 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 		}
 
 		if (last_packet) {
-			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
+			/* Done reading, release our reference to the savegame */
+			this->savegame->Release();
 			this->savegame = NULL;
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
 			this->status = STATUS_DONE_MAP;
 
-			/* Find the best candidate for joining, i.e. the first joiner. */
-			NetworkClientSocket *new_cs;
-			NetworkClientSocket *best = NULL;
-			FOR_ALL_CLIENT_SOCKETS(new_cs) {
-				if (new_cs->status == STATUS_MAP_WAIT) {
-					if (best == NULL || best->GetInfo()->join_date > new_cs->GetInfo()->join_date || (best->GetInfo()->join_date == new_cs->GetInfo()->join_date && best->client_id > new_cs->client_id)) {
-						best = new_cs;
-					}
-				}
-			}
-
-			/* Is there someone else to join? */
-			if (best != NULL) {
-				/* Let the first start joining. */
-				best->status = STATUS_AUTHORIZED;
-				best->SendMap();
-
-				/* And update the rest. */
+			/* When nobody is downloading anymore, let all waiting clients
+			 * start downloading together, from a single new savegame. */
+			if (_network_map_savegame == NULL) {
+				NetworkClientSocket *new_cs;
 				FOR_ALL_CLIENT_SOCKETS(new_cs) {
-					if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
+					if (new_cs->status == STATUS_MAP_WAIT) {
+						new_cs->status = STATUS_AUTHORIZED;
+						new_cs->SendMap();
+					}
 				}
 			}
 		}
@@ -657,7 +683,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_ALL_SENT:
 				/* All are sent, increase the sent_packets */
-				if (has_packets) sent_packets *= 2;
+				if (has_packets) this->savegame_window *= 2;
 				break;
 
 			case SPS_PARTLY_SENT:
@@ -666,7 +692,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_NONE_SENT:
 				/* Not everything is sent, decrease the sent_packets */
-				if (sent_packets > 1) sent_packets /= 2;
+				if (this->savegame_window > 1) this->savegame_window /= 2;
 				break;
 		}
 	}
@@ -1017,20 +1043,17 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_COMPANY_PASSWOR
 
 NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_GETMAP(Packet *p)
 {
-	NetworkClientSocket *new_cs;
 	/* The client was never joined.. so this is impossible, right?
 	 *  Ignore the packet, give the client a warning, and close his connection */
 	if (this->status < STATUS_AUTHORIZED || this->HasClientQuit()) {
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
-	/* Check if someone else is receiving the map */
-	FOR_ALL_CLIENT_SOCKETS(new_cs) {
-		if (new_cs->status == STATUS_MAP) {
-			/* Tell the new client to wait */
-			this->status = STATUS_MAP_WAIT;
-			return this->SendWait();
-		}
+	/* Check if someone else is receiving a map that was not made this frame */
+	if (_network_map_savegame != NULL && _network_map_savegame->frame != _frame_counter) {
+		/* Tell the new client to wait */
+		this->status = STATUS_MAP_WAIT;
+		return this->SendWait();
 	}
 
 	/* We receive a request to upload the map.. give it to the client! */
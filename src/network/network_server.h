@@ -60,7 +60,7 @@ public:
 		STATUS_AUTH_GAME,     ///< The client is authorizing with game (server) password.
 		STATUS_AUTH_COMPANY,  ///< The client is authorizing with company password.
 		STATUS_AUTHORIZED,    ///< The client is authorized.
-		STATUS_MAP_WAIT,      ///< The client is waiting as someone else is downloading the map.
+		STATUS_MAP_WAIT,      ///< The client is waiting as someone else is downloading an older map.
 		STATUS_MAP,           ///< The client is downloading the map.
 		STATUS_DONE_MAP,      ///< The client has downloaded the map.
 		STATUS_PRE_ACTIVE,    ///< The client is catching up the delayed frames.
@@ -75,7 +75,10 @@ public:
 	CommandQueue outgoing_queue; ///< The command-queue awaiting delivery
 	int receive_limit;           ///< Amount of bytes that we can receive at this moment
 
-	struct PacketWriter *savegame; ///< Writer used to write the savegame.
+	struct PacketWriter *savegame; ///< Writer used to write the savegame; shared with the other clients downloading it.
+	uint savegame_packet;          ///< Index of the next packet of the savegame to send.
+	uint savegame_window;          ///< How many packets of the savegame to try to send at once.
+	bool savegame_size_sent;       ///< Whether the size of the savegame has been sent.
 	NetworkAddress client_address; ///< IP-address of the client (so he can be banned)
 
 	ServerNetworkGameSocketHandler(SOCKET s);
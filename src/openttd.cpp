@@ -26,6 +26,7 @@
 #include "command_func.h"
 #include "news_func.h"
 #include "fios.h"
+#include "fileio_func.h"
 #include "aircraft.h"
 #include "roadveh.h"
 #include "train.h"
@@ -204,6 +205,8 @@ static void ShowHelp()
 		"  -e                  = Start Editor\n"
 		"  -g [savegame]       = Start new/save game immediately\n"
 		"  -G seed             = Set random seed\n"
+		"  -B batchfile        = Generate a map for each line of batchfile, print\n"
+		"                        the time taken by each generation phase and exit\n"
 #if defined(ENABLE_NETWORK)
 		"  -n [ip:port#company]= Join network game\n"
 		"  -p password         = Password to join server\n"
@@ -536,6 +539,91 @@ struct AfterNewGRFScan : NewGRFScanCallback {
 extern void DedicatedFork();
 #endif
 
+/** Names of the phases of the world generation in the output of a batch. */
+static const char * const _genworld_phase_names[] = {
+	"map_init",
+	"landscape",
+	"river",
+	"rough_rocky",
+	"town",
+	"industry",
+	"object",
+	"tree",
+	"game_init",
+	"tile_loop",
+	"game_script",
+	"game_start",
+};
+assert_compile(lengthof(_genworld_phase_names) == GWP_CLASS_COUNT);
+
+/**
+ * Generate a map for each line of a batch file, and print the time taken by
+ * each phase of the world generation as comma separated values to stdout.
+ * A line holds the seed, or "random", followed by any number of
+ * setting=value pairs that only apply to the map of that line. Empty lines
+ * and lines starting with a '#' are skipped.
+ * @param filename Name of the batch file.
+ * @return True if all maps could be generated.
+ */
+static bool RunGenerateWorldBatch(const char *filename)
+{
+	FILE *f = FioFOpenFile(filename, "r", BASE_DIR);
+	if (f == NULL) {
+		fprintf(stderr, "Failed to open world generation batch '%s'\n", filename);
+		return false;
+	}
+
+	printf("seed,map_x,map_y,landscape,land_generator,result,total_ms");
+	for (uint i = 0; i < GWP_CLASS_COUNT; i++) printf(",%s_ms", _genworld_phase_names[i]);
+	printf("\n");
+
+	bool success = true;
+	char line[1024];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		/* Split the line at white space. */
+		char *tokens[64];
+		uint count = 0;
+		for (char *p = line; *p != '\0' && count < lengthof(tokens); p++) {
+			if (strchr(" \t\r\n", *p) != NULL) {
+				*p = '\0';
+			} else if (p == line || p[-1] == '\0') {
+				tokens[count++] = p;
+			}
+		}
+		if (count == 0 || tokens[0][0] == '#') continue;
+
+		GameSettings backup = _settings_newgame;
+		_settings_newgame.game_creation.generation_seed = strcmp(tokens[0], "random") == 0 ? GENERATE_NEW_SEED : strtoul(tokens[0], NULL, 10);
+		for (uint i = 1; i < count; i++) {
+			char *value = strchr(tokens[i], '=');
+			if (value == NULL) {
+				fprintf(stderr, "Ignoring '%s' in world generation batch; expected setting=value\n", tokens[i]);
+				continue;
+			}
+			*value++ = '\0';
+			IConsoleSetSetting(tokens[i], value, true);
+		}
+
+		MakeNewgameSettingsLive();
+		SwitchToMode(SM_NEWGAME);
+		bool generated = _game_mode == GM_NORMAL;
+		if (!generated) success = false;
+
+		const GameCreationSettings &gc = _settings_newgame.game_creation;
+		uint64 total = 0;
+		for (uint i = 0; i < GWP_CLASS_COUNT; i++) total += GetGeneratingWorldPhaseTime((GenWorldProgress)i);
+		printf("%u,%u,%u,%u,%u,%s,%.3f", gc.generation_seed, gc.map_x, gc.map_y, gc.landscape, gc.land_generator, generated ? "ok" : "failed", total / 1000.0);
+		for (uint i = 0; i < GWP_CLASS_COUNT; i++) printf(",%.3f", GetGeneratingWorldPhaseTime((GenWorldProgress)i) / 1000.0);
+		printf("\n");
+		fflush(stdout);
+
+		_settings_newgame = backup;
+	}
+
+	FioFCloseFile(f);
+	return success;
+}
+
 /** Options of OpenTTD. */
 static const OptionData _options[] = {
 	 GETOPT_SHORT_VALUE('I'),
@@ -561,6 +649,7 @@ static const OptionData _options[] = {
 	 GETOPT_SHORT_NOVAL('e'),
 	GETOPT_SHORT_OPTVAL('g'),
 	 GETOPT_SHORT_VALUE('G'),
+	 GETOPT_SHORT_VALUE('B'),
 	 GETOPT_SHORT_VALUE('c'),
 	 GETOPT_SHORT_NOVAL('x'),
 	 GETOPT_SHORT_VALUE('q'),
@@ -583,6 +672,7 @@ int openttd_main(int argc, char *argv[])
 	char *graphics_set = NULL;
 	char *sounds_set = NULL;
 	char *music_set = NULL;
+	const char *genworld_batch = NULL;
 	Dimension resolution = {0, 0};
 	/* AfterNewGRFScan sets save_config to true after scanning completed. */
 	bool save_config = false;
@@ -709,6 +799,19 @@ int openttd_main(int argc, char *argv[])
 			goto exit_noshutdown;
 		}
 		case 'G': scanner->generation_seed = atoi(mgo.opt); break;
+		case 'B':
+			free(musicdriver);
+			free(sounddriver);
+			free(videodriver);
+			free(blitter);
+			musicdriver = stredup("null");
+			sounddriver = stredup("null");
+			videodriver = stredup("null");
+			blitter = stredup("null");
+			genworld_batch = mgo.opt;
+			/* The settings of the batch must not end up in the configuration. */
+			scanner->save_config = false;
+			break;
 		case 'c': free(_config_file); _config_file = stredup(mgo.opt); break;
 		case 'x': scanner->save_config = false; break;
 		case 'h':
@@ -914,7 +1017,11 @@ int openttd_main(int argc, char *argv[])
 	ScanNewGRFFiles(scanner);
 	scanner = NULL;
 
-	VideoDriver::GetInstance()->MainLoop();
+	if (genworld_batch != NULL) {
+		if (!RunGenerateWorldBatch(genworld_batch)) ret = 1;
+	} else {
+		VideoDriver::GetInstance()->MainLoop();
+	}
 
 	WaitTillSaved();
 
@@ -1479,7 +1586,8 @@ static void DoAutosave()
 	}
 
 	DEBUG(sl, 2, "Autosaving to '%s'", buf);
-	if (SaveOrLoad(buf, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR) != SL_OK) {
+	SaveOrLoadResult result = _settings_client.gui.autosave_snapshot ? SaveSnapshot(buf, AUTOSAVE_DIR) : SaveOrLoad(buf, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR);
+	if (result != SL_OK) {
 		ShowErrorMessage(STR_ERROR_AUTOSAVE_FAILED, INVALID_STRING_ID, WL_ERROR);
 	}
 }
@@ -1510,7 +1618,6 @@ void GameLoop()
 		_switch_mode = SM_NONE;
 	}
 
-	IncreaseSpriteLRU();
 	InteractiveRandom();
 
 	extern int _caret_timer;
@@ -26,6 +26,7 @@
 #include "../../stdafx.h"
 #include "../../core/alloc_func.hpp"
 #include "aystar.h"
+#include "../pf_profile.h"
 
 #include "../../safeguards.h"
 
@@ -259,6 +260,8 @@ int AyStar::Main()
 	}
 #endif
 	if (r != AYSTAR_STILL_BUSY) {
+		PathfinderProfileScope::AddNodes(this->closedlist_hash.GetSize(), r == AYSTAR_LIMIT_REACHED);
+
 		/* We're done, clean up */
 		this->Clear();
 	}
@@ -14,6 +14,7 @@
 #include "../../tunnelbridge.h"
 #include "../../ship.h"
 #include "../../core/random_func.hpp"
+#include "../pf_profile.h"
 
 #include "../../safeguards.h"
 
@@ -30,6 +31,7 @@ struct TrackPathFinder {
 	uint best_length;
 	RememberData rd;
 	TrackdirByte the_dir;
+	uint nodes;          ///< Number of tiles the search entered.
 };
 
 static bool ShipTrackFollower(TileIndex tile, TrackPathFinder *pfs, uint length)
@@ -76,6 +78,7 @@ static void TPFModeShip(TrackPathFinder *tpf, TileIndex tile, DiagDirection dire
 	tile = TILE_MASK(tile + TileOffsByDiagDir(direction));
 
 	if (++tpf->rd.cur_length > 50) return;
+	tpf->nodes++;
 
 	TrackBits bits = TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0)) & DiagdirReachesTracks(direction);
 	if (bits == TRACK_BIT_NONE) return;
@@ -142,6 +145,7 @@ static uint FindShipTrack(const Ship *v, TileIndex tile, DiagDirection dir, Trac
 
 	pfs.dest_coords = v->dest_tile;
 	pfs.skiptile = skiptile;
+	pfs.nodes = 0;
 
 	Track best_track = INVALID_TRACK;
 
@@ -178,6 +182,8 @@ bad:;
 
 	} while (bits != 0);
 
+	PathfinderProfileScope::AddNodes(pfs.nodes, false);
+
 	*track = best_track;
 	return best_bird_dist;
 }
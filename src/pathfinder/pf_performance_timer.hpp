@@ -38,12 +38,12 @@ struct CPerformanceTimer
 
 	inline int64 QueryTime()
 	{
-		return ottd_rdtsc();
+		return GetMicroseconds();
 	}
 
 	inline int64 QueryFrequency()
 	{
-		return ((int64)2200 * 1000000);
+		return 1000000;
 	}
 };
 
@@ -0,0 +1,137 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_profile.cpp Profiling of the searches of the pathfinders. */
+
+#include "../stdafx.h"
+#include "pf_profile.h"
+#include "../vehicle_base.h"
+#include "../date_func.h"
+#include "../network/network_admin.h"
+
+#include "../safeguards.h"
+
+PathfinderProfiling _pf_profiling;
+
+PathfinderProfileScope *PathfinderProfileScope::active = NULL;
+
+/**
+ * Clear the counters for a new interval.
+ * @param start First day of the interval.
+ * @param end First day after the interval.
+ */
+void PathfinderProfile::Reset(Date start, Date end)
+{
+	this->start = start;
+	this->end = end;
+	for (uint type = 0; type < VEH_COMPANY_END; type++) {
+		for (uint pf = 0; pf < PF_PROFILE_PATHFINDERS; pf++) {
+			this->totals[type][pf] = PathfinderStats();
+		}
+	}
+	this->vehicles.clear();
+}
+
+/**
+ * Find the vehicles that expanded the most nodes.
+ * @param worst [out] The vehicles, with the most nodes first.
+ * @param count The maximum number of vehicles to find.
+ * @return The number of vehicles found.
+ */
+uint PathfinderProfile::GetWorstVehicles(const VehicleMap::value_type **worst, uint count) const
+{
+	uint found = 0;
+	for (VehicleMap::const_iterator it = this->vehicles.begin(); it != this->vehicles.end(); ++it) {
+		/* Insert the vehicle in the sorted list, if it belongs there. */
+		uint pos = found;
+		while (pos > 0 && worst[pos - 1]->second.nodes < it->second.nodes) pos--;
+		if (pos == count) continue;
+
+		if (found < count) found++;
+		for (uint i = found - 1; i > pos; i--) worst[i] = worst[i - 1];
+		worst[pos] = &*it;
+	}
+	return found;
+}
+
+/**
+ * Start counting the searches of the pathfinders.
+ * @param interval Length of an interval in days.
+ */
+void StartPathfinderProfiling(uint interval)
+{
+	_pf_profiling.enabled = true;
+	_pf_profiling.interval = interval;
+	_pf_profiling.current.Reset(_date, _date + interval);
+	_pf_profiling.last.Reset(_date, _date);
+	_pf_profiling.has_last = false;
+}
+
+/** Finish the interval in progress, and start the next one. */
+static void FinishPathfinderProfileInterval()
+{
+	_pf_profiling.current.end = _date;
+	_pf_profiling.last = _pf_profiling.current;
+	_pf_profiling.has_last = true;
+	_pf_profiling.current.Reset(_date, _date + _pf_profiling.interval);
+
+#ifdef ENABLE_NETWORK
+	NetworkAdminPathfinderProfile(&_pf_profiling.last);
+#endif /* ENABLE_NETWORK */
+}
+
+/** Stop counting the searches of the pathfinders; the interval in progress is finished early. */
+void StopPathfinderProfiling()
+{
+	if (!_pf_profiling.enabled) return;
+
+	FinishPathfinderProfileInterval();
+	_pf_profiling.enabled = false;
+}
+
+/** Finish the interval in progress when its last day passed. */
+void PathfinderProfilingDailyLoop()
+{
+	if (!_pf_profiling.enabled) return;
+
+	/* A loaded game may have moved the date back. */
+	if (_date >= _pf_profiling.current.start && _date < _pf_profiling.current.end) return;
+
+	FinishPathfinderProfileInterval();
+}
+
+/** Start the timer and make this the scope the search loops report to. */
+void PathfinderProfileScope::Begin()
+{
+	this->outer = active;
+	active = this;
+	this->timer.Start();
+}
+
+/** Stop the timer and add the counters of the search to the profile. */
+void PathfinderProfileScope::End()
+{
+	this->timer.Stop();
+	active = this->outer;
+
+	this->stats.calls = 1;
+	this->stats.time = this->timer.Get(1000000);
+
+	assert(this->v->type < VEH_COMPANY_END && this->pathfinder < PF_PROFILE_PATHFINDERS);
+	_pf_profiling.current.totals[this->v->type][this->pathfinder].Add(this->stats);
+
+	std::pair<PathfinderProfile::VehicleMap::iterator, bool> ins = _pf_profiling.current.vehicles.insert(std::make_pair(this->v->index, PathfinderVehicleStats()));
+	PathfinderVehicleStats &vehicle = ins.first->second;
+	if (ins.second) {
+		vehicle.type = this->v->type;
+		vehicle.unitnumber = this->v->unitnumber;
+		vehicle.owner = this->v->owner;
+	}
+	vehicle.Add(this->stats);
+}
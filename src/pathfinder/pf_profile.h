@@ -0,0 +1,142 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_profile.h Profiling of the searches of the pathfinders. */
+
+#ifndef PF_PROFILE_H
+#define PF_PROFILE_H
+
+#include "pf_performance_timer.hpp"
+#include "../vehicle_type.h"
+#include "../company_type.h"
+#include "../transport_type.h"
+#include "../date_type.h"
+#include <map>
+
+/** Number of pathfinders the profile tells apart, see #VehiclePathFinders. */
+static const uint PF_PROFILE_PATHFINDERS = VPF_YAPF + 1;
+
+/** Number of vehicles with the most expanded nodes that are reported. */
+static const uint PF_PROFILE_WORST_VEHICLES = 10;
+
+/** Counters of the searches of the pathfinders. */
+struct PathfinderStats {
+	uint32 calls;      ///< Number of searches.
+	uint32 cache_hits; ///< Number of searches answered from a cache of earlier results.
+	uint32 aborts;     ///< Number of searches stopped at the maximum number of nodes.
+	uint64 nodes;      ///< Number of expanded nodes.
+	uint64 time;       ///< Time spent searching in microseconds of the clock of the OS, as measured by #CPerformanceTimer.
+
+	PathfinderStats() : calls(0), cache_hits(0), aborts(0), nodes(0), time(0) {}
+
+	/**
+	 * Add the counters of other searches.
+	 * @param other The counters to add.
+	 */
+	inline void Add(const PathfinderStats &other)
+	{
+		this->calls += other.calls;
+		this->cache_hits += other.cache_hits;
+		this->aborts += other.aborts;
+		this->nodes += other.nodes;
+		this->time += other.time;
+	}
+};
+
+/** Counters of the searches for one vehicle. */
+struct PathfinderVehicleStats : PathfinderStats {
+	VehicleType type;  ///< Type of the vehicle.
+	UnitID unitnumber; ///< Unit number of the vehicle at its first search.
+	Owner owner;       ///< Owner of the vehicle at its first search.
+};
+
+/** The counters of the searches during one interval. */
+struct PathfinderProfile {
+	typedef std::map<VehicleID, PathfinderVehicleStats> VehicleMap;
+
+	Date start;                                                      ///< First day of the interval.
+	Date end;                                                        ///< First day after the interval.
+	PathfinderStats totals[VEH_COMPANY_END][PF_PROFILE_PATHFINDERS]; ///< Counters by vehicle type and pathfinder.
+	VehicleMap vehicles;                                             ///< Counters by vehicle.
+
+	void Reset(Date start, Date end);
+	uint GetWorstVehicles(const VehicleMap::value_type **worst, uint count) const;
+};
+
+/** State of the profiling of the pathfinders. */
+struct PathfinderProfiling {
+	bool enabled;              ///< Whether the searches are counted.
+	uint interval;             ///< Length of an interval in days.
+	PathfinderProfile current; ///< The interval in progress.
+	PathfinderProfile last;    ///< The last finished interval.
+	bool has_last;             ///< Whether an interval finished since the profiling started.
+};
+
+extern PathfinderProfiling _pf_profiling;
+
+void StartPathfinderProfiling(uint interval);
+void StopPathfinderProfiling();
+void PathfinderProfilingDailyLoop();
+
+/**
+ * Counts one search of a pathfinder for the vehicle during its lifetime,
+ * while the profiling is enabled. The search loops of the pathfinders
+ * report their expanded nodes to the innermost active scope.
+ */
+class PathfinderProfileScope {
+	static PathfinderProfileScope *active; ///< The innermost scope, or NULL.
+
+	PathfinderProfileScope *outer;         ///< The scope that was active before this one.
+	const Vehicle *v;                      ///< The searching vehicle, or NULL when the profiling is disabled.
+	uint8 pathfinder;                      ///< The pathfinder that searches.
+	CPerformanceTimer timer;               ///< Time of the search.
+	PathfinderStats stats;                 ///< Counters of the search.
+
+	void Begin();
+	void End();
+
+public:
+	/**
+	 * Start counting a search.
+	 * @param v The searching vehicle.
+	 * @param pathfinder The searching pathfinder, see #VehiclePathFinders.
+	 */
+	inline PathfinderProfileScope(const Vehicle *v, uint8 pathfinder) : outer(NULL), v(NULL), pathfinder(pathfinder)
+	{
+		if (_pf_profiling.enabled) {
+			this->v = v;
+			this->Begin();
+		}
+	}
+
+	inline ~PathfinderProfileScope()
+	{
+		if (this->v != NULL) this->End();
+	}
+
+	/**
+	 * Count the nodes a search loop expanded.
+	 * @param nodes The number of expanded nodes.
+	 * @param aborted Whether the search stopped at the maximum number of nodes.
+	 */
+	static inline void AddNodes(uint nodes, bool aborted)
+	{
+		if (active == NULL) return;
+		active->stats.nodes += nodes;
+		if (aborted) active->stats.aborts++;
+	}
+
+	/** Count that the search was answered from a cache. */
+	static inline void AddCacheHit()
+	{
+		if (active != NULL) active->stats.cache_hits++;
+	}
+};
+
+#endif /* PF_PROFILE_H */
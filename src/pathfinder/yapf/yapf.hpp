@@ -15,6 +15,7 @@
 #include "../../landscape.h"
 #include "../pathfinder_func.h"
 #include "../pf_performance_timer.hpp"
+#include "../pf_profile.h"
 #include "yapf.h"
 
 //#undef FORCEINLINE
@@ -35,6 +36,7 @@
 #include "yapf_common.hpp"
 #include "yapf_costbase.hpp"
 #include "yapf_costcache.hpp"
+#include "yapf_landmarks.hpp"
 
 
 #endif /* YAPF_HPP */
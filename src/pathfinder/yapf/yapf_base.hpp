@@ -129,6 +129,7 @@ public:
 
 		Yapf().PfSetStartupNodes();
 		bool bDestFound = true;
+		bool bAborted = false;
 
 		for (;;) {
 			m_num_steps++;
@@ -148,11 +149,13 @@ public:
 				m_nodes.InsertClosedNode(*n);
 			} else {
 				bDestFound = false;
+				bAborted = true;
 				break;
 			}
 		}
 
 		bDestFound &= (m_pBestDestNode != NULL);
+		PathfinderProfileScope::AddNodes(m_nodes.ClosedCount(), bAborted);
 
 #ifndef NO_DEBUG_MESSAGES
 		perf.Stop();
@@ -254,7 +257,7 @@ public:
 
 		bool bValid = Yapf().PfCalcCost(n, &tf);
 
-		if (bCached) {
+		if (!bCached) {
 			Yapf().PfNodeCacheFlush(n);
 		}
 
@@ -382,4 +385,23 @@ public:
 #endif
 };
 
+/**
+ * Write the state of two pathfinders to yapf1.txt and yapf2.txt, to compare
+ * a search using the segment cost cache with one that doesn't.
+ * @param pf1 The first pathfinder.
+ * @param pf2 The second pathfinder.
+ */
+template <typename Tpf> void DumpState(Tpf &pf1, Tpf &pf2)
+{
+	DumpTarget dmp1, dmp2;
+	pf1.DumpBase(dmp1);
+	pf2.DumpBase(dmp2);
+	FILE *f1 = fopen("yapf1.txt", "wt");
+	FILE *f2 = fopen("yapf2.txt", "wt");
+	fwrite(dmp1.m_out.Data(), 1, dmp1.m_out.Size(), f1);
+	fwrite(dmp2.m_out.Data(), 1, dmp2.m_out.Size(), f2);
+	fclose(f1);
+	fclose(f2);
+}
+
 #endif /* YAPF_BASE_HPP */
@@ -16,9 +16,15 @@
 
 /**
  * Use this function to notify YAPF that track layout (or signal configuration) has change.
- * @param tile  the tile that is changed
+ * @param tile  the tile that is changed, or INVALID_TILE if the whole map changed
  * @param track what piece of track is changed
  */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+/**
+ * Use this function to notify YAPF that road layout (or one-way roads, road works) has changed.
+ * @param tile the tile that is changed, or INVALID_TILE if the whole map changed
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile);
+
 #endif /* YAPF_CACHE_H */
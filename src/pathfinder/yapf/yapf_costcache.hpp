@@ -13,6 +13,8 @@
 #define YAPF_COSTCACHE_HPP
 
 #include "../../date_func.h"
+#include "../../core/smallvec_type.hpp"
+#include "../../transport_type.h"
 
 /**
  * CYapfSegmentCostCacheNoneT - the formal only yapf cost cache provider that implements
@@ -36,8 +38,8 @@ public:
 	}
 
 	/**
-	 * Called by YAPF to flush the cached segment cost data back into cache storage.
-	 *  Current cache implementation doesn't use that.
+	 * Called by YAPF to flush newly calculated segment cost data back into cache storage.
+	 *  This cache provider doesn't store anything.
 	 */
 	inline void PfNodeCacheFlush(Node &n)
 	{
@@ -83,8 +85,8 @@ public:
 	}
 
 	/**
-	 * Called by YAPF to flush the cached segment cost data back into cache storage.
-	 *  Current cache implementation doesn't use that.
+	 * Called by YAPF to flush newly calculated segment cost data back into cache storage.
+	 *  Local data is not kept, so there is nothing to do.
 	 */
 	inline void PfNodeCacheFlush(Node &n)
 	{
@@ -94,21 +96,41 @@ public:
 
 /**
  * Base class for segment cost cache providers. Contains global counter
- *  of track layout changes and static notification function called whenever
- *  the track layout changes. It is implemented as base class because it needs
- *  to be shared between all rail YAPF types (one shared counter, one notification
- *  function.
+ *  of layout changes and static notification function called whenever
+ *  the layout changes. It is implemented as base class because it needs
+ *  to be shared between all YAPF types of a transport type (one shared
+ *  counter, one notification function).
  */
-struct CSegmentCostCacheBase
+template <TransportType Ttransport>
+struct CSegmentCostCacheBaseT
 {
-	static int   s_rail_change_counter;
+	static const uint MAX_CHANGED_TILES = 4096; ///< Number of changed tiles that are kept; a cache lagging further behind drops all its segments instead. Must be a power of two.
 
-	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
+	static int   s_change_counter;                       ///< Incremented when all cached segments become invalid.
+	static uint  s_changed_count;                        ///< Number of changed tiles so far; the last #MAX_CHANGED_TILES of them are in #s_changed_tiles.
+	static TileIndex s_changed_tiles[MAX_CHANGED_TILES]; ///< Ring buffer of the tiles whose layout changed; change \c n is at <tt>n % MAX_CHANGED_TILES</tt>.
+
+	/**
+	 * Notify the caches about a changed layout.
+	 * @param tile The changed tile, or #INVALID_TILE to invalidate all cached segments.
+	 */
+	static void NotifyLayoutChange(TileIndex tile)
 	{
-		s_rail_change_counter++;
+		if (tile == INVALID_TILE) {
+			s_change_counter++;
+			return;
+		}
+		s_changed_tiles[s_changed_count++ % MAX_CHANGED_TILES] = tile;
 	}
 };
 
+/** if the layout changes too much, this counter is incremented - that will invalidate segment cost cache */
+template <TransportType Ttransport> int CSegmentCostCacheBaseT<Ttransport>::s_change_counter = 0;
+/** number of tiles whose layout changed */
+template <TransportType Ttransport> uint CSegmentCostCacheBaseT<Ttransport>::s_changed_count = 0;
+/** tiles whose layout changed, the cached segments passing through them are invalidated */
+template <TransportType Ttransport> TileIndex CSegmentCostCacheBaseT<Ttransport>::s_changed_tiles[CSegmentCostCacheBaseT<Ttransport>::MAX_CHANGED_TILES];
+
 
 /**
  * CSegmentCostCacheT - template class providing hash-map and storage (heap)
@@ -118,18 +140,29 @@ struct CSegmentCostCacheBase
  *  be always the same (TileIndex + DiagDirection) that represent the beginning
  *  of the segment (origin tile and exit-dir from this tile).
  *  Different CYapfCachedCostT types can share the same type of CSegmentCostCacheT.
- *  Look at CYapfRailSegment (yapf_node_rail.hpp) for the segment example
+ *  Look at CYapfRailSegment (yapf_node_rail.hpp) for the segment example.
+ *  The segments of each transport type share the notifications of layout changes.
  */
 template <class Tsegment>
-struct CSegmentCostCacheT : public CSegmentCostCacheBase {
+struct CSegmentCostCacheT : public CSegmentCostCacheBaseT<Tsegment::TRANSPORT_TYPE> {
 	static const int C_HASH_BITS = 14;
+	static const uint REGION_BITS = 4;         ///< Log2 of the width and height of the regions of the map the segments are indexed by.
+	static const uint REGION_END = UINT_MAX;   ///< End of the list of segments of a region.
 
 	typedef CHashTableT<Tsegment, C_HASH_BITS> HashTable;
 	typedef SmallArray<Tsegment> Heap;
 	typedef typename Tsegment::Key Key;    ///< key to hash table
 
+	/** Link in the list of the segments that pass through a region. */
+	struct RegionLink {
+		Tsegment *segment; ///< The segment.
+		uint next;         ///< Index of the next link of the region, or #REGION_END.
+	};
+
 	HashTable    m_map;
 	Heap         m_heap;
+	SmallVector<uint, 16> m_region_heads;   ///< Per region of the map the first link of its segments, or #REGION_END.
+	SmallVector<RegionLink, 64> m_region_links; ///< Links of the lists of segments per region.
 
 	inline CSegmentCostCacheT() {}
 
@@ -138,6 +171,87 @@ struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 	{
 		m_map.Clear();
 		m_heap.Clear();
+		m_region_links.Clear();
+
+		uint regions = (MapSizeX() >> REGION_BITS) * (MapSizeY() >> REGION_BITS);
+		m_region_heads.Resize(regions);
+		for (uint i = 0; i < regions; i++) m_region_heads[i] = REGION_END;
+	}
+
+	/**
+	 * Check whether the cache is valid for the current map, and whether it
+	 *  doesn't keep too many invalidated segments around.
+	 */
+	inline bool IsValid() const
+	{
+		return m_region_heads.Length() == (MapSizeX() >> REGION_BITS) * (MapSizeY() >> REGION_BITS) &&
+				m_heap.Length() <= 2 * (uint)m_map.Count() + (1U << C_HASH_BITS);
+	}
+
+	/**
+	 * Get the region of the map a tile is in.
+	 * @param tile The tile.
+	 * @return Index of the region.
+	 */
+	static inline uint GetRegion(TileIndex tile)
+	{
+		return (TileY(tile) >> REGION_BITS) * (MapSizeX() >> REGION_BITS) + (TileX(tile) >> REGION_BITS);
+	}
+
+	/**
+	 * Register the tiles a cached segment passes through, so it is invalidated when they change.
+	 * @param segment The segment.
+	 * @param tiles The tiles of the segment.
+	 * @param count The number of tiles.
+	 */
+	inline void AddSegmentTiles(Tsegment &segment, const TileIndex *tiles, uint count)
+	{
+		uint last_region = REGION_END;
+		for (uint i = 0; i < count; i++) {
+			uint region = GetRegion(tiles[i]);
+			if (region == last_region) continue;
+			last_region = region;
+
+			RegionLink *link = m_region_links.Append();
+			link->segment = &segment;
+			link->next = m_region_heads[region];
+			m_region_heads[region] = m_region_links.Length() - 1;
+		}
+	}
+
+	/**
+	 * Drop the cached segments passing through a region.
+	 * @param region The region.
+	 */
+	inline void InvalidateRegion(uint region)
+	{
+		for (uint i = m_region_heads[region]; i != REGION_END; i = m_region_links[i].next) {
+			Tsegment *segment = m_region_links[i].segment;
+			/* The segment might have been dropped already, and calculated again. */
+			if (m_map.Find(segment->GetKey()) == segment) m_map.Pop(*segment);
+		}
+		m_region_heads[region] = REGION_END;
+	}
+
+	/**
+	 * Drop the cached segments that might depend on a tile: the segments
+	 *  passing through its region, and the regions of its neighbours as
+	 *  segments end depending on the next tile.
+	 * @param tile The changed tile.
+	 */
+	inline void InvalidateTile(TileIndex tile)
+	{
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		uint min_x = x == 0 ? 0 : (x - 1) >> REGION_BITS;
+		uint max_x = min(x + 1, MapMaxX()) >> REGION_BITS;
+		uint min_y = y == 0 ? 0 : (y - 1) >> REGION_BITS;
+		uint max_y = min(y + 1, MapMaxY()) >> REGION_BITS;
+		for (uint ry = min_y; ry <= max_y; ry++) {
+			for (uint rx = min_x; rx <= max_x; rx++) {
+				InvalidateRegion(ry * (MapSizeX() >> REGION_BITS) + rx);
+			}
+		}
 	}
 
 	inline Tsegment& Get(Key &key, bool *found)
@@ -183,7 +297,8 @@ protected:
 
 	inline static Cache& stGetGlobalCache()
 	{
-		static int last_rail_change_counter = 0;
+		static int last_change_counter = 0;
+		static uint last_changed_tile = 0;
 		static Date last_date = 0;
 		static Cache C;
 
@@ -194,11 +309,17 @@ protected:
 			_total_pf_time_us = 0;
 		}
 
-		/* delete the cache sometimes... */
-		if (last_rail_change_counter != Cache::s_rail_change_counter) {
-			last_rail_change_counter = Cache::s_rail_change_counter;
+		/* delete the cache sometimes, e.g. when changed tiles it did not see yet have been overwritten... */
+		if (last_change_counter != Cache::s_change_counter || Cache::s_changed_count - last_changed_tile > Cache::MAX_CHANGED_TILES || !C.IsValid()) {
+			last_change_counter = Cache::s_change_counter;
+			last_changed_tile = Cache::s_changed_count;
 			C.Flush();
 		}
+
+		/* ... but usually only the segments passing through the changed tiles. */
+		for (; last_changed_tile != Cache::s_changed_count; last_changed_tile++) {
+			C.InvalidateTile(Cache::s_changed_tiles[last_changed_tile % Cache::MAX_CHANGED_TILES]);
+		}
 		return C;
 	}
 
@@ -216,15 +337,19 @@ public:
 		bool found;
 		CachedData &item = m_global_cache.Get(key, &found);
 		Yapf().ConnectNodeToCachedData(n, item);
-		return found;
+		return found && item.CanBeReused();
 	}
 
 	/**
-	 * Called by YAPF to flush the cached segment cost data back into cache storage.
-	 *  Current cache implementation doesn't use that.
+	 * Called by YAPF to flush newly calculated segment cost data back into cache storage.
+	 *  The segment is already stored, but the tiles it passes through are registered
+	 *  so changes to them invalidate it.
 	 */
 	inline void PfNodeCacheFlush(Node &n)
 	{
+		if (!Yapf().CanUseGlobalCache(n) || !n.m_segment->CanBeReused()) return;
+		const SmallVector<TileIndex, 32> &tiles = Yapf().GetSegmentTiles();
+		m_global_cache.AddSegmentTiles(*n.m_segment, tiles.Begin(), tiles.Length());
 	}
 };
 
@@ -65,6 +65,7 @@ protected:
 	int           m_max_cost;
 	CBlobT<int>   m_sig_look_ahead_costs;
 	bool          m_disable_cache;
+	SmallVector<TileIndex, 32> m_segment_tiles; ///< Tiles of the segment calculated last, including the skipped ones.
 
 public:
 	bool          m_stopped_on_first_two_way_signal;
@@ -325,6 +326,8 @@ public:
 
 		const Train *v = Yapf().GetVehicle();
 
+		if (!is_cached_segment) m_segment_tiles.Clear();
+
 		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
 		TILE cur(n.m_key.m_tile, n.m_key.m_td);
 
@@ -387,6 +390,17 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			/* If we skipped some tunnel/bridge/station tiles, add their base cost */
 			segment_cost += YAPF_TILE_LENGTH * tf->m_tiles_skipped;
 
+			/* Remember the tiles of the segment, so the cached segment can be invalidated when one changes. */
+			*m_segment_tiles.Append() = cur.tile;
+			if (tf->m_tiles_skipped > 0) {
+				TileIndexDiff diff = TileOffsByDiagDir(ReverseDiagDir(TrackdirToExitdir(cur.td)));
+				TileIndex skipped = cur.tile;
+				for (int i = 0; i < tf->m_tiles_skipped; i++) {
+					skipped = TILE_ADD(skipped, diff);
+					*m_segment_tiles.Append() = skipped;
+				}
+			}
+
 			/* Slope cost. */
 			segment_cost += Yapf().SlopeCost(cur.tile, cur.td);
 
@@ -618,6 +632,15 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 		return true;
 	}
 
+	/**
+	 * Get the tiles of the segment calculated last by #PfCalcCost.
+	 * @return The tiles.
+	 */
+	inline const SmallVector<TileIndex, 32> &GetSegmentTiles() const
+	{
+		return m_segment_tiles;
+	}
+
 	inline bool CanUseGlobalCache(Node &n) const
 	{
 		return !m_disable_cache
@@ -120,6 +120,7 @@ protected:
 	TileIndex    m_destTile;
 	TrackdirBits m_destTrackdirs;
 	StationID    m_dest_station_id;
+	CYapfLandmarkEstimate m_landmarks; ///< Estimate using the distances to the landmarks.
 
 	/** to access inherited path finder */
 	Tpf& Yapf()
@@ -153,6 +154,19 @@ public:
 				m_destTrackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_RAIL, 0));
 				break;
 		}
+
+		m_landmarks.Init(TRANSPORT_RAIL);
+		if (m_landmarks.IsEnabled()) {
+			if (m_dest_station_id != INVALID_STATION) {
+				TileArea ta;
+				BaseStation::Get(m_dest_station_id)->GetTileArea(&ta, v->current_order.IsType(OT_GOTO_STATION) ? STATION_RAIL : STATION_WAYPOINT);
+				TILE_AREA_LOOP(tile, ta) {
+					if (HasStationTileRail(tile) && GetStationIndex(tile) == m_dest_station_id) m_landmarks.AddTarget(tile);
+				}
+			} else {
+				m_landmarks.AddTarget(m_destTile);
+			}
+		}
 		CYapfDestinationRailBase::SetDestination(v);
 	}
 
@@ -201,6 +215,7 @@ public:
 		int dmin = min(dx, dy);
 		int dxy = abs(dx - dy);
 		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+		d = max(d, m_landmarks.GetEstimate(tile));
 		n.m_estimate = n.m_cost + d;
 		assert(n.m_estimate >= n.m_parent->m_estimate);
 		return true;
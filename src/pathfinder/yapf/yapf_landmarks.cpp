@@ -0,0 +1,536 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_landmarks.cpp Landmark distance tables for the estimates of YAPF. */
+
+#include "../../stdafx.h"
+#include "yapf_landmarks.hpp"
+#include "../../map_func.h"
+#include "../../tile_cmd.h"
+#include "../../track_func.h"
+#include "../../road_map.h"
+#include "../../tunnelbridge_map.h"
+#include "../../tunnelbridge.h"
+#include "../../settings_type.h"
+#include "../pathfinder_type.h"
+#include <algorithm>
+#include <functional>
+
+#include "../../safeguards.h"
+
+/** Positions the landmarks are nearest to, in halves of the map size. */
+static const byte _landmark_positions[CYapfLandmarks::COUNT][2] = {
+	{0, 0}, {1, 0}, {2, 0}, {2, 1}, {2, 2}, {1, 2}, {0, 2}, {0, 1},
+};
+
+static CYapfLandmarks _rail_landmarks(TRANSPORT_RAIL); ///< Landmarks of the rail network.
+static CYapfLandmarks _road_landmarks(TRANSPORT_ROAD); ///< Landmarks of the road network.
+
+/**
+ * Get the landmark table of a network.
+ * @param transport #TRANSPORT_RAIL or #TRANSPORT_ROAD.
+ * @return The table.
+ */
+/* static */ CYapfLandmarks &CYapfLandmarks::Get(TransportType transport)
+{
+	assert(transport == TRANSPORT_RAIL || transport == TRANSPORT_ROAD);
+	return transport == TRANSPORT_RAIL ? _rail_landmarks : _road_landmarks;
+}
+
+/**
+ * Create an empty table; it is built from the map on its first #Update.
+ * @param transport The network of the table.
+ */
+CYapfLandmarks::CYapfLandmarks(TransportType transport) : m_transport(transport), m_rebuild(true), m_next_component(1), m_visit(0)
+{
+}
+
+/**
+ * Remember a changed tile, to apply the change on the next #Update.
+ * @param tile The changed tile, or #INVALID_TILE if the whole map changed.
+ */
+void CYapfLandmarks::NotifyChange(TileIndex tile)
+{
+	if (m_rebuild) return;
+	if (tile == INVALID_TILE || m_changed.Length() >= MAX_CHANGED_TILES) {
+		m_rebuild = true;
+		m_changed.Reset();
+		return;
+	}
+	*m_changed.Append() = tile;
+}
+
+/**
+ * Find the connections of a tile to its neighbours.
+ * @param tile The tile.
+ * @param[out] info The connections of the tile.
+ */
+void CYapfLandmarks::ReadTile(TileIndex tile, TileInfo *info) const
+{
+	info->exits = 0;
+	info->far_tile = INVALID_TILE;
+	info->far_length = 0;
+
+	if (m_transport == TRANSPORT_ROAD && IsNormalRoadTile(tile)) {
+		/* Road works and one-way roads only hinder some vehicles for a while. */
+		RoadBits bits = GetAllRoadBits(tile);
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			if ((bits & DiagDirToRoadBits(dir)) != ROAD_NONE) SetBit(info->exits, dir);
+		}
+		return;
+	}
+
+	TrackdirBits trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(tile, m_transport, m_transport == TRANSPORT_ROAD ? ROADTYPES_ALL : 0));
+	while (trackdirs != TRACKDIR_BIT_NONE) {
+		Trackdir td = RemoveFirstTrackdir(&trackdirs);
+		SetBit(info->exits, TrackdirToExitdir(td));
+		SetBit(info->exits, TrackdirToExitdir(ReverseTrackdir(td)));
+	}
+
+	if (info->exits != 0 && IsTileType(tile, MP_TUNNELBRIDGE)) {
+		/* The tile in front of the head is passed over or under; the other head is next. */
+		ClrBit(info->exits, GetTunnelBridgeDirection(tile));
+		info->far_tile = GetOtherTunnelBridgeEnd(tile);
+		info->far_length = GetTunnelBridgeLength(tile, info->far_tile) + 1;
+	}
+}
+
+/**
+ * Find the nodes connected to a node.
+ * @param node The node.
+ * @param[out] neighbours The connected nodes, at most five.
+ * @param[out] lengths The distance in tiles to each connected node.
+ * @return The number of connected nodes.
+ */
+uint CYapfLandmarks::GetNeighbours(const Node *node, Node **neighbours, uint32 *lengths)
+{
+	uint count = 0;
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		if (!HasBit(node->m_exits, dir)) continue;
+		NodeKey key = { TileAddByDiagDir(node->m_key.m_tile, dir) };
+		Node *other = m_hash.Find(key);
+		if (other == NULL || !HasBit(other->m_exits, ReverseDiagDir(dir))) continue;
+		neighbours[count] = other;
+		lengths[count] = 1;
+		count++;
+	}
+	if (node->m_far_tile != INVALID_TILE) {
+		NodeKey key = { node->m_far_tile };
+		Node *other = m_hash.Find(key);
+		if (other != NULL && other->m_far_tile == node->m_key.m_tile) {
+			neighbours[count] = other;
+			lengths[count] = node->m_far_length;
+			count++;
+		}
+	}
+	return count;
+}
+
+/**
+ * Add a node for a tile, not connected to any landmark yet.
+ * @param tile The tile.
+ * @param info The connections of the tile.
+ * @return The new node.
+ */
+CYapfLandmarks::Node *CYapfLandmarks::AddNode(TileIndex tile, const TileInfo &info)
+{
+	Node *node;
+	if (m_free.Length() > 0) {
+		node = *(m_free.End() - 1);
+		m_free.Erase(m_free.End() - 1);
+	} else {
+		uint index = m_nodes.Length();
+		node = m_nodes.AppendC();
+		node->m_index = index;
+	}
+	node->m_key.m_tile = tile;
+	node->m_hash_next = NULL;
+	node->m_component = 0;
+	node->m_exits = info.exits;
+	node->m_affected = 0;
+	node->m_visit = 0;
+	node->m_far_tile = info.far_tile;
+	node->m_far_length = info.far_length;
+	for (uint i = 0; i < COUNT; i++) node->m_distance[i] = UNREACHABLE;
+	m_hash.Push(*node);
+	return node;
+}
+
+/**
+ * Set a smaller distance of a node to a landmark, and queue it for #PropagateDistances.
+ * @param node The node.
+ * @param landmark The landmark.
+ * @param distance The new distance.
+ */
+inline void CYapfLandmarks::PushDistance(Node *node, uint landmark, uint32 distance)
+{
+	node->m_distance[landmark] = distance;
+	*m_queue.Append() = ((uint64)distance << 32) | node->m_index;
+	std::push_heap(m_queue.Begin(), m_queue.End(), std::greater<uint64>());
+}
+
+/**
+ * Lower the distances to a landmark of the nodes connected to the queued
+ *  nodes as far as possible, in order of distance.
+ * @param landmark The landmark.
+ */
+void CYapfLandmarks::PropagateDistances(uint landmark)
+{
+	Node *neighbours[5];
+	uint32 lengths[5];
+	while (m_queue.Length() > 0) {
+		std::pop_heap(m_queue.Begin(), m_queue.End(), std::greater<uint64>());
+		uint64 item = *(m_queue.End() - 1);
+		m_queue.Erase(m_queue.End() - 1);
+
+		Node *node = &m_nodes[(uint32)item];
+		uint32 distance = (uint32)(item >> 32);
+		if (node->m_distance[landmark] != distance) continue;
+
+		uint count = GetNeighbours(node, neighbours, lengths);
+		for (uint i = 0; i < count; i++) {
+			if (distance + lengths[i] < neighbours[i]->m_distance[landmark]) PushDistance(neighbours[i], landmark, distance + lengths[i]);
+		}
+	}
+}
+
+/**
+ * Mark the nodes whose shortest path to a landmark may pass a node. These
+ *  are found by following the connections along which the distance grows by
+ *  exactly the length of the connection.
+ * @param start The node.
+ * @param landmark The landmark.
+ * @param[in,out] affected The nodes with any landmark marked.
+ */
+void CYapfLandmarks::CollectAffected(Node *start, uint landmark, SmallVector<Node *, 64> &affected)
+{
+	if (HasBit(start->m_affected, landmark)) return;
+
+	Node *neighbours[5];
+	uint32 lengths[5];
+	SmallVector<Node *, 64> stack;
+	if (start->m_affected == 0) *affected.Append() = start;
+	SetBit(start->m_affected, landmark);
+	*stack.Append() = start;
+	while (stack.Length() > 0) {
+		Node *node = *(stack.End() - 1);
+		stack.Erase(stack.End() - 1);
+		if (node->m_distance[landmark] == UNREACHABLE) continue;
+
+		uint count = GetNeighbours(node, neighbours, lengths);
+		for (uint i = 0; i < count; i++) {
+			Node *other = neighbours[i];
+			if (HasBit(other->m_affected, landmark) || other->m_distance[landmark] != node->m_distance[landmark] + lengths[i]) continue;
+			if (other->m_affected == 0) *affected.Append() = other;
+			SetBit(other->m_affected, landmark);
+			*stack.Append() = other;
+		}
+	}
+}
+
+/**
+ * Collect the nodes of the connected part of the network a node belongs to.
+ * @param seed The node.
+ * @param[out] nodes The nodes of the connected part.
+ * @param[out] old_components The connected parts the nodes belonged to before.
+ * @return The number of nodes that belonged to a connected part before.
+ */
+uint CYapfLandmarks::FindComponent(Node *seed, SmallVector<Node *, 64> &nodes, SmallVector<uint32, 8> &old_components)
+{
+	Node *neighbours[5];
+	uint32 lengths[5];
+	uint old_nodes = 0;
+	nodes.Clear();
+	old_components.Clear();
+	seed->m_visit = m_visit;
+	*nodes.Append() = seed;
+	for (uint i = 0; i < nodes.Length(); i++) {
+		Node *node = nodes[i];
+		if (node->m_component != 0) {
+			old_components.Include(node->m_component);
+			old_nodes++;
+		}
+		uint count = GetNeighbours(node, neighbours, lengths);
+		for (uint j = 0; j < count; j++) {
+			if (neighbours[j]->m_visit == m_visit) continue;
+			neighbours[j]->m_visit = m_visit;
+			*nodes.Append() = neighbours[j];
+		}
+	}
+	return old_nodes;
+}
+
+/**
+ * Make a new connected part of the network, and choose its landmarks. The
+ *  distances to the landmarks are calculated from scratch, unless the
+ *  connected part consists of the same nodes and has the same landmark as
+ *  before, then the distances of the affected nodes are repaired by #Update.
+ * @param nodes The nodes of the connected part.
+ * @param old The same connected part before the change, or NULL if it is different.
+ * @return The number of the new connected part.
+ */
+uint32 CYapfLandmarks::AddComponent(const SmallVector<Node *, 64> &nodes, const Component *old)
+{
+	Component component;
+	component.size = nodes.Length();
+
+	uint best_distance[COUNT];
+	for (uint i = 0; i < COUNT; i++) {
+		component.landmark[i] = INVALID_TILE;
+		best_distance[i] = UINT_MAX;
+	}
+	for (Node * const *it = nodes.Begin(); it != nodes.End(); it++) {
+		TileIndex tile = (*it)->m_key.m_tile;
+		for (uint i = 0; i < COUNT; i++) {
+			uint distance = Delta(TileX(tile), MapMaxX() * _landmark_positions[i][0] / 2) + Delta(TileY(tile), MapMaxY() * _landmark_positions[i][1] / 2);
+			if (distance < best_distance[i] || (distance == best_distance[i] && tile < component.landmark[i])) {
+				best_distance[i] = distance;
+				component.landmark[i] = tile;
+			}
+		}
+	}
+
+	uint32 number = m_next_component++;
+	for (Node * const *it = nodes.Begin(); it != nodes.End(); it++) (*it)->m_component = number;
+
+	for (uint i = 0; i < COUNT; i++) {
+		if (old != NULL && old->landmark[i] == component.landmark[i]) continue;
+
+		for (Node * const *it = nodes.Begin(); it != nodes.End(); it++) {
+			(*it)->m_distance[i] = UNREACHABLE;
+			ClrBit((*it)->m_affected, i);
+		}
+		NodeKey key = { component.landmark[i] };
+		PushDistance(m_hash.Find(key), i, 0);
+		PropagateDistances(i);
+	}
+
+	m_components[number] = component;
+	return number;
+}
+
+/** Build the table from the map. */
+void CYapfLandmarks::Rebuild()
+{
+	m_rebuild = false;
+	m_changed.Reset();
+	m_nodes.Clear();
+	m_hash.Clear();
+	m_free.Reset();
+	m_components.clear();
+
+	for (TileIndex tile = 0; tile < MapSize(); tile++) {
+		TileInfo info;
+		ReadTile(tile, &info);
+		if (info.exits != 0) AddNode(tile, info);
+	}
+
+	m_visit++;
+	SmallVector<Node *, 64> nodes;
+	SmallVector<uint32, 8> old_components;
+	for (uint i = 0; i < m_nodes.Length(); i++) {
+		if (m_nodes[i].m_visit == m_visit) continue;
+		FindComponent(&m_nodes[i], nodes, old_components);
+		AddComponent(nodes, NULL);
+	}
+}
+
+/**
+ * Apply the changed tiles to the table. A change of a tile can only make
+ *  the nodes whose shortest path to a landmark passes that tile further
+ *  away; only the distances of these nodes are calculated again, starting
+ *  from their unaffected neighbours. If the change splits or joins connected
+ *  parts of the network, or moves a landmark, the distances of the changed
+ *  parts are calculated from scratch instead.
+ */
+void CYapfLandmarks::Update()
+{
+	if (m_rebuild) {
+		Rebuild();
+		return;
+	}
+	if (m_changed.Length() == 0) return;
+
+	/** A tile whose connections changed. */
+	struct Change {
+		TileIndex tile; ///< The tile.
+		TileInfo info;  ///< The new connections of the tile.
+		Node *node;     ///< The node of the tile before the change, or NULL.
+	};
+
+	std::sort(m_changed.Begin(), m_changed.End());
+	TileIndex *end = std::unique(m_changed.Begin(), m_changed.End());
+
+	SmallVector<Change, 16> changes;
+	for (const TileIndex *tile = m_changed.Begin(); tile != end; tile++) {
+		Change change;
+		change.tile = *tile;
+		ReadTile(*tile, &change.info);
+		NodeKey key = { *tile };
+		change.node = m_hash.Find(key);
+		if (change.node == NULL) {
+			if (change.info.exits == 0) continue;
+		} else if (change.node->m_exits == change.info.exits && change.node->m_far_tile == change.info.far_tile && change.node->m_far_length == change.info.far_length) {
+			continue;
+		}
+		*changes.Append() = change;
+	}
+	m_changed.Clear();
+	if (changes.Length() == 0) return;
+
+	/* Find what depends on the changed nodes before changing them. */
+	Node *neighbours[5];
+	uint32 lengths[5];
+	SmallVector<Node *, 64> seeds;
+	SmallVector<Node *, 64> affected;
+	SmallVector<uint32, 8> gone_components;
+	for (const Change *change = changes.Begin(); change != changes.End(); change++) {
+		if (change->node == NULL) continue;
+		uint count = GetNeighbours(change->node, neighbours, lengths);
+		for (uint i = 0; i < count; i++) *seeds.Append() = neighbours[i];
+		gone_components.Include(change->node->m_component);
+		for (uint i = 0; i < COUNT; i++) CollectAffected(change->node, i, affected);
+	}
+
+	/* Change the nodes; removed nodes are only reused after this update. */
+	SmallVector<Node *, 16> removed;
+	for (const Change *change = changes.Begin(); change != changes.End(); change++) {
+		Node *node = change->node;
+		if (node == NULL) {
+			node = AddNode(change->tile, change->info);
+			node->m_affected = (1 << COUNT) - 1;
+			*affected.Append() = node;
+		} else if (change->info.exits == 0) {
+			m_hash.Pop(node->m_key);
+			node->m_key.m_tile = INVALID_TILE;
+			*removed.Append() = node;
+			continue;
+		} else {
+			node->m_exits = change->info.exits;
+			node->m_far_tile = change->info.far_tile;
+			node->m_far_length = change->info.far_length;
+		}
+		*seeds.Append() = node;
+	}
+
+	/* Find the connected parts of the network around the changes. */
+	m_visit++;
+	SmallVector<Node *, 64> nodes;
+	SmallVector<uint32, 8> old_components;
+	for (Node **seed = seeds.Begin(); seed != seeds.End(); seed++) {
+		if ((*seed)->m_key.m_tile == INVALID_TILE || (*seed)->m_visit == m_visit) continue;
+
+		uint old_nodes = FindComponent(*seed, nodes, old_components);
+		const Component *old = NULL;
+		if (old_components.Length() == 1) {
+			ComponentMap::const_iterator it = m_components.find(old_components[0]);
+			if (it != m_components.end() && it->second.size == old_nodes) old = &it->second;
+		}
+		for (const uint32 *number = old_components.Begin(); number != old_components.End(); number++) gone_components.Include(*number);
+		AddComponent(nodes, old);
+	}
+	for (const uint32 *number = gone_components.Begin(); number != gone_components.End(); number++) m_components.erase(*number);
+
+	/* Repair the distances of the affected nodes from their unaffected neighbours. */
+	for (uint i = 0; i < COUNT; i++) {
+		for (Node **it = affected.Begin(); it != affected.End(); it++) {
+			if ((*it)->m_key.m_tile != INVALID_TILE && HasBit((*it)->m_affected, i)) (*it)->m_distance[i] = UNREACHABLE;
+		}
+		for (Node **it = affected.Begin(); it != affected.End(); it++) {
+			Node *node = *it;
+			if (node->m_key.m_tile == INVALID_TILE || !HasBit(node->m_affected, i)) continue;
+
+			if (m_components[node->m_component].landmark[i] == node->m_key.m_tile) {
+				PushDistance(node, i, 0);
+				continue;
+			}
+			uint32 distance = UNREACHABLE;
+			uint count = GetNeighbours(node, neighbours, lengths);
+			for (uint j = 0; j < count; j++) {
+				if (HasBit(neighbours[j]->m_affected, i) || neighbours[j]->m_distance[i] == UNREACHABLE) continue;
+				distance = min(distance, neighbours[j]->m_distance[i] + lengths[j]);
+			}
+			if (distance != UNREACHABLE) PushDistance(node, i, distance);
+		}
+		PropagateDistances(i);
+	}
+
+	for (Node **it = affected.Begin(); it != affected.End(); it++) (*it)->m_affected = 0;
+	for (Node **it = removed.Begin(); it != removed.End(); it++) *m_free.Append() = *it;
+}
+
+
+/**
+ * Start the estimate of a path search.
+ * @param transport The network the search is on.
+ */
+void CYapfLandmarkEstimate::Init(TransportType transport)
+{
+	m_bounds.Clear();
+	m_landmarks = NULL;
+	if (!_settings_game.pf.yapf.use_landmarks) return;
+
+	CYapfLandmarks &landmarks = CYapfLandmarks::Get(transport);
+	landmarks.Update();
+	m_landmarks = &landmarks;
+}
+
+/**
+ * Add a tile to the destination of the path search.
+ * @param tile The tile.
+ */
+void CYapfLandmarkEstimate::AddTarget(TileIndex tile)
+{
+	if (m_landmarks == NULL) return;
+	const CYapfLandmarks::Node *node = m_landmarks->Find(tile);
+	if (node == NULL) return;
+
+	for (Bounds *bounds = m_bounds.Begin(); bounds != m_bounds.End(); bounds++) {
+		if (bounds->component != node->m_component) continue;
+		for (uint i = 0; i < CYapfLandmarks::COUNT; i++) {
+			bounds->min_distance[i] = min(bounds->min_distance[i], node->m_distance[i]);
+			bounds->max_distance[i] = max(bounds->max_distance[i], node->m_distance[i]);
+		}
+		return;
+	}
+
+	Bounds *bounds = m_bounds.Append();
+	bounds->component = node->m_component;
+	for (uint i = 0; i < CYapfLandmarks::COUNT; i++) {
+		bounds->min_distance[i] = node->m_distance[i];
+		bounds->max_distance[i] = node->m_distance[i];
+	}
+}
+
+/**
+ * Get the lower bound of the cost from a tile to the nearest destination tile.
+ * @param tile The tile.
+ * @return The lower bound, or 0 if it is unknown.
+ */
+int CYapfLandmarkEstimate::GetEstimate(TileIndex tile) const
+{
+	if (m_landmarks == NULL) return 0;
+	const CYapfLandmarks::Node *node = m_landmarks->Find(tile);
+	if (node == NULL) return 0;
+
+	for (const Bounds *bounds = m_bounds.Begin(); bounds != m_bounds.End(); bounds++) {
+		if (bounds->component != node->m_component) continue;
+		uint32 distance = 0;
+		for (uint i = 0; i < CYapfLandmarks::COUNT; i++) {
+			uint32 d = node->m_distance[i];
+			if (d > bounds->max_distance[i]) {
+				distance = max(distance, d - bounds->max_distance[i]);
+			} else if (d < bounds->min_distance[i]) {
+				distance = max(distance, bounds->min_distance[i] - d);
+			}
+		}
+		return distance * YAPF_TILE_CORNER_LENGTH;
+	}
+	return 0;
+}
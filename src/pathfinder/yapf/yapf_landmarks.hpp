@@ -0,0 +1,160 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_landmarks.hpp Landmark distance tables for the estimates of YAPF. */
+
+#ifndef YAPF_LANDMARKS_HPP
+#define YAPF_LANDMARKS_HPP
+
+#include "../../tile_type.h"
+#include "../../transport_type.h"
+#include "../../core/smallvec_type.hpp"
+#include "../../misc/array.hpp"
+#include "../../misc/hashtable.hpp"
+#include <map>
+
+/**
+ * Table of the distances in tiles from a few landmarks to every tile of the
+ *  rail or road network. The network is seen as an undirected graph of the
+ *  tiles with tracks, so the distances do not depend on track types, signals,
+ *  one-way roads or road works. By the triangle inequality the difference
+ *  between the distances of two tiles to a landmark is a lower bound of the
+ *  distance between these tiles, so every tile a vehicle enters on its way
+ *  costs at least #YAPF_TILE_CORNER_LENGTH per tile of that bound.
+ *
+ * Every connected part of the network has its own landmarks: the tiles of
+ *  that part nearest to the corners and the middles of the map edges. The
+ *  table is therefore only a function of the map, which keeps the paths the
+ *  same for all clients of a network game. Changed tiles are collected by
+ *  #NotifyChange and applied by #Update before the table is used.
+ */
+class CYapfLandmarks {
+public:
+	static const uint COUNT = 8;                   ///< Number of landmarks of a connected part of the network.
+	static const uint32 UNREACHABLE = UINT32_MAX;  ///< Distance of a tile not connected to the landmark.
+
+	/** Key of a node in the hash table: its tile. */
+	struct NodeKey {
+		TileIndex m_tile; ///< The tile of the node.
+
+		inline int CalcHash() const { return m_tile; }
+		inline bool operator==(const NodeKey &other) const { return m_tile == other.m_tile; }
+	};
+
+	/** A tile of the network. */
+	struct Node {
+		typedef NodeKey Key;
+
+		Key       m_key;                 ///< The tile of the node, #INVALID_TILE when it is not used.
+		Node     *m_hash_next;           ///< Next node in the same slot of the hash table.
+		uint32    m_index;               ///< Index of the node in #m_nodes.
+		uint32    m_component;           ///< The connected part of the network the node belongs to.
+		uint8     m_exits;               ///< Bit mask of the sides of the tile with a track leaving to the neighbouring tile.
+		uint8     m_affected;            ///< Bit mask of the landmarks whose distance has to be repaired.
+		uint32    m_visit;               ///< Number of the last search for the connected parts that saw the node.
+		TileIndex m_far_tile;            ///< For tunnel and bridge heads the other head, otherwise #INVALID_TILE.
+		uint32    m_far_length;          ///< For tunnel and bridge heads the distance in tiles to the other head.
+		uint32    m_distance[COUNT];     ///< Distance in tiles to each landmark of the component.
+
+		inline const Key &GetKey() const { return m_key; }
+		inline Node *GetHashNext() const { return m_hash_next; }
+		inline void SetHashNext(Node *next) { m_hash_next = next; }
+	};
+
+	static CYapfLandmarks &Get(TransportType transport);
+
+	void NotifyChange(TileIndex tile);
+	void Update();
+
+	/**
+	 * Find the node of a tile.
+	 * @param tile The tile to look for.
+	 * @return The node of the tile, or NULL if the tile has no tracks.
+	 */
+	inline const Node *Find(TileIndex tile) const
+	{
+		NodeKey key = { tile };
+		return m_hash.Find(key);
+	}
+
+private:
+	static const uint MAX_CHANGED_TILES = 65536; ///< Number of changed tiles after which the table is built again instead.
+
+	/** Tracks on a tile as seen by the table. */
+	struct TileInfo {
+		uint8     exits;       ///< See #Node::m_exits.
+		TileIndex far_tile;    ///< See #Node::m_far_tile.
+		uint32    far_length;  ///< See #Node::m_far_length.
+	};
+
+	/** A connected part of the network. */
+	struct Component {
+		uint32    size;             ///< Number of nodes.
+		TileIndex landmark[COUNT];  ///< The landmarks.
+	};
+
+	typedef SmallArray<Node, 1024, 16384> NodeArray;
+	typedef std::map<uint32, Component> ComponentMap;
+
+	TransportType m_transport;               ///< The network of the table.
+	bool m_rebuild;                          ///< Whether the table has to be built from the map again.
+	SmallVector<TileIndex, 64> m_changed;    ///< Tiles changed since the last #Update.
+	NodeArray m_nodes;                       ///< Storage of the nodes.
+	CHashTableT<Node, 16> m_hash;            ///< The nodes by tile.
+	SmallVector<Node *, 64> m_free;          ///< Nodes that are not used.
+	ComponentMap m_components;               ///< The connected parts of the network by number.
+	uint32 m_next_component;                 ///< Number of the next new connected part.
+	uint32 m_visit;                          ///< Number of the last search for the connected parts.
+	SmallVector<uint64, 256> m_queue;        ///< Priority queue of the distance searches: distance in the high, node index in the low bits.
+
+public:
+	CYapfLandmarks(TransportType transport);
+
+private:
+	void ReadTile(TileIndex tile, TileInfo *info) const;
+	uint GetNeighbours(const Node *node, Node **neighbours, uint32 *lengths);
+	Node *AddNode(TileIndex tile, const TileInfo &info);
+	void Rebuild();
+	void CollectAffected(Node *start, uint landmark, SmallVector<Node *, 64> &affected);
+	uint FindComponent(Node *seed, SmallVector<Node *, 64> &nodes, SmallVector<uint32, 8> &old_components);
+	uint32 AddComponent(const SmallVector<Node *, 64> &nodes, const Component *old);
+	void PushDistance(Node *node, uint landmark, uint32 distance);
+	void PropagateDistances(uint landmark);
+};
+
+/**
+ * Lower bound of the cost to reach a set of target tiles from the last tile
+ *  of a node, using the landmark distance tables.
+ */
+class CYapfLandmarkEstimate {
+	/** Range of the distances of the targets in one connected part of the network. */
+	struct Bounds {
+		uint32 component;                          ///< The connected part of the network.
+		uint32 min_distance[CYapfLandmarks::COUNT]; ///< Least distance of a target to each landmark.
+		uint32 max_distance[CYapfLandmarks::COUNT]; ///< Greatest distance of a target to each landmark.
+	};
+
+	const CYapfLandmarks *m_landmarks;  ///< The table in use, or NULL if the estimate is disabled.
+	SmallVector<Bounds, 2> m_bounds;     ///< The targets by connected part of the network.
+
+public:
+	CYapfLandmarkEstimate() : m_landmarks(NULL) {}
+
+	void Init(TransportType transport);
+	void AddTarget(TileIndex tile);
+	int GetEstimate(TileIndex tile) const;
+
+	/** Whether the estimate is enabled. */
+	inline bool IsEnabled() const
+	{
+		return m_landmarks != NULL;
+	}
+};
+
+#endif /* YAPF_LANDMARKS_HPP */
@@ -66,6 +66,8 @@ struct CYapfRailSegment
 {
 	typedef CYapfRailSegmentKey Key;
 
+	static const TransportType TRANSPORT_TYPE = TRANSPORT_RAIL; ///< The transport type whose layout changes invalidate the segments.
+
 	CYapfRailSegmentKey    m_key;
 	TileIndex              m_last_tile;
 	Trackdir               m_last_td;
@@ -96,6 +98,12 @@ struct CYapfRailSegment
 		return m_key.GetTile();
 	}
 
+	/** Whether the segment was calculated, and can be used without walking it again. */
+	inline bool CanBeReused() const
+	{
+		return m_cost >= 0;
+	}
+
 	inline CYapfRailSegment *GetHashNext()
 	{
 		return m_hash_next;
@@ -21,19 +21,6 @@
 
 #include "../../safeguards.h"
 
-template <typename Tpf> void DumpState(Tpf &pf1, Tpf &pf2)
-{
-	DumpTarget dmp1, dmp2;
-	pf1.DumpBase(dmp1);
-	pf2.DumpBase(dmp2);
-	FILE *f1 = fopen("yapf1.txt", "wt");
-	FILE *f2 = fopen("yapf2.txt", "wt");
-	fwrite(dmp1.m_out.Data(), 1, dmp1.m_out.Size(), f1);
-	fwrite(dmp2.m_out.Data(), 1, dmp2.m_out.Size(), f2);
-	fclose(f1);
-	fclose(f2);
-}
-
 int _total_pf_time_us = 0;
 
 template <class Types>
@@ -180,7 +167,8 @@ public:
 		if (target != NULL) target->okay = true;
 
 		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+			/* Only the costs of the reserved segments changed, not the layout. */
+			CSegmentCostCacheBaseT<TRANSPORT_RAIL>::NotifyLayoutChange(INVALID_TILE);
 		}
 
 		return true;
@@ -535,10 +523,141 @@ struct CYapfAnySafeTileRail1 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail1, CF
 struct CYapfAnySafeTileRail2 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail2, CFollowTrackFreeRailNo90, CRailNodeListTrackDir, CYapfDestinationAnySafeTileRailT , CYapfFollowAnySafeTileRailT> > {};
 
 
+typedef Trackdir (*PfnChooseRailTrack)(const Train*, TileIndex, DiagDirection, TrackBits, bool&, bool, PBSTileInfo*);
+
+/**
+ * Cache of the results of the train path searches that do not reserve a path.
+ * Such a search only reads the map, so a search with the same inputs gives the
+ * same result as long as the track layout, the signal states, the track
+ * reservations and the pathfinder settings do not change. Trains heading for
+ * the same destination ask the same question at the same junctions, often
+ * within a few ticks of each other.
+ * Searches that reserve a path change the map and may trigger the random
+ * station animations, so they are never answered from the cache. That keeps
+ * the answers equal to those of a client that joined with an empty cache.
+ */
+class CYapfRailQueryCache {
+	static const uint SIZE = 1024; ///< Number of entries; must be a power of 2.
+
+	/** The inputs of a search besides the map. The padding is cleared, so keys can be compared bytewise. */
+	struct Key {
+		TileIndex     tile;           ///< Tile of the train, the start of its reservation.
+		TileIndex     dest_tile;      ///< Destination tile of the train.
+		RailTypes     railtypes;      ///< Rail types the train can run on.
+		int           max_speed;      ///< Maximum speed of the train.
+		uint16        length;         ///< Length of the train.
+		DestinationID destination;    ///< Destination of the current order.
+		byte          trackdir;       ///< Trackdir of the train.
+		byte          order_type;     ///< Type of the current order.
+		byte          owner;          ///< Owner of the train.
+		byte          railtype;       ///< Rail type of the train.
+
+		inline uint CalcHash() const
+		{
+			return (this->tile * 4 + this->trackdir) ^ (this->destination << 7) ^ this->dest_tile;
+		}
+	};
+
+	/** A cached search. */
+	struct Entry {
+		Key      key;          ///< The inputs of the search.
+		uint32   state_epoch;  ///< #_rail_state_epoch at the time of the search.
+		uint32   layout_epoch; ///< #m_layout_epoch at the time of the search.
+		Trackdir trackdir;     ///< The chosen trackdir.
+		bool     path_found;   ///< Whether a path was found.
+		bool     valid;        ///< Whether the entry is used.
+	};
+
+	Entry m_entries[SIZE];          ///< The cached searches by hash of their key.
+	PathfinderSettings m_settings;  ///< The pathfinder settings the cached searches were made with.
+	uint32 m_layout_epoch;          ///< Number of changes of the track layout.
+
+public:
+	uint32 m_hits;                  ///< Number of searches answered from the cache.
+	uint32 m_misses;                ///< Number of searches that were not in the cache.
+
+	CYapfRailQueryCache() : m_layout_epoch(0), m_hits(0), m_misses(0)
+	{
+		this->Flush();
+	}
+
+	/** Get the cache. */
+	static CYapfRailQueryCache &Get()
+	{
+		static CYapfRailQueryCache cache;
+		return cache;
+	}
+
+	/** Forget all cached searches. */
+	void Flush()
+	{
+		memset(this->m_entries, 0, sizeof(this->m_entries));
+		memcpy(&this->m_settings, &_settings_game.pf, sizeof(this->m_settings));
+	}
+
+	/** The track layout changed, so the cached searches are no longer valid. */
+	inline void NotifyLayoutChange()
+	{
+		this->m_layout_epoch++;
+	}
+
+	/**
+	 * Choose the track of a train without reserving a path, from the cache when possible.
+	 * @see YapfTrainChooseTrack
+	 */
+	Trackdir ChooseRailTrack(PfnChooseRailTrack pfnChooseRailTrack, const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, PBSTileInfo *target)
+	{
+		if (memcmp(&this->m_settings, &_settings_game.pf, sizeof(this->m_settings)) != 0) this->Flush();
+
+		Key key;
+		memset(&key, 0, sizeof(key));
+		key.tile = v->tile;
+		key.dest_tile = v->dest_tile;
+		key.railtypes = v->compatible_railtypes;
+		key.max_speed = v->GetDisplayMaxSpeed();
+		key.length = v->gcache.cached_total_length;
+		key.destination = v->current_order.GetDestination();
+		key.trackdir = v->GetVehicleTrackdir();
+		key.order_type = v->current_order.GetType();
+		key.owner = v->owner;
+		key.railtype = v->railtype;
+
+		Entry &entry = this->m_entries[key.CalcHash() & (SIZE - 1)];
+		if (entry.valid && entry.state_epoch == _rail_state_epoch && entry.layout_epoch == this->m_layout_epoch && memcmp(&entry.key, &key, sizeof(key)) == 0) {
+			this->m_hits++;
+			PathfinderProfileScope::AddCacheHit();
+			if (target != NULL) target->tile = INVALID_TILE;
+			path_found = entry.path_found;
+
+			if (_debug_desync_level >= 2) {
+				bool found;
+				Trackdir result = pfnChooseRailTrack(v, tile, enterdir, tracks, found, false, NULL);
+				if (result != entry.trackdir || found != entry.path_found) {
+					DEBUG(desync, 2, "CACHE ERROR: cached ChooseRailTrack() = [%d, %d]", entry.trackdir, result);
+				}
+			}
+			return entry.trackdir;
+		}
+
+		this->m_misses++;
+		if (((this->m_hits + this->m_misses) & 0xFFF) == 0) {
+			DEBUG(yapf, 2, "train query cache: %u hits, %u misses", this->m_hits, this->m_misses);
+		}
+
+		Trackdir result = pfnChooseRailTrack(v, tile, enterdir, tracks, path_found, false, target);
+		entry.key = key;
+		entry.state_epoch = _rail_state_epoch;
+		entry.layout_epoch = this->m_layout_epoch;
+		entry.trackdir = result;
+		entry.path_found = path_found;
+		entry.valid = true;
+		return result;
+	}
+};
+
 Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
 {
 	/* default is YAPF type 2 */
-	typedef Trackdir (*PfnChooseRailTrack)(const Train*, TileIndex, DiagDirection, TrackBits, bool&, bool, PBSTileInfo*);
 	PfnChooseRailTrack pfnChooseRailTrack = &CYapfRail1::stChooseRailTrack;
 
 	/* check if non-default YAPF type needed */
@@ -546,7 +665,9 @@ Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdi
 		pfnChooseRailTrack = &CYapfRail2::stChooseRailTrack; // Trackdir, forbid 90-deg
 	}
 
-	Trackdir td_ret = pfnChooseRailTrack(v, tile, enterdir, tracks, path_found, reserve_track, target);
+	Trackdir td_ret = reserve_track ?
+			pfnChooseRailTrack(v, tile, enterdir, tracks, path_found, reserve_track, target) :
+			CYapfRailQueryCache::Get().ChooseRailTrack(pfnChooseRailTrack, v, tile, enterdir, tracks, path_found, target);
 	return (td_ret != INVALID_TRACKDIR) ? TrackdirToTrack(td_ret) : FindFirstTrack(tracks);
 }
 
@@ -645,10 +766,9 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 	return pfnFindNearestSafeTile(v, tile, td, override_railtype);
 }
 
-/** if any track changes, this counter is incremented - that will invalidate segment cost cache */
-int CSegmentCostCacheBase::s_rail_change_counter = 0;
-
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
-	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	CSegmentCostCacheBaseT<TRANSPORT_RAIL>::NotifyLayoutChange(tile);
+	CYapfLandmarks::Get(TRANSPORT_RAIL).NotifyChange(tile);
+	CYapfRailQueryCache::Get().NotifyLayoutChange();
 }
@@ -12,6 +12,7 @@
 #include "../../stdafx.h"
 #include "yapf.hpp"
 #include "yapf_node_road.hpp"
+#include "yapf_cache.h"
 #include "../../roadstop_base.h"
 
 #include "../../safeguards.h"
@@ -25,8 +26,14 @@ public:
 	typedef typename Types::TrackFollower TrackFollower; ///< track follower helper
 	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
 	typedef typename Node::Key Key;    ///< key to hash tables
+	typedef typename Node::CachedData CachedData;
 
 protected:
+	SmallVector<TileIndex, 32> m_segment_tiles; ///< Tiles of the segment calculated last.
+	bool m_disable_cache;                       ///< Whether the global segment cost cache must not be used.
+
+	CYapfCostRoadT() : m_disable_cache(false) {}
+
 	/** to access inherited path finder */
 	Tpf& Yapf()
 	{
@@ -104,18 +111,39 @@ public:
 	 */
 	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
 	{
+		CachedData &segment = *n.m_segment;
+		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
+
+		if (segment.CanBeReused()) {
+			/* the segment was walked before, and nothing of it depends on this vehicle */
+			n.m_segment_last_tile = segment.m_last_tile;
+			n.m_segment_last_td = segment.m_last_td;
+			n.m_cost = parent_cost + segment.m_cost;
+			return true;
+		}
+
 		int segment_cost = 0;
 		uint tiles = 0;
+		bool is_volatile = false;
+		m_segment_tiles.Clear();
 		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
 		TileIndex tile = n.m_key.m_tile;
 		Trackdir trackdir = n.m_key.m_td;
 		for (;;) {
+			*m_segment_tiles.Append() = tile;
+
+			/* the costs of road stops depend on their occupancy, and road stops and depots can be destinations */
+			if (IsTileType(tile, MP_STATION) || IsRoadDepotTile(tile)) is_volatile = true;
+
 			/* base tile cost depending on distance between edges */
 			segment_cost += Yapf().OneTileCost(tile, trackdir);
 
 			const RoadVehicle *v = Yapf().GetVehicle();
 			/* we have reached the vehicle's destination - segment should end here to avoid target skipping */
-			if (Yapf().PfDetectDestinationTile(tile, trackdir)) break;
+			if (Yapf().PfDetectDestinationTile(tile, trackdir)) {
+				is_volatile = true;
+				break;
+			}
 
 			/* stop if we have just entered the depot */
 			if (IsRoadDepotTile(tile) && trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
@@ -125,7 +153,11 @@ public:
 
 			/* if there are no reachable trackdirs on new tile, we have end of road */
 			TrackFollower F(Yapf().GetVehicle());
-			if (!F.Follow(tile, trackdir)) break;
+			bool followed = F.Follow(tile, trackdir);
+			/* the depots of other companies can't be entered, so whether the segment
+			 * ends or reverses in front of a depot depends on the owner of the vehicle */
+			if (F.m_err == TrackFollower::EC_OWNER) is_volatile = true;
+			if (!followed) break;
 
 			/* if there are more trackdirs available & reachable, we are at the end of segment */
 			if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) break;
@@ -148,6 +180,7 @@ public:
 			int max_speed = F.GetSpeedLimit(&min_speed);
 			if (max_speed < max_veh_speed) segment_cost += 1 * (max_veh_speed - max_speed);
 			if (min_speed > max_veh_speed) segment_cost += 10 * (min_speed - max_veh_speed);
+			if (max_speed != INT_MAX || min_speed != 0) is_volatile = true;
 
 			/* move to the next tile */
 			tile = F.m_new_tile;
@@ -159,11 +192,49 @@ public:
 		n.m_segment_last_tile = tile;
 		n.m_segment_last_td = trackdir;
 
+		/* and to the segment, so it can be cached */
+		segment.m_last_tile = tile;
+		segment.m_last_td = trackdir;
+		segment.m_cost = segment_cost;
+		segment.m_volatile = is_volatile;
+
 		/* save also tile cost */
-		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
 		n.m_cost = parent_cost + segment_cost;
 		return true;
 	}
+
+	/**
+	 * Get the tiles of the segment calculated last by #PfCalcCost.
+	 * @return The tiles.
+	 */
+	inline const SmallVector<TileIndex, 32> &GetSegmentTiles() const
+	{
+		return m_segment_tiles;
+	}
+
+	/**
+	 * Check whether the segment of a node can be taken from the global cache.
+	 * Trams are not cached, as the key of the segments doesn't contain the road type.
+	 * @param n The node.
+	 * @return True if the global cache can be used.
+	 */
+	inline bool CanUseGlobalCache(Node &n)
+	{
+		return !m_disable_cache
+			&& n.m_parent != NULL
+			&& !HasBit(Yapf().GetVehicle()->compatible_roadtypes, ROADTYPE_TRAM)
+			&& Yapf().CanUseCachedSegments();
+	}
+
+	inline void ConnectNodeToCachedData(Node &n, CachedData &ci)
+	{
+		n.m_segment = &ci;
+	}
+
+	void DisableCache(bool disable)
+	{
+		m_disable_cache = disable;
+	}
 };
 
 
@@ -194,6 +265,12 @@ public:
 		return IsRoadDepotTile(tile);
 	}
 
+	/** Cached segments never pass a depot, so they never pass a destination. */
+	inline bool CanUseCachedSegments() const
+	{
+		return true;
+	}
+
 	/**
 	 * Called by YAPF to calculate cost estimate. Calculates distance to the destination
 	 *  adds it to the actual cost from origin and stores the sum to the Node::m_estimate
@@ -221,6 +298,8 @@ protected:
 	StationID    m_dest_station;
 	bool         m_bus;
 	bool         m_non_artic;
+	bool         m_cached_segments; ///< Whether cached segments can be used, i.e. they can't pass the destination.
+	CYapfLandmarkEstimate m_landmarks; ///< Estimate using the distances to the landmarks.
 
 public:
 	void SetDestination(const RoadVehicle *v)
@@ -231,13 +310,36 @@ public:
 			m_destTile      = CalcClosestStationTile(m_dest_station, v->tile, m_bus ? STATION_BUS : STATION_TRUCK);
 			m_non_artic     = !v->HasArticulatedPart();
 			m_destTrackdirs = INVALID_TRACKDIR_BIT;
+			m_cached_segments = true;
 		} else {
 			m_dest_station  = INVALID_STATION;
 			m_destTile      = v->dest_tile;
 			m_destTrackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_ROAD, v->compatible_roadtypes));
+			m_cached_segments = IsRoadDepotTile(m_destTile);
+		}
+
+		m_landmarks.Init(TRANSPORT_ROAD);
+		if (m_landmarks.IsEnabled()) {
+			if (m_dest_station != INVALID_STATION) {
+				const Station *st = Station::Get(m_dest_station);
+				for (const RoadStop *rs = st->GetPrimaryRoadStop(m_bus ? ROADSTOP_BUS : ROADSTOP_TRUCK); rs != NULL; rs = rs->next) {
+					m_landmarks.AddTarget(rs->xy);
+				}
+			} else {
+				m_landmarks.AddTarget(m_destTile);
+			}
 		}
 	}
 
+	/**
+	 * Cached segments never pass road stops or depots, so they can be used
+	 *  unless the destination is some other tile.
+	 */
+	inline bool CanUseCachedSegments() const
+	{
+		return m_cached_segments;
+	}
+
 protected:
 	/** to access inherited path finder */
 	Tpf& Yapf()
@@ -288,6 +390,7 @@ public:
 		int dmin = min(dx, dy);
 		int dxy = abs(dx - dy);
 		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+		d = max(d, m_landmarks.GetEstimate(tile));
 		n.m_estimate = n.m_cost + d;
 		assert(n.m_estimate >= n.m_parent->m_estimate);
 		return true;
@@ -335,8 +438,21 @@ public:
 
 	static Trackdir stChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found)
 	{
-		Tpf pf;
-		return pf.ChooseRoadTrack(v, tile, enterdir, path_found);
+		Tpf pf1;
+		Trackdir result1 = pf1.ChooseRoadTrack(v, tile, enterdir, path_found);
+
+		if (_debug_desync_level >= 2) {
+			Tpf pf2;
+			bool path_found2;
+			pf2.DisableCache(true);
+			Trackdir result2 = pf2.ChooseRoadTrack(v, tile, enterdir, path_found2);
+			if (result1 != result2 || path_found != path_found2) {
+				DEBUG(desync, 2, "CACHE ERROR: ChooseRoadTrack() = [%d, %d]", result1, result2);
+				DumpState(pf1, pf2);
+			}
+		}
+
+		return result1;
 	}
 
 	inline Trackdir ChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found)
@@ -382,8 +498,20 @@ public:
 
 	static uint stDistanceToTile(const RoadVehicle *v, TileIndex tile)
 	{
-		Tpf pf;
-		return pf.DistanceToTile(v, tile);
+		Tpf pf1;
+		uint result1 = pf1.DistanceToTile(v, tile);
+
+		if (_debug_desync_level >= 2) {
+			Tpf pf2;
+			pf2.DisableCache(true);
+			uint result2 = pf2.DistanceToTile(v, tile);
+			if (result1 != result2) {
+				DEBUG(desync, 2, "CACHE ERROR: DistanceToTile() = [%u, %u]", result1, result2);
+				DumpState(pf1, pf2);
+			}
+		}
+
+		return result1;
 	}
 
 	inline uint DistanceToTile(const RoadVehicle *v, TileIndex dst_tile)
@@ -432,8 +560,20 @@ public:
 
 	static FindDepotData stFindNearestDepot(const RoadVehicle *v, TileIndex tile, Trackdir td, int max_distance)
 	{
-		Tpf pf;
-		return pf.FindNearestDepot(v, tile, td, max_distance);
+		Tpf pf1;
+		FindDepotData result1 = pf1.FindNearestDepot(v, tile, td, max_distance);
+
+		if (_debug_desync_level >= 2) {
+			Tpf pf2;
+			pf2.DisableCache(true);
+			FindDepotData result2 = pf2.FindNearestDepot(v, tile, td, max_distance);
+			if (result1.tile != result2.tile || result1.best_length != result2.best_length) {
+				DEBUG(desync, 2, "CACHE ERROR: FindNearestDepot() = [%u, %u]", result1.tile, result2.tile);
+				DumpState(pf1, pf2);
+			}
+		}
+
+		return result1;
 	}
 
 	/**
@@ -474,7 +614,7 @@ struct CYapfRoad_TypesT
 	typedef CYapfFollowRoadT<Types>           PfFollow;
 	typedef CYapfOriginTileT<Types>           PfOrigin;
 	typedef Tdestination<Types>               PfDestination;
-	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;
+	typedef CYapfSegmentCostCacheGlobalT<Types> PfCache;
 	typedef CYapfCostRoadT<Types>             PfCost;
 };
 
@@ -519,3 +659,9 @@ FindDepotData YapfRoadVehicleFindNearestDepot(const RoadVehicle *v, int max_dist
 
 	return pfnFindNearestDepot(v, tile, trackdir, max_distance);
 }
+
+void YapfNotifyRoadLayoutChange(TileIndex tile)
+{
+	CSegmentCostCacheBaseT<TRANSPORT_ROAD>::NotifyLayoutChange(tile);
+	CYapfLandmarks::Get(TRANSPORT_ROAD).NotifyChange(tile);
+}
@@ -19,6 +19,9 @@
 
 #include "safeguards.h"
 
+/** Number of changes of the signal states and the track reservations; the caches of the train pathfinder use it to see whether these changed. */
+uint32 _rail_state_epoch = 0;
+
 /* XXX: Below 3 tables store duplicate data. Maybe remove some? */
 /* Maps a trackdir to the bit that stores its status in the map arrays, in the
  * direction along with the trackdir */
@@ -19,6 +19,8 @@
 #include "tile_map.h"
 #include "signal_type.h"
 
+extern uint32 _rail_state_epoch;
+
 
 /** Different types of Rail-related tiles */
 enum RailTileType {
@@ -212,6 +214,7 @@ static inline void SetTrackReservation(TileIndex t, TrackBits b)
 	assert(IsPlainRailTile(t));
 	assert(b != INVALID_TRACK_BIT);
 	assert(!TracksOverlap(b));
+	_rail_state_epoch++;
 	Track track = RemoveFirstTrack(&b);
 	SB(_m[t].m2, 8, 3, track == INVALID_TRACK ? 0 : track + 1);
 	SB(_m[t].m2, 11, 1, (byte)(b != TRACK_BIT_NONE));
@@ -271,6 +274,7 @@ static inline bool HasDepotReservation(TileIndex t)
 static inline void SetDepotReservation(TileIndex t, bool b)
 {
 	assert(IsRailDepot(t));
+	_rail_state_epoch++;
 	SB(_m[t].m5, 4, 1, (byte)b);
 }
 
@@ -352,6 +356,7 @@ static inline void SetSignalVariant(TileIndex t, Track track, SignalVariant v)
  */
 static inline void SetSignalStates(TileIndex tile, uint state)
 {
+	_rail_state_epoch++;
 	SB(_m[tile].m4, 4, 4, state);
 }
 
@@ -14,7 +14,7 @@
 
 #include "track_func.h"
 #include "depot_type.h"
-#include "rail_type.h"
+#include "rail_map.h"
 #include "road_func.h"
 #include "tile_map.h"
 
@@ -363,6 +363,7 @@ static inline bool HasCrossingReservation(TileIndex t)
 static inline void SetCrossingReservation(TileIndex t, bool b)
 {
 	assert(IsLevelCrossingTile(t));
+	_rail_state_epoch++;
 	SB(_m[t].m5, 4, 1, b ? 1 : 0);
 }
 
@@ -19,6 +19,7 @@
 #include "articulated_vehicles.h"
 #include "newgrf_sound.h"
 #include "pathfinder/yapf/yapf.h"
+#include "pathfinder/pf_profile.h"
 #include "strings_func.h"
 #include "tunnelbridge_map.h"
 #include "date_func.h"
@@ -350,6 +351,7 @@ static FindDepotData FindClosestRoadDepot(const RoadVehicle *v, int max_distance
 {
 	if (IsRoadDepotTile(v->tile)) return FindDepotData(v->tile, 0);
 
+	PathfinderProfileScope profile(v, _settings_game.pf.pathfinder_for_roadvehs);
 	switch (_settings_game.pf.pathfinder_for_roadvehs) {
 		case VPF_NPF: return NPFRoadVehicleFindNearestDepot(v, max_distance);
 		case VPF_YAPF: return YapfRoadVehicleFindNearestDepot(v, max_distance);
@@ -970,11 +972,14 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 		return_track(FindFirstBit2x64(trackdirs));
 	}
 
-	switch (_settings_game.pf.pathfinder_for_roadvehs) {
-		case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
-		case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+	{
+		PathfinderProfileScope profile(v, _settings_game.pf.pathfinder_for_roadvehs);
+		switch (_settings_game.pf.pathfinder_for_roadvehs) {
+			case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+			case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
 
-		default: NOT_REACHED();
+			default: NOT_REACHED();
+		}
 	}
 	v->HandlePathfindingResult(path_found);
 
@@ -1328,6 +1328,7 @@ bool AfterLoadGame()
 	}
 
 	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	YapfNotifyRoadLayoutChange(INVALID_TILE);
 
 	if (IsSavegameVersionBefore(34)) {
 		Company *c;
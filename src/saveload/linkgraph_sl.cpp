@@ -15,6 +15,7 @@
 #include "../linkgraph/linkgraphschedule.h"
 #include "../settings_internal.h"
 #include "saveload.h"
+#include <algorithm>
 
 #include "../safeguards.h"
 
@@ -24,6 +25,7 @@ typedef LinkGraph::BaseEdge Edge;
 const SettingDesc *GetSettingDescription(uint index);
 
 static uint16 _num_nodes;
+static NodeID _next_edge; ///< Destination of the next edge in the savegame's list of edges of a node.
 
 /**
  * Get a SaveLoad array for a link graph.
@@ -103,7 +105,9 @@ const SaveLoad *GetLinkGraphScheduleDesc()
 	return schedule_desc;
 }
 
-/* Edges and nodes are saved in the correct order, so we don't need to save their IDs. */
+/* Edges and nodes are saved in the correct order, so we don't need to save their IDs.
+ * The edges of a node are saved as a linked list, starting with an empty edge
+ * which only holds the destination of the first real one. */
 
 /**
  * SaveLoad desc for a link graph node.
@@ -126,31 +130,69 @@ static const SaveLoad _edge_desc[] = {
 	     SLE_VAR(Edge, usage,                    SLE_UINT32),
 	     SLE_VAR(Edge, last_unrestricted_update, SLE_INT32),
 	 SLE_CONDVAR(Edge, last_restricted_update,   SLE_INT32, 187, SL_MAX_VERSION),
-	     SLE_VAR(Edge, next_edge,                SLE_UINT16),
+	    SLEG_VAR(_next_edge,                     SLE_UINT16),
 	     SLE_END()
 };
 
 /**
- * Save/load a link graph.
- * @param comp Link graph to be saved or loaded.
+ * Save a link graph.
+ * @param lg Link graph to be saved.
  */
-void SaveLoad_LinkGraph(LinkGraph &lg)
+void Save_LinkGraph(LinkGraph &lg)
 {
 	uint size = lg.Size();
 	for (NodeID from = 0; from < size; ++from) {
-		Node *node = &lg.nodes[from];
-		SlObject(node, _node_desc);
+		SlObject(&lg.nodes[from], _node_desc);
+
+		/* The most recently added edge comes first. */
+		const LinkGraph::EdgeList &edges = lg.edges[from];
+		Edge first;
+		first.Init();
+		_next_edge = edges.empty() ? INVALID_NODE : edges.back().dest;
+		SlObject(&first, _edge_desc);
+		for (size_t i = edges.size(); i > 0; --i) {
+			_next_edge = i > 1 ? edges[i - 2].dest : INVALID_NODE;
+			SlObject(const_cast<Edge *>(&edges[i - 1]), _edge_desc);
+		}
+	}
+}
+
+/**
+ * Load a link graph. The link graph has to be initialized to the right size
+ * before.
+ * @param lg Link graph to be loaded.
+ */
+void Load_LinkGraph(LinkGraph &lg)
+{
+	uint size = lg.Size();
+	for (NodeID from = 0; from < size; ++from) {
+		SlObject(&lg.nodes[from], _node_desc);
+		LinkGraph::EdgeList &edges = lg.edges[from];
 		if (IsSavegameVersionBefore(191)) {
 			/* We used to save the full matrix ... */
+			std::vector<Edge> row(size);
+			std::vector<NodeID> next_edges(size);
 			for (NodeID to = 0; to < size; ++to) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+				SlObject(&row[to], _edge_desc);
+				next_edges[to] = _next_edge;
+			}
+			for (NodeID to = next_edges[from]; to != INVALID_NODE; to = next_edges[to]) {
+				row[to].dest = to;
+				edges.push_back(row[to]);
 			}
 		} else {
 			/* ... but as that wasted a lot of space we save a sparse matrix now. */
-			for (NodeID to = from; to != INVALID_NODE; to = lg.edges[from][to].next_edge) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+			Edge edge;
+			edge.Init();
+			SlObject(&edge, _edge_desc);
+			while (_next_edge != INVALID_NODE) {
+				edge.dest = _next_edge;
+				SlObject(&edge, _edge_desc);
+				edges.push_back(edge);
 			}
 		}
+		/* The list in the savegame starts with the most recently added edge. */
+		std::reverse(edges.begin(), edges.end());
 	}
 }
 
@@ -163,7 +205,7 @@ static void DoSave_LGRJ(LinkGraphJob *lgj)
 	SlObject(lgj, GetLinkGraphJobDesc());
 	_num_nodes = lgj->Size();
 	SlObject(const_cast<LinkGraph *>(&lgj->Graph()), GetLinkGraphDesc());
-	SaveLoad_LinkGraph(const_cast<LinkGraph &>(lgj->Graph()));
+	Save_LinkGraph(const_cast<LinkGraph &>(lgj->Graph()));
 }
 
 /**
@@ -174,7 +216,7 @@ static void DoSave_LGRP(LinkGraph *lg)
 {
 	_num_nodes = lg->Size();
 	SlObject(lg, GetLinkGraphDesc());
-	SaveLoad_LinkGraph(*lg);
+	Save_LinkGraph(*lg);
 }
 
 /**
@@ -191,7 +233,7 @@ static void Load_LGRP()
 		LinkGraph *lg = new (index) LinkGraph();
 		SlObject(lg, GetLinkGraphDesc());
 		lg->Init(_num_nodes);
-		SaveLoad_LinkGraph(*lg);
+		Load_LinkGraph(*lg);
 	}
 }
 
@@ -211,7 +253,7 @@ static void Load_LGRJ()
 		LinkGraph &lg = const_cast<LinkGraph &>(lgj->Graph());
 		SlObject(&lg, GetLinkGraphDesc());
 		lg.Init(_num_nodes);
-		SaveLoad_LinkGraph(lg);
+		Load_LinkGraph(lg);
 	}
 }
 
@@ -44,6 +44,16 @@
 #include "../fios.h"
 #include "../error.h"
 
+#if defined(UNIX) && !defined(__MORPHOS__) && !defined(PSVITA)
+#	define WITH_SAVEGAME_SNAPSHOT
+#	define WITH_SAVEGAME_MMAP
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <sys/wait.h>
+#	include <signal.h>
+#endif
+
 #include "table/strings.h"
 
 #include "saveload_internal.h"
@@ -264,8 +274,10 @@
  *  194   26881   1.5.x, 1.6.0
  *  195   27572   1.6.x
  *  196   27778   1.7.x
+ *  197
+ *  198
  */
-extern const uint16 SAVEGAME_VERSION = 196; ///< Current savegame version of OpenTTD.
+extern const uint16 SAVEGAME_VERSION = 198; ///< Current savegame version of OpenTTD.
 
 SavegameType _savegame_type; ///< type of savegame we are loading
 FileToSaveLoad _file_to_saveload; ///< File to save or load in the openttd loop.
@@ -273,7 +285,7 @@ FileToSaveLoad _file_to_saveload; ///< File to save or load in the openttd loop.
 uint32 _ttdp_version;     ///< version of TTDP savegame (if applicable)
 uint16 _sl_version;       ///< the major savegame version identifier
 byte   _sl_minor_version; ///< the minor savegame version, DO NOT USE!
-char _savegame_format[8]; ///< how to compress savegames
+char _savegame_format[16]; ///< how to compress savegames
 bool _do_autosave;        ///< are we doing an autosave at the moment?
 
 /** What are we currently doing? */
@@ -310,18 +322,69 @@ struct ReadBuffer {
 	{
 	}
 
+	/** Fill the buffer with the next bytes from the filter. */
+	void FillBuffer()
+	{
+		size_t len = this->reader->Read(this->buf, lengthof(this->buf));
+		if (len == 0) SlErrorCorrupt("Unexpected end of chunk");
+
+		this->read += len;
+		this->bufp = this->buf;
+		this->bufe = this->buf + len;
+	}
+
 	inline byte ReadByte()
 	{
-		if (this->bufp == this->bufe) {
-			size_t len = this->reader->Read(this->buf, lengthof(this->buf));
+		if (this->bufp == this->bufe) this->FillBuffer();
+
+		return *this->bufp++;
+	}
+
+	/**
+	 * Read a number of bytes. Once the buffer is empty, large reads go
+	 * directly from the filter into the destination.
+	 * @param ptr    The destination of the bytes.
+	 * @param length The number of bytes to read.
+	 */
+	void CopyBytes(byte *ptr, size_t length)
+	{
+		for (;;) {
+			size_t n = min<size_t>(length, this->bufe - this->bufp);
+			memcpy(ptr, this->bufp, n);
+			this->bufp += n;
+			ptr += n;
+			length -= n;
+			if (length == 0) return;
+
+			if (length < lengthof(this->buf)) {
+				this->FillBuffer();
+				continue;
+			}
+
+			size_t len = this->reader->Read(ptr, length);
 			if (len == 0) SlErrorCorrupt("Unexpected end of chunk");
 
 			this->read += len;
-			this->bufp = this->buf;
-			this->bufe = this->buf + len;
+			ptr += len;
+			length -= len;
+			if (length == 0) return;
 		}
+	}
 
-		return *this->bufp++;
+	/**
+	 * Skip a number of bytes.
+	 * @param length The number of bytes to skip.
+	 */
+	void SkipBytes(size_t length)
+	{
+		for (;;) {
+			size_t n = min<size_t>(length, this->bufe - this->bufp);
+			this->bufp += n;
+			length -= n;
+			if (length == 0) return;
+
+			this->FillBuffer();
+		}
 	}
 
 	/**
@@ -362,6 +425,28 @@ struct MemoryDumper {
 		*this->buf++ = b;
 	}
 
+	/**
+	 * Write a number of bytes into the dumper.
+	 * @param ptr    The bytes to write.
+	 * @param length The number of bytes to write.
+	 */
+	void CopyBytes(const byte *ptr, size_t length)
+	{
+		while (length != 0) {
+			if (this->buf == this->bufe) {
+				this->buf = CallocT<byte>(MEMORY_CHUNK_SIZE);
+				*this->blocks.Append() = this->buf;
+				this->bufe = this->buf + MEMORY_CHUNK_SIZE;
+			}
+
+			size_t n = min<size_t>(length, this->bufe - this->buf);
+			memcpy(this->buf, ptr, n);
+			this->buf += n;
+			ptr += n;
+			length -= n;
+		}
+	}
+
 	/**
 	 * Flush this dumper into a writer.
 	 * @param writer The filter we want to use.
@@ -564,6 +649,9 @@ void NORETURN SlErrorCorrupt(const char *msg)
 typedef void (*AsyncSaveFinishProc)();                ///< Callback for when the savegame loading is finished.
 static AsyncSaveFinishProc _async_save_finish = NULL; ///< Callback to call when the savegame loading is finished.
 static ThreadObject *_save_thread;                    ///< The thread we're using to compress and write a savegame
+#if defined(WITH_SAVEGAME_SNAPSHOT)
+static pid_t _snapshot_pid = -1;                      ///< The process writing a snapshot of the game, or -1 if there is none.
+#endif
 
 /**
  * Called by save thread to tell we finished saving.
@@ -577,11 +665,48 @@ static void SetAsyncSaveFinish(AsyncSaveFinishProc proc)
 	_async_save_finish = proc;
 }
 
+/**
+ * Handle the end of writing a snapshot of the game.
+ * @param wait Whether to wait till the snapshot has been written. The wait is
+ *             bounded; a snapshot that is not done by then is killed.
+ */
+static void ProcessSnapshotSaveFinish(bool wait)
+{
+#if defined(WITH_SAVEGAME_SNAPSHOT)
+	/* Time to wait for the snapshot before giving up on it, in milliseconds. */
+	static const int SNAPSHOT_WAIT_TIMEOUT = 60000;
+
+	if (_snapshot_pid == -1) return;
+
+	int status;
+	pid_t pid = waitpid(_snapshot_pid, &status, WNOHANG);
+	for (int waited = 0; wait && pid == 0 && waited < SNAPSHOT_WAIT_TIMEOUT; waited += 10) {
+		CSleep(10);
+		pid = waitpid(_snapshot_pid, &status, WNOHANG);
+	}
+	if (pid == 0) {
+		if (!wait) return;
+
+		DEBUG(sl, 0, "Snapshot is still being written after %d seconds, killing it", SNAPSHOT_WAIT_TIMEOUT / 1000);
+		kill(_snapshot_pid, SIGKILL);
+		pid = waitpid(_snapshot_pid, &status, 0);
+	}
+	/* A failed waitpid means the child is gone already, e.g. reaped by someone else. */
+	bool failed = pid != _snapshot_pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	_snapshot_pid = -1;
+
+	InvalidateWindowData(WC_STATUS_BAR, 0, SBI_SAVELOAD_FINISH);
+	if (failed) ShowErrorMessage(STR_ERROR_AUTOSAVE_FAILED, INVALID_STRING_ID, WL_ERROR);
+#endif
+}
+
 /**
  * Handle async save finishes.
  */
 void ProcessAsyncSaveFinish()
 {
+	ProcessSnapshotSaveFinish(false);
+
 	if (_async_save_finish == NULL) return;
 
 	_async_save_finish();
@@ -657,7 +782,7 @@ static inline void SlWriteUint64(uint64 x)
  */
 static inline void SlSkipBytes(size_t length)
 {
-	for (; length != 0; length--) SlReadByte();
+	_sl.reader->SkipBytes(length);
 }
 
 /**
@@ -918,10 +1043,10 @@ static void SlCopyBytes(void *ptr, size_t length)
 	switch (_sl.action) {
 		case SLA_LOAD_CHECK:
 		case SLA_LOAD:
-			for (; length != 0; length--) *p++ = SlReadByte();
+			_sl.reader->CopyBytes(p, length);
 			break;
 		case SLA_SAVE:
-			for (; length != 0; length--) SlWriteByte(*p++);
+			_sl.dumper->CopyBytes(p, length);
 			break;
 		default: NOT_REACHED();
 	}
@@ -1213,6 +1338,15 @@ void SlArray(void *array, size_t length, VarType conv)
 	 * conversion is needed, use specialized copy-copy function to speed up things */
 	if (conv == SLE_INT8 || conv == SLE_UINT8) {
 		SlCopyBytes(array, length);
+	} else if (_sl.action != SLA_SAVE && (conv == SLE_INT16 || conv == SLE_UINT16)) {
+		/* Same size in file and memory; read all at once and convert from big endian in place. */
+		uint16 *a = (uint16 *)array;
+		SlCopyBytes(a, length * sizeof(*a));
+		for (size_t i = 0; i < length; i++) a[i] = FROM_BE16(a[i]);
+	} else if (_sl.action != SLA_SAVE && (conv == SLE_INT32 || conv == SLE_UINT32)) {
+		uint32 *a = (uint32 *)array;
+		SlCopyBytes(a, length * sizeof(*a));
+		for (size_t i = 0; i < length; i++) a[i] = FROM_BE32(a[i]);
 	} else {
 		byte *a = (byte*)array;
 		byte mem_size = SlCalcConvMemLen(conv);
@@ -1889,20 +2023,40 @@ static void SlFixPointers()
 
 /** Yes, simply reading from a file. */
 struct FileReader : LoadFilter {
-	FILE *file; ///< The file to read from.
-	long begin; ///< The begin of the file.
+	FILE *file;      ///< The file to read from.
+	long begin;      ///< The begin of the file.
+	byte *map;       ///< The file mapped into memory, or NULL when reading it with fread.
+	size_t map_size; ///< Size of the mapped file.
+	size_t map_pos;  ///< Position in the mapped file to read from next.
 
 	/**
 	 * Create the file reader, so it reads from a specific file.
+	 * Where possible the file is mapped into memory, so reading it
+	 * does not need a system call for every buffer.
 	 * @param file The file to read from.
 	 */
-	FileReader(FILE *file) : LoadFilter(NULL), file(file), begin(ftell(file))
+	FileReader(FILE *file) : LoadFilter(NULL), file(file), begin(ftell(file)), map(NULL), map_size(0), map_pos(0)
 	{
+#if defined(WITH_SAVEGAME_MMAP)
+		struct stat st;
+		if (this->begin < 0 || fstat(fileno(file), &st) != 0 || st.st_size <= this->begin) return;
+
+		void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+		if (map == MAP_FAILED) return;
+
+		madvise(map, st.st_size, MADV_SEQUENTIAL);
+		this->map = (byte *)map;
+		this->map_size = st.st_size;
+		this->map_pos = this->begin;
+#endif
 	}
 
 	/** Make sure everything is cleaned up. */
 	~FileReader()
 	{
+#if defined(WITH_SAVEGAME_MMAP)
+		if (this->map != NULL) munmap(this->map, this->map_size);
+#endif
 		if (this->file != NULL) fclose(this->file);
 		this->file = NULL;
 
@@ -1915,11 +2069,23 @@ struct FileReader : LoadFilter {
 		/* We're in the process of shutting down, i.e. in "failure" mode. */
 		if (this->file == NULL) return 0;
 
+		if (this->map != NULL) {
+			size = min(size, this->map_size - this->map_pos);
+			memcpy(buf, this->map + this->map_pos, size);
+			this->map_pos += size;
+			return size;
+		}
+
 		return fread(buf, 1, size, this->file);
 	}
 
 	/* virtual */ void Reset()
 	{
+		if (this->map != NULL) {
+			this->map_pos = this->begin;
+			return;
+		}
+
 		clearerr(this->file);
 		if (fseek(this->file, this->begin, SEEK_SET)) {
 			DEBUG(sl, 1, "Could not reset the file reading");
@@ -2334,6 +2500,326 @@ struct LZMASaveFilter : SaveFilter {
 
 #endif /* WITH_LZMA */
 
+/********************************************
+ ******** START OF BLOCK COMPRESSED CODE ****
+ ********************************************/
+
+#if defined(WITH_ZLIB) || defined(WITH_LZMA)
+
+/**
+ * Compressors for the blocks of a block compressed savegame.
+ * The savegame is split into blocks that are compressed independently, so
+ * they can be compressed and decompressed by multiple threads at once.
+ * After the savegame header follows a block header with the compressor,
+ * the block size and the number of blocks, then the compressed and
+ * uncompressed size of each block and finally the compressed blocks.
+ * All numbers are 32 bits big endian.
+ */
+enum BlockCompressor {
+	BC_ZLIB = 1, ///< Blocks are compressed by zlib.
+	BC_LZMA = 2, ///< Blocks are compressed by liblzma.
+};
+
+static const uint32 SAVEGAME_BLOCK_SIZE = 1 << 20; ///< Uncompressed size of all blocks, except the last one.
+static const uint32 SAVEGAME_MAX_BLOCKS = 4096;    ///< Maximum number of blocks, i.e. 4 GB uncompressed.
+
+/** A block of a block compressed savegame. */
+struct SavegameBlock {
+	byte *data;             ///< Uncompressed data when saving, compressed data when loading.
+	uint32 size;            ///< Uncompressed size of the block.
+	byte *compressed;       ///< Compressed data when saving, uncompressed data when loading.
+	uint32 compressed_size; ///< Compressed size of the block.
+	bool failed;            ///< Whether (de)compressing the block failed.
+};
+
+/** Blocks to (de)compress; for #RunParallel. */
+struct SavegameBlocks {
+	BlockCompressor compressor; ///< Compressor of the blocks.
+	byte compression_level;     ///< Compression level when saving.
+	SavegameBlock *blocks;      ///< The blocks.
+};
+
+/**
+ * Compress a range of blocks of a savegame; for #RunParallel.
+ * The uncompressed data of the blocks is freed.
+ * @param param The #SavegameBlocks to compress.
+ * @param first The first block to compress.
+ * @param last  One past the last block to compress.
+ */
+static void CompressSavegameBlocks(void *param, uint first, uint last)
+{
+	const SavegameBlocks *sb = (const SavegameBlocks *)param;
+	for (uint i = first; i < last; i++) {
+		SavegameBlock *block = &sb->blocks[i];
+		size_t size = 0;
+		switch (sb->compressor) {
+#if defined(WITH_ZLIB)
+			case BC_ZLIB: {
+				uLongf out_size = compressBound(block->size);
+				block->compressed = MallocT<byte>(out_size);
+				block->failed = compress2(block->compressed, &out_size, block->data, block->size, sb->compression_level) != Z_OK;
+				size = out_size;
+				break;
+			}
+#endif
+#if defined(WITH_LZMA)
+			case BC_LZMA: {
+				size_t out_size = lzma_stream_buffer_bound(block->size);
+				block->compressed = MallocT<byte>(out_size);
+				block->failed = lzma_easy_buffer_encode(sb->compression_level, LZMA_CHECK_CRC32, NULL, block->data, block->size, block->compressed, &size, out_size) != LZMA_OK;
+				break;
+			}
+#endif
+			default: NOT_REACHED();
+		}
+		block->compressed_size = (uint32)size;
+		free(block->data);
+		block->data = NULL;
+	}
+}
+
+/**
+ * Decompress a range of blocks of a savegame; for #RunParallel.
+ * @param param The #SavegameBlocks to decompress.
+ * @param first The first block to decompress.
+ * @param last  One past the last block to decompress.
+ */
+static void DecompressSavegameBlocks(void *param, uint first, uint last)
+{
+	const SavegameBlocks *sb = (const SavegameBlocks *)param;
+	for (uint i = first; i < last; i++) {
+		SavegameBlock *block = &sb->blocks[i];
+		switch (sb->compressor) {
+#if defined(WITH_ZLIB)
+			case BC_ZLIB: {
+				uLongf out_size = block->size;
+				block->failed = uncompress(block->compressed, &out_size, block->data, block->compressed_size) != Z_OK || out_size != block->size;
+				break;
+			}
+#endif
+#if defined(WITH_LZMA)
+			case BC_LZMA: {
+				/* Allow blocks up to 256 MB uncompressed, like LZMALoadFilter. */
+				uint64_t memlimit = 1 << 28;
+				size_t in_pos = 0;
+				size_t out_pos = 0;
+				block->failed = lzma_stream_buffer_decode(&memlimit, 0, NULL, block->data, &in_pos, block->compressed_size, block->compressed, &out_pos, block->size) != LZMA_OK || out_pos != block->size;
+				break;
+			}
+#endif
+			default:
+				block->failed = true;
+				break;
+		}
+	}
+}
+
+/** Filter reading block compressed savegames, decompressing a batch of blocks at once. */
+struct BlockLoadFilter : LoadFilter {
+	BlockCompressor compressor; ///< Compressor of the blocks.
+	uint32 block_count;         ///< Number of blocks in the savegame.
+	uint32 next_block;          ///< First block that has not been read yet.
+	uint32 *index;              ///< Compressed and uncompressed size of each block.
+	byte *read_buf;             ///< Compressed data of the current batch of blocks.
+	byte *buf;                  ///< Uncompressed data of the current batch of blocks.
+	size_t buf_pos;             ///< Position of the next byte to return in buf.
+	size_t buf_size;            ///< Number of bytes in buf.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	BlockLoadFilter(LoadFilter *chain) : LoadFilter(chain), next_block(0), index(NULL), read_buf(NULL), buf(NULL), buf_pos(0), buf_size(0)
+	{
+		uint32 hdr[3];
+		if (this->chain->Read((byte *)hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+
+		this->compressor = (BlockCompressor)TO_BE32(hdr[0]);
+		this->block_count = TO_BE32(hdr[2]);
+		if (TO_BE32(hdr[1]) != SAVEGAME_BLOCK_SIZE) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "unsupported block size");
+		if (this->block_count > SAVEGAME_MAX_BLOCKS) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "too many blocks");
+
+		this->index = MallocT<uint32>(this->block_count * 2);
+		size_t index_size = this->block_count * 2 * sizeof(uint32);
+		if (this->chain->Read((byte *)this->index, index_size) != index_size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+		for (uint i = 0; i < this->block_count * 2; i++) {
+			this->index[i] = TO_BE32(this->index[i]);
+			if (this->index[i] > SAVEGAME_BLOCK_SIZE * 2) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "invalid block size");
+		}
+	}
+
+	/** Clean everything up. */
+	~BlockLoadFilter()
+	{
+		free(this->buf);
+		free(this->read_buf);
+		free(this->index);
+	}
+
+	/** Read and decompress the next batch of blocks into the buffer. */
+	void ReadBlocks()
+	{
+		uint count = min(this->block_count - this->next_block, GetWorkerThreadCount() * 2);
+		SavegameBlock *blocks = AllocaM(SavegameBlock, count);
+
+		size_t compressed_size = 0;
+		this->buf_size = 0;
+		for (uint i = 0; i < count; i++) {
+			blocks[i].compressed_size = this->index[(this->next_block + i) * 2];
+			blocks[i].size = this->index[(this->next_block + i) * 2 + 1];
+			compressed_size += blocks[i].compressed_size;
+			this->buf_size += blocks[i].size;
+		}
+
+		this->read_buf = ReallocT(this->read_buf, max<size_t>(compressed_size, 1));
+		this->buf = ReallocT(this->buf, max<size_t>(this->buf_size, 1));
+		if (this->chain->Read(this->read_buf, compressed_size) != compressed_size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+
+		byte *in = this->read_buf;
+		byte *out = this->buf;
+		for (uint i = 0; i < count; i++) {
+			blocks[i].data = in;
+			blocks[i].compressed = out;
+			in += blocks[i].compressed_size;
+			out += blocks[i].size;
+		}
+
+		SavegameBlocks sb = { this->compressor, 0, blocks };
+		RunParallel(&DecompressSavegameBlocks, &sb, count, 1);
+		for (uint i = 0; i < count; i++) {
+			if (blocks[i].failed) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "decompressing block failed");
+		}
+
+		this->next_block += count;
+		this->buf_pos = 0;
+	}
+
+	/* virtual */ size_t Read(byte *buf, size_t size)
+	{
+		size_t read = 0;
+		while (read < size) {
+			if (this->buf_pos == this->buf_size) {
+				if (this->next_block == this->block_count) break;
+				this->ReadBlocks();
+				continue;
+			}
+
+			size_t n = min(size - read, this->buf_size - this->buf_pos);
+			memcpy(buf + read, this->buf + this->buf_pos, n);
+			this->buf_pos += n;
+			read += n;
+		}
+		return read;
+	}
+};
+
+/** Filter writing block compressed savegames, compressing a batch of blocks at once. */
+struct BlockSaveFilter : SaveFilter {
+	BlockCompressor compressor;            ///< Compressor of the blocks.
+	byte compression_level;                ///< Compression level of the blocks.
+	SmallVector<SavegameBlock, 16> blocks; ///< All blocks of the savegame.
+	uint compressed;                       ///< Number of blocks that have been compressed.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 * @param compressor        The compressor of the blocks.
+	 */
+	BlockSaveFilter(SaveFilter *chain, byte compression_level, BlockCompressor compressor) : SaveFilter(chain), compressor(compressor), compression_level(compression_level), compressed(0)
+	{
+	}
+
+	/** Clean up what we allocated. */
+	~BlockSaveFilter()
+	{
+		for (SavegameBlock *block = this->blocks.Begin(); block != this->blocks.End(); block++) {
+			free(block->data);
+			free(block->compressed);
+		}
+	}
+
+	/**
+	 * Compress the blocks that have not been compressed yet.
+	 * @param count Number of blocks to compress.
+	 */
+	void CompressBlocks(uint count)
+	{
+		SavegameBlocks sb = { this->compressor, this->compression_level, this->blocks.Get(this->compressed) };
+		RunParallel(&CompressSavegameBlocks, &sb, count, 1);
+		for (uint i = 0; i < count; i++) {
+			if (sb.blocks[i].failed) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "compressing block failed");
+		}
+		this->compressed += count;
+	}
+
+	/* virtual */ void Write(byte *buf, size_t size)
+	{
+		while (size > 0) {
+			if (this->blocks.Length() == this->compressed || this->blocks.End()[-1].size == SAVEGAME_BLOCK_SIZE) {
+				/* Compress the full blocks once there is enough work for all threads. */
+				uint full = this->blocks.Length() - this->compressed;
+				if (full >= GetWorkerThreadCount() * 2) this->CompressBlocks(full);
+
+				SavegameBlock *block = this->blocks.Append();
+				block->data = MallocT<byte>(SAVEGAME_BLOCK_SIZE);
+				block->size = 0;
+				block->compressed = NULL;
+				block->compressed_size = 0;
+				block->failed = false;
+			}
+
+			SavegameBlock *block = &this->blocks.End()[-1];
+			size_t n = min<size_t>(size, SAVEGAME_BLOCK_SIZE - block->size);
+			memcpy(block->data + block->size, buf, n);
+			block->size += (uint32)n;
+			buf += n;
+			size -= n;
+		}
+	}
+
+	/* virtual */ void Finish()
+	{
+		this->CompressBlocks(this->blocks.Length() - this->compressed);
+
+		uint32 hdr[3] = { TO_BE32(this->compressor), TO_BE32(SAVEGAME_BLOCK_SIZE), TO_BE32(this->blocks.Length()) };
+		this->chain->Write((byte *)hdr, sizeof(hdr));
+
+		SmallVector<uint32, 64> index;
+		for (const SavegameBlock *block = this->blocks.Begin(); block != this->blocks.End(); block++) {
+			*index.Append() = TO_BE32(block->compressed_size);
+			*index.Append() = TO_BE32(block->size);
+		}
+		if (index.Length() != 0) this->chain->Write((byte *)index.Begin(), index.Length() * sizeof(uint32));
+
+		for (SavegameBlock *block = this->blocks.Begin(); block != this->blocks.End(); block++) {
+			this->chain->Write(block->compressed, block->compressed_size);
+			free(block->compressed);
+			block->compressed = NULL;
+		}
+
+		this->chain->Finish();
+	}
+};
+
+/**
+ * Filter writing block compressed savegames with a given compressor.
+ * @tparam Tcompressor The compressor of the blocks.
+ */
+template <BlockCompressor Tcompressor>
+struct BlockSaveFilterT : BlockSaveFilter {
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	BlockSaveFilterT(SaveFilter *chain, byte compression_level) : BlockSaveFilter(chain, compression_level, Tcompressor)
+	{
+	}
+};
+
+#endif /* WITH_ZLIB || WITH_LZMA */
+
 /*******************************************
  ************* END OF CODE *****************
  *******************************************/
@@ -2353,6 +2839,18 @@ struct SaveLoadFormat {
 
 /** The different saveload formats known/understood by OpenTTD. */
 static const SaveLoadFormat _saveload_formats[] = {
+	/* Block compressed savegames are a few percent larger than when compressed as a single stream, but they are
+	 * compressed and decompressed by all worker threads at once. Both compressors share the same tag, as the
+	 * compressor of the blocks is stored in the block header. They are listed first so they are never the default. */
+#if defined(WITH_ZLIB)
+	{"zlib-mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>,  CreateSaveFilter<BlockSaveFilterT<BC_ZLIB> >, 0, 6, 9},
+#endif
+#if defined(WITH_LZMA)
+	{"lzma-mt", TO_BE32X('OTTB'), CreateLoadFilter<BlockLoadFilter>,  CreateSaveFilter<BlockSaveFilterT<BC_LZMA> >, 0, 2, 9},
+#endif
+#if !defined(WITH_ZLIB) && !defined(WITH_LZMA)
+	{"zlib-mt", TO_BE32X('OTTB'), NULL,                               NULL,                                          0, 0, 0},
+#endif
 #if defined(WITH_LZO)
 	/* Roughly 75% larger than zlib level 6 at only ~7% of the CPU usage. */
 	{"lzo",    TO_BE32X('OTTD'), CreateLoadFilter<LZOLoadFilter>,    CreateSaveFilter<LZOSaveFilter>,    0, 0, 0},
@@ -2559,6 +3057,8 @@ static void SaveFileToDiskThread(void *arg)
 
 void WaitTillSaved()
 {
+	ProcessSnapshotSaveFinish(true);
+
 	if (_save_thread == NULL) return;
 
 	_save_thread->Join();
@@ -2873,6 +3373,68 @@ SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, Detaile
 	}
 }
 
+/**
+ * Save the game from a snapshot of its state, so the game continues while
+ * the chunks are serialised and written. The snapshot is a forked process:
+ * copy-on-write keeps its copy of the pools and map arrays unchanged while
+ * the game goes on. Used for autosaves; the outcome is handled by
+ * #ProcessAsyncSaveFinish. When no snapshot can be made, the game is saved
+ * by #SaveOrLoad. When the previous snapshot is still being written, the
+ * game is not saved and #SL_ERROR is returned.
+ * @param filename The name of the savegame being created.
+ * @param sb The sub directory to save the savegame in.
+ * @return Return the result of the action. #SL_OK or #SL_ERROR
+ */
+SaveOrLoadResult SaveSnapshot(const char *filename, Subdirectory sb)
+{
+#if defined(WITH_SAVEGAME_SNAPSHOT)
+	if (_snapshot_pid != -1) {
+		DEBUG(sl, 0, "Previous snapshot is still being written, not saving '%s'", filename);
+		return SL_ERROR;
+	}
+
+	FILE *fh = _sl.saveinprogress ? NULL : FioFOpenFile(filename, "wb", sb);
+	if (fh == NULL) return SaveOrLoad(filename, SLO_SAVE, DFT_GAME_FILE, sb);
+
+	DEBUG(desync, 1, "save: %08x; %02x; %s", _date, _date_fract, filename);
+	SaveViewportBeforeSaveGame();
+
+	/* Do not let the snapshot write what is still buffered for us. */
+	fflush(NULL);
+	pid_t pid = fork();
+	if (pid == 0) {
+		/* We are the snapshot; write it and leave without cleaning up the game.
+		 * Only this thread exists in the snapshot, so compress without the worker threads. */
+		DisableParallel();
+		SaveOrLoadResult result = SL_ERROR;
+		try {
+			_sl.action = SLA_SAVE;
+			_sl.dumper = new MemoryDumper();
+			_sl.sf = new FileWriter(fh);
+			_sl_version = SAVEGAME_VERSION;
+			SlSaveChunks();
+			result = SaveFileToDisk(false);
+		} catch (...) {
+			/* Skip the "colour" character */
+			DEBUG(sl, 0, "%s", GetSaveLoadErrorString() + 3);
+		}
+		_exit(result == SL_OK ? 0 : 1);
+	}
+
+	fclose(fh);
+	if (pid == -1) {
+		DEBUG(sl, 1, "Cannot fork to write a snapshot, reverting to a normal save...");
+		return SaveOrLoad(filename, SLO_SAVE, DFT_GAME_FILE, sb);
+	}
+
+	_snapshot_pid = pid;
+	InvalidateWindowData(WC_STATUS_BAR, 0, SBI_SAVELOAD_START);
+	return SL_OK;
+#else
+	return SaveOrLoad(filename, SLO_SAVE, DFT_GAME_FILE, sb);
+#endif
+}
+
 /** Do a save when exiting the game (_settings_client.gui.autosave_on_exit) */
 void DoExitSave()
 {
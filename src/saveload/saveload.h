@@ -52,6 +52,7 @@ void GenerateDefaultSaveName(char *buf, const char *last);
 void SetSaveLoadError(StringID str);
 const char *GetSaveLoadErrorString();
 SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, DetailedFileType dft, Subdirectory sb, bool threaded = true);
+SaveOrLoadResult SaveSnapshot(const char *filename, Subdirectory sb);
 void WaitTillSaved();
 void ProcessAsyncSaveFinish();
 void DoExitSave();
@@ -551,7 +552,7 @@ void NORETURN SlErrorCorrupt(const char *msg);
 
 bool SaveloadCrashWithMissingNewGRFs();
 
-extern char _savegame_format[8];
+extern char _savegame_format[16];
 extern bool _do_autosave;
 
 #endif /* SAVELOAD_H */
@@ -1711,6 +1711,7 @@ static SettingsContainer &GetSettingsTree()
 			{
 				cdist->Add(new SettingEntry("linkgraph.recalc_time"));
 				cdist->Add(new SettingEntry("linkgraph.recalc_interval"));
+				cdist->Add(new SettingEntry("linkgraph.recalc_jobs"));
 				cdist->Add(new SettingEntry("linkgraph.distribution_pax"));
 				cdist->Add(new SettingEntry("linkgraph.distribution_mail"));
 				cdist->Add(new SettingEntry("linkgraph.distribution_armoured"));
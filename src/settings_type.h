@@ -103,6 +103,10 @@ struct GUISettings {
 	bool   disable_unsuitable_building;      ///< disable infrastructure building when no suitable vehicles are available
 	byte   autosave;                         ///< how often should we do autosaves?
 	bool   threaded_saves;                   ///< should we do threaded saves?
+	bool   autosave_snapshot;                ///< should autosaves be written from a snapshot of the game, so the game does not pause?
+	uint8  worker_threads;                   ///< number of threads to divide work over, 0 = number of cores
+	bool   sprite_prefetch;                  ///< should the sprites around the main viewport be loaded before they are needed?
+	bool   parallel_repaint;                 ///< should the blitting of the dirty parts of the screen be divided over the worker threads?
 	bool   keep_all_autosave;                ///< name the autosave in a different way
 	bool   autosave_on_exit;                 ///< save an autosave when you quit the game, but do not ask "Do you really want to quit?"
 	uint8  date_format_in_default_names;     ///< should the default savegame/screenshot name use long dates (31th Dec 2008), short dates (31-12-2008) or ISO dates (2008-12-31)
@@ -372,6 +376,7 @@ struct NPFSettings {
 /** Settings related to the yet another pathfinder. */
 struct YAPFSettings {
 	bool   disable_node_optimization;        ///< whether to use exit-dir instead of trackdir in node key
+	bool   use_landmarks;                    ///< whether to improve the rail and road estimates with the distances to landmarks
 	uint32 max_search_nodes;                 ///< stop path-finding when this number of nodes visited
 	uint32 maximum_go_to_depot_penalty;      ///< What is the maximum penalty that may be endured for going to a depot
 	bool   ship_use_yapf;                    ///< use YAPF for ships
@@ -493,6 +498,7 @@ struct EconomySettings {
 struct LinkGraphSettings {
 	uint16 recalc_time;                         ///< time (in days) for recalculating each link graph component.
 	uint16 recalc_interval;                     ///< time (in days) between subsequent checks for link graphs to be calculated.
+	uint8 recalc_jobs;                          ///< number of link graph jobs started at once.
 	DistributionTypeByte distribution_pax;      ///< distribution type for passengers
 	DistributionTypeByte distribution_mail;     ///< distribution type for mail
 	DistributionTypeByte distribution_armoured; ///< distribution type for armoured cargo class
@@ -20,6 +20,7 @@
 #include "station_base.h"
 #include "newgrf_engine.h"
 #include "pathfinder/yapf/yapf.h"
+#include "pathfinder/pf_profile.h"
 #include "newgrf_sound.h"
 #include "spritecache.h"
 #include "strings_func.h"
@@ -348,6 +349,7 @@ static bool CheckShipLeaveDepot(Ship *v)
 		/* Ask pathfinder for best direction */
 		bool reverse = false;
 		bool path_found;
+		PathfinderProfileScope profile(v, _settings_game.pf.pathfinder_for_ships);
 		switch (_settings_game.pf.pathfinder_for_ships) {
 			case VPF_OPF: reverse = OPFShipChooseTrack(v, north_neighbour, north_dir, north_tracks, path_found) == INVALID_TRACK; break; // OPF always allows reversing
 			case VPF_NPF: reverse = NPFShipCheckReverse(v); break;
@@ -447,6 +449,7 @@ static Track ChooseShipTrack(Ship *v, TileIndex tile, DiagDirection enterdir, Tr
 
 	bool path_found = true;
 	Track track;
+	PathfinderProfileScope profile(v, _settings_game.pf.pathfinder_for_ships);
 	switch (_settings_game.pf.pathfinder_for_ships) {
 		case VPF_OPF: track = OPFShipChooseTrack(v, tile, enterdir, tracks, path_found); break;
 		case VPF_NPF: track = NPFShipChooseTrack(v, tile, enterdir, tracks, path_found); break;
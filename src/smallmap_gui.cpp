@@ -571,6 +571,73 @@ static const byte _vehicle_type_colours[6] = {
 	PC_RED, PC_YELLOW, PC_LIGHT_BLUE, PC_WHITE, PC_BLACK, PC_RED
 };
 
+/** Colours of a group of tiles in the smallmap, as cached by #SmallMapCache. */
+struct SmallMapCacheEntry {
+	uint16 x;      ///< X coordinate of the group, in groups; \c UINT16_MAX when the entry is unused.
+	uint16 y;      ///< Y coordinate of the group, in groups.
+	uint32 colour; ///< Colours of the group, see #SmallMapWindow::GetTileColours.
+};
+
+/**
+ * Colours of the groups of tiles shown in the smallmap, so redrawing the
+ * smallmap only needs to look at the tiles that changed. The entries cover
+ * a square of groups, which moves along with the displayed part of the map.
+ */
+struct SmallMapCache {
+	SmallMapCacheEntry *entries; ///< The entries, indexed by the group coordinates modulo the size of the square.
+	uint size_bits;              ///< Log2 of the width and height of the square of entries.
+	int zoom;                    ///< Number of tiles along the sides of a group.
+	uint offset_x;               ///< X coordinate of the first tiles of the groups, modulo #zoom.
+	uint offset_y;               ///< Y coordinate of the first tiles of the groups, modulo #zoom.
+	int map_type;                ///< Map type of the colours.
+	uint8 land_colour;           ///< Colour scheme of the colours, see #GUISettings::smallmap_land_colour.
+	bool show_heightmap;         ///< Whether the colours show the heightmap, see #_smallmap_show_heightmap.
+	uint refresh_row;            ///< Next row of entries to forget, see #SmallMapWindow::OnTick.
+};
+
+static SmallMapCache _smallmap_cache; ///< Colours of the groups of tiles shown in the smallmap.
+
+/** Number of parts in which the cached smallmap colours are forgotten, one part every #SmallMapWindow::FORCE_REFRESH_PERIOD. */
+static const uint SMALLMAP_CACHE_REFRESH_PARTS = 8;
+
+/**
+ * Forget a number of rows of the cached smallmap colours.
+ * @param first The first row.
+ * @param count The number of rows.
+ */
+static void InvalidateSmallMapCacheRows(uint first, uint count)
+{
+	SmallMapCacheEntry *entries = _smallmap_cache.entries + (first << _smallmap_cache.size_bits);
+	for (uint i = 0; i < count << _smallmap_cache.size_bits; i++) entries[i].x = UINT16_MAX;
+}
+
+/** Forget all cached smallmap colours. */
+static void InvalidateSmallMapCache()
+{
+	if (_smallmap_cache.entries == NULL) return;
+	InvalidateSmallMapCacheRows(0, 1U << _smallmap_cache.size_bits);
+}
+
+/**
+ * Forget the cached smallmap colours of a tile, as it changed.
+ * @param tile The tile.
+ */
+void MarkSmallMapTileDirty(TileIndex tile)
+{
+	const SmallMapCache *cache = &_smallmap_cache;
+	if (cache->entries == NULL) return;
+
+	uint x = TileX(tile);
+	uint y = TileY(tile);
+	if (x < cache->offset_x || y < cache->offset_y) return; // The tile is in a group that is not shown.
+
+	uint mask = (1U << cache->size_bits) - 1;
+	uint gx = (x - cache->offset_x) / cache->zoom;
+	uint gy = (y - cache->offset_y) / cache->zoom;
+	SmallMapCacheEntry *entry = &cache->entries[((gy & mask) << cache->size_bits) | (gx & mask)];
+	if (entry->x == gx && entry->y == gy) entry->x = UINT16_MAX;
+}
+
 
 inline Point SmallMapWindow::SmallmapRemapCoords(int x, int y) const
 {
@@ -795,6 +862,68 @@ inline uint32 SmallMapWindow::GetTileColours(const TileArea &ta) const
 	}
 }
 
+/**
+ * Make sure the cached smallmap colours are for the current display of the
+ * smallmap, forgetting them when the zoom level, the map type or the colour
+ * scheme changed.
+ */
+void SmallMapWindow::UpdateCache() const
+{
+	SmallMapCache *cache = &_smallmap_cache;
+
+	/* The square of entries must be larger than the groups shown along each axis. */
+	const NWidgetBase *wi = this->GetWidget<NWidgetBase>(WID_SM_MAP);
+	uint size_bits = FindLastBit(wi->current_x / 4 + wi->current_y / 2 + 4) + 1;
+	int scroll_x = this->scroll_x / (int)TILE_SIZE;
+	int scroll_y = this->scroll_y / (int)TILE_SIZE;
+	uint offset_x = ((scroll_x % this->zoom) + this->zoom) % this->zoom;
+	uint offset_y = ((scroll_y % this->zoom) + this->zoom) % this->zoom;
+	uint8 land_colour = _settings_client.gui.smallmap_land_colour;
+
+	if (cache->entries != NULL && cache->size_bits == size_bits && cache->zoom == this->zoom &&
+			cache->offset_x == offset_x && cache->offset_y == offset_y && cache->map_type == this->map_type &&
+			cache->land_colour == land_colour && cache->show_heightmap == _smallmap_show_heightmap) {
+		return;
+	}
+
+	if (cache->entries == NULL || cache->size_bits != size_bits) {
+		free(cache->entries);
+		cache->entries = MallocT<SmallMapCacheEntry>(1U << (2 * size_bits));
+		cache->size_bits = size_bits;
+		cache->refresh_row = 0;
+	}
+	cache->zoom = this->zoom;
+	cache->offset_x = offset_x;
+	cache->offset_y = offset_y;
+	cache->map_type = this->map_type;
+	cache->land_colour = land_colour;
+	cache->show_heightmap = _smallmap_show_heightmap;
+	InvalidateSmallMapCache();
+}
+
+/**
+ * Get the colours of a group of tiles, from the cache if possible.
+ * @param xc The X coordinate of the first tile of the group.
+ * @param yc The Y coordinate of the first tile of the group.
+ * @param ta The tiles of the group.
+ * @return Colours to display.
+ * @pre #UpdateCache has been called for the current display.
+ */
+inline uint32 SmallMapWindow::GetCachedTileColours(uint xc, uint yc, const TileArea &ta) const
+{
+	const SmallMapCache *cache = &_smallmap_cache;
+	uint mask = (1U << cache->size_bits) - 1;
+	uint gx = xc / this->zoom;
+	uint gy = yc / this->zoom;
+	SmallMapCacheEntry *entry = &cache->entries[((gy & mask) << cache->size_bits) | (gx & mask)];
+	if (entry->x != gx || entry->y != gy) {
+		entry->x = gx;
+		entry->y = gy;
+		entry->colour = this->GetTileColours(ta);
+	}
+	return entry->colour;
+}
+
 /**
  * Draws one column of tiles of the small map in a certain mode onto the screen buffer, skipping the shifted rows in between.
  *
@@ -832,7 +961,7 @@ void SmallMapWindow::DrawSmallMapColumn(void *dst, uint xc, uint yc, int pitch,
 		}
 		ta.ClampToMap(); // Clamp to map boundaries (may contain MP_VOID tiles!).
 
-		uint32 val = this->GetTileColours(ta);
+		uint32 val = this->GetCachedTileColours(xc, yc, ta);
 		uint8 *val8 = (uint8 *)&val;
 		int idx = max(0, -start_pos);
 		for (int pos = max(0, start_pos); pos < end_pos; pos++) {
@@ -954,6 +1083,8 @@ void SmallMapWindow::DrawSmallMap(DrawPixelInfo *dpi) const
 	/* Clear it */
 	GfxFillRect(dpi->left, dpi->top, dpi->left + dpi->width - 1, dpi->top + dpi->height - 1, PC_BLACK);
 
+	this->UpdateCache();
+
 	/* Which tile is displayed at (dpi->left, dpi->top)? */
 	int dx;
 	Point tile = this->PixelToTile(dpi->left, dpi->top, &dx);
@@ -1069,6 +1200,14 @@ SmallMapWindow::SmallMapWindow(WindowDesc *desc, int window_number) : Window(des
 	this->SetOverlayCargoMask();
 }
 
+SmallMapWindow::~SmallMapWindow()
+{
+	delete this->overlay;
+
+	free(_smallmap_cache.entries);
+	_smallmap_cache.entries = NULL;
+}
+
 /**
  * Rebuilds the colour indices used for fast access to the smallmap contour colours based on the heightlevel.
  */
@@ -1374,6 +1513,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 		_smallmap_industry_highlight = new_highlight;
 		this->refresh = _smallmap_industry_highlight != INVALID_INDUSTRYTYPE ? BLINK_PERIOD : FORCE_REFRESH_PERIOD;
 		_smallmap_industry_highlight_state = true;
+		InvalidateSmallMapCache();
 		this->SetDirty();
 	}
 }
@@ -1460,6 +1600,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 						this->SelectLegendItem(click_pos, _legend_land_owners, _smallmap_company_count, NUM_NO_COMPANY_ENTRIES);
 					}
 				}
+				InvalidateSmallMapCache();
 				this->SetDirty();
 			}
 			break;
@@ -1485,6 +1626,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 				tbl->show_on_map = (widget == WID_SM_ENABLE_ALL);
 			}
 			if (this->map_type == SMT_LINKSTATS) this->SetOverlayCargoMask();
+			InvalidateSmallMapCache();
 			this->SetDirty();
 			break;
 		}
@@ -1531,6 +1673,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 
 		default: NOT_REACHED();
 	}
+	InvalidateSmallMapCache();
 	this->SetDirty();
 }
 
@@ -1570,6 +1713,17 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 	}
 	_smallmap_industry_highlight_state = !_smallmap_industry_highlight_state;
 
+	if (_smallmap_industry_highlight != INVALID_INDUSTRYTYPE) {
+		/* The highlighted industries blink. */
+		InvalidateSmallMapCache();
+	} else if (_smallmap_cache.entries != NULL) {
+		/* Not every change of the map marks its tiles dirty, e.g. a change of
+		 * ownership; so forget a part of the cached colours every refresh. */
+		uint rows = (1U << _smallmap_cache.size_bits) / SMALLMAP_CACHE_REFRESH_PARTS;
+		InvalidateSmallMapCacheRows(_smallmap_cache.refresh_row, rows);
+		_smallmap_cache.refresh_row = (_smallmap_cache.refresh_row + rows) & ((1U << _smallmap_cache.size_bits) - 1);
+	}
+
 	this->refresh = _smallmap_industry_highlight != INVALID_INDUSTRYTYPE ? BLINK_PERIOD : FORCE_REFRESH_PERIOD;
 	this->SetDirty();
 }
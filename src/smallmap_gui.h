@@ -27,6 +27,7 @@ void BuildIndustriesLegend();
 void ShowSmallMap();
 void BuildLandLegend();
 void BuildOwnerLegend();
+void MarkSmallMapTileDirty(TileIndex tile);
 
 /** Structure for holding relevant data for legends in small map */
 struct LegendAndColour {
@@ -154,6 +155,7 @@ protected:
 	void SetNewScroll(int sx, int sy, int sub);
 
 	void DrawMapIndicators() const;
+	void UpdateCache() const;
 	void DrawSmallMapColumn(void *dst, uint xc, uint yc, int pitch, int reps, int start_pos, int end_pos, Blitter *blitter) const;
 	void DrawVehicles(const DrawPixelInfo *dpi, Blitter *blitter) const;
 	void DrawTowns(const DrawPixelInfo *dpi) const;
@@ -166,6 +168,7 @@ protected:
 	void SetOverlayCargoMask();
 	void SetupWidgetData();
 	uint32 GetTileColours(const TileArea &ta) const;
+	uint32 GetCachedTileColours(uint xc, uint yc, const TileArea &ta) const;
 
 	int GetPositionOnLegend(Point pt);
 
@@ -173,7 +176,7 @@ public:
 	friend class NWidgetSmallmapDisplay;
 
 	SmallMapWindow(WindowDesc *desc, int window_number);
-	virtual ~SmallMapWindow() { delete this->overlay; }
+	virtual ~SmallMapWindow();
 
 	void SmallMapCenterOnCurrentPos();
 	Point GetStationMiddle(const Station *st) const;
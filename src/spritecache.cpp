@@ -17,8 +17,12 @@
 #include "zoom_func.h"
 #include "settings_type.h"
 #include "blitter/factory.hpp"
+#include "blitter/deferred.hpp"
 #include "core/math_func.hpp"
 #include "core/mem_func.hpp"
+#include "core/smallvec_type.hpp"
+#include "core/sort_func.hpp"
+#include "thread/thread.h"
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -35,8 +39,9 @@ struct SpriteCache {
 	void *ptr;
 	size_t file_pos;
 	uint32 id;
+	uint32 lru_prev;     ///< Cached sprite that was used more recently, or #SPRITE_LRU_END.
+	uint32 lru_next;     ///< Cached sprite that was used less recently, or #SPRITE_LRU_END.
 	uint16 file_slot;
-	int16 lru;
 	SpriteTypeByte type; ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
 	byte container_ver;  ///< Container version of the GRF the sprite is from.
@@ -76,17 +81,58 @@ static SpriteCache *AllocateSpriteCache(uint index)
 }
 
 
-struct MemBlock {
-	size_t size;
-	byte data[];
+/**
+ * Header in front of the data of every sprite in the sprite cache.
+ * Free blocks keep a pointer to the next free block of their slab in #data.
+ */
+struct SpriteBlock {
+	uint32 sprite;  ///< Sprite the block belongs to, or #SPRITE_BLOCK_FREE.
+	uint32 padding; ///< Keeps the data aligned to 8 bytes.
+	byte data[];    ///< Data of the sprite.
+};
+
+/** Bookkeeping of a slab of the sprite cache. */
+struct SpriteSlab {
+	byte size_class;   ///< Size class of the blocks in the slab, or #SLAB_FREE, #SLAB_LARGE or #SLAB_LARGE_PART.
+	bool locked;       ///< The blocks in the slab are never evicted.
+	uint16 used;       ///< Number of blocks in use.
+	uint32 span;       ///< Number of slabs of the large sprite starting in this slab.
+	SpriteBlock *free; ///< First free block, or \c NULL if all blocks are in use.
+	uint32 prev;       ///< Previous slab of the same size class with free blocks.
+	uint32 next;       ///< Next slab of the same size class with free blocks.
 };
 
-static uint _sprite_lru_counter;
-static MemBlock *_spritecache_ptr;
-static uint _allocated_sprite_cache_size = 0;
-static int _compact_cache_counter;
+static const uint SPRITE_SLAB_BITS = 16;                      ///< The sprite cache is split into slabs of 2 ^ SPRITE_SLAB_BITS bytes.
+static const uint SPRITE_SLAB_SIZE = 1 << SPRITE_SLAB_BITS;   ///< Size of the slabs of the sprite cache.
+static const uint32 SPRITE_SLAB_NONE = UINT32_MAX;            ///< Marker for no slab.
+static const uint32 SPRITE_LRU_END = UINT32_MAX;              ///< Marker for the ends of the LRU list.
+static const uint32 SPRITE_BLOCK_FREE = UINT32_MAX;           ///< Marker for a free block.
+
+static const byte SLAB_FREE = 0xFF;       ///< Slab that is not in use.
+static const byte SLAB_LARGE = 0xFE;      ///< First slab of a sprite that is larger than the largest size class.
+static const byte SLAB_LARGE_PART = 0xFD; ///< Other slabs of a sprite that is larger than the largest size class.
 
-static void CompactSpriteCache();
+/** Sizes of the blocks, including their header, that slabs are split into. */
+static const uint16 _sprite_size_classes[] = {
+	64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384, 21840, 32768,
+};
+static const uint SPRITE_SIZE_CLASS_COUNT = lengthof(_sprite_size_classes); ///< Number of size classes.
+assert_compile(SPRITE_SIZE_CLASS_COUNT < SLAB_LARGE_PART);
+
+static byte *_spritecache_ptr;                  ///< Memory of the sprite cache.
+static uint _allocated_sprite_cache_size = 0;   ///< Size of #_spritecache_ptr.
+static SpriteSlab *_sprite_slabs = NULL;        ///< Bookkeeping of the slabs of the sprite cache.
+static uint _sprite_slab_count = 0;             ///< Number of slabs in the sprite cache.
+static uint _sprite_slab_hint;                  ///< All slabs before this one are in use.
+static uint32 _sprite_partial_slabs[2][SPRITE_SIZE_CLASS_COUNT]; ///< First slab with free blocks per size class, for evictable and locked sprites.
+static uint32 _sprite_lru_head;                 ///< Most recently used cached sprite.
+static uint32 _sprite_lru_tail;                 ///< Least recently used cached sprite.
+static size_t _sprite_cache_used;               ///< Bytes of the sprite cache in use.
+
+SpriteCacheStats _sprite_cache_stats;
+
+static void DeleteEntryFromSpriteCache(uint item);
+static SpriteBlock *AllocSpriteBlock(size_t mem_req, bool locked);
 static void *AllocSprite(size_t mem_req);
 
 /**
@@ -371,7 +417,8 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
 	 * GRFs which are the same as 257 byte recolour sprites, but with the last
 	 * 240 bytes zeroed.  */
 	static const uint RECOLOUR_SPRITE_SIZE = 257;
-	byte *dest = (byte *)AllocSprite(max(RECOLOUR_SPRITE_SIZE, num));
+	/* Recolour sprites are never evicted, so keep them apart from the other sprites. */
+	byte *dest = AllocSpriteBlock(max(RECOLOUR_SPRITE_SIZE, num), true)->data;
 
 	if (_palette_remap_grf[file_slot]) {
 		byte *dest_tmp = AllocaM(byte, max(RECOLOUR_SPRITE_SIZE, num));
@@ -397,9 +444,10 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
  * @param id          Sprite number.
  * @param sprite_type Type of sprite.
  * @param allocator   Allocator function to use.
+ * @param blitter     Blitter to encode the sprite for.
  * @return Read sprite data.
  */
-static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator)
+static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator, Blitter *blitter)
 {
 	uint8 file_slot = sc->file_slot;
 	size_t file_pos = sc->file_pos;
@@ -415,7 +463,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	sprite[ZOOM_LVL_NORMAL].type = sprite_type;
 
 	SpriteLoaderGrf sprite_loader(sc->container_ver);
-	if (sprite_type != ST_MAPGEN && BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
+	if (sprite_type != ST_MAPGEN && blitter->GetScreenDepth() == 32) {
 		/* Try for 32bpp sprites first. */
 		sprite_avail = sprite_loader.LoadSprite(sprite, file_slot, file_pos, sprite_type, true);
 	}
@@ -426,7 +474,8 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	if (sprite_avail == 0) {
 		if (sprite_type == ST_MAPGEN) return NULL;
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't load the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+		/* Read a copy of the fallback sprite; its cached block must not get a second owner. */
+		return ReadSprite(GetSpriteCache(SPR_IMG_QUERY), SPR_IMG_QUERY, ST_NORMAL, allocator, blitter);
 	}
 
 	if (sprite_type == ST_MAPGEN) {
@@ -459,7 +508,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 
 	if (!ResizeSprites(sprite, sprite_avail, file_slot, sc->id)) {
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't resize the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+		return ReadSprite(GetSpriteCache(SPR_IMG_QUERY), SPR_IMG_QUERY, ST_NORMAL, allocator, blitter);
 	}
 
 	if (sprite->type == ST_FONT && ZOOM_LVL_GUI != ZOOM_LVL_NORMAL) {
@@ -471,7 +520,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		sprite[ZOOM_LVL_NORMAL].data   = sprite[ZOOM_LVL_GUI].data;
 	}
 
-	return BlitterFactory::GetCurrentBlitter()->Encode(sprite, allocator);
+	return blitter->Encode(sprite, allocator);
 }
 
 
@@ -575,10 +624,10 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	}
 
 	SpriteCache *sc = AllocateSpriteCache(load_index);
+	if (sc->ptr != NULL) DeleteEntryFromSpriteCache(load_index);
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
 	sc->ptr = data;
-	sc->lru = 0;
 	sc->id = file_sprite_id;
 	sc->type = type;
 	sc->warned = false;
@@ -593,6 +642,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	SpriteCache *scnew = AllocateSpriteCache(new_spr); // may reallocate: so put it first
 	SpriteCache *scold = GetSpriteCache(old_spr);
 
+	if (scnew->ptr != NULL) DeleteEntryFromSpriteCache(new_spr);
 	scnew->file_slot = scold->file_slot;
 	scnew->file_pos = scold->file_pos;
 	scnew->ptr = NULL;
@@ -603,106 +653,198 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 }
 
 /**
- * S_FREE_MASK is used to mask-out lower bits of MemBlock::size
- * If they are non-zero, the block is free.
- * S_FREE_MASK has to ensure MemBlock is correctly aligned -
- * it means 8B (S_FREE_MASK == 7) on 64bit systems!
+ * Get the header of the block of a cached sprite.
+ * @param ptr Data of the sprite.
+ * @return The header in front of the data.
  */
-static const size_t S_FREE_MASK = sizeof(size_t) - 1;
-
-/* to make sure nobody adds things to MemBlock without checking S_FREE_MASK first */
-assert_compile(sizeof(MemBlock) == sizeof(size_t));
-/* make sure it's a power of two */
-assert_compile((sizeof(size_t) & (sizeof(size_t) - 1)) == 0);
+static inline SpriteBlock *GetSpriteBlock(void *ptr)
+{
+	return (SpriteBlock *)ptr - 1;
+}
 
-static inline MemBlock *NextBlock(MemBlock *block)
+/**
+ * Get the slab a block of the sprite cache is in.
+ * @param block The block.
+ * @return Index of the slab.
+ */
+static inline uint GetSpriteSlabIndex(const SpriteBlock *block)
 {
-	return (MemBlock*)((byte*)block + (block->size & ~S_FREE_MASK));
+	return (uint)(((const byte *)block - _spritecache_ptr) >> SPRITE_SLAB_BITS);
 }
 
-static size_t GetSpriteCacheUsage()
+/**
+ * Get the size class for blocks of a given size.
+ * @param size Size of the block, including its header.
+ * @return The smallest size class the block fits in.
+ * @pre size <= the largest size class.
+ */
+static inline uint GetSpriteSizeClass(size_t size)
 {
-	size_t tot_size = 0;
-	MemBlock *s;
+	uint size_class = 0;
+	while (_sprite_size_classes[size_class] < size) size_class++;
+	return size_class;
+}
 
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (!(s->size & S_FREE_MASK)) tot_size += s->size;
+/**
+ * Add a sprite to the front of the LRU list.
+ * @param item The sprite that was just used.
+ */
+static inline void LinkSpriteLRU(uint item)
+{
+	SpriteCache *sc = GetSpriteCache(item);
+	sc->lru_prev = SPRITE_LRU_END;
+	sc->lru_next = _sprite_lru_head;
+	if (_sprite_lru_head != SPRITE_LRU_END) {
+		GetSpriteCache(_sprite_lru_head)->lru_prev = item;
+	} else {
+		_sprite_lru_tail = item;
 	}
-
-	return tot_size;
+	_sprite_lru_head = item;
 }
 
+/**
+ * Remove a sprite from the LRU list.
+ * @param item The sprite to remove.
+ */
+static inline void UnlinkSpriteLRU(uint item)
+{
+	SpriteCache *sc = GetSpriteCache(item);
+	if (sc->lru_prev != SPRITE_LRU_END) {
+		GetSpriteCache(sc->lru_prev)->lru_next = sc->lru_next;
+	} else {
+		_sprite_lru_head = sc->lru_next;
+	}
+	if (sc->lru_next != SPRITE_LRU_END) {
+		GetSpriteCache(sc->lru_next)->lru_prev = sc->lru_prev;
+	} else {
+		_sprite_lru_tail = sc->lru_prev;
+	}
+}
 
-void IncreaseSpriteLRU()
+/**
+ * Add a slab to the list of slabs of its size class that have free blocks.
+ * @param s The slab.
+ */
+static void LinkSpriteSlab(uint s)
 {
-	/* Increase all LRU values */
-	if (_sprite_lru_counter > 16384) {
-		SpriteID i;
+	SpriteSlab *slab = &_sprite_slabs[s];
+	uint32 &head = _sprite_partial_slabs[slab->locked][slab->size_class];
+	slab->prev = SPRITE_SLAB_NONE;
+	slab->next = head;
+	if (head != SPRITE_SLAB_NONE) _sprite_slabs[head].prev = s;
+	head = s;
+}
 
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
+/**
+ * Remove a slab from the list of slabs of its size class that have free blocks.
+ * @param s The slab.
+ */
+static void UnlinkSpriteSlab(uint s)
+{
+	SpriteSlab *slab = &_sprite_slabs[s];
+	if (slab->prev != SPRITE_SLAB_NONE) {
+		_sprite_slabs[slab->prev].next = slab->next;
+	} else {
+		_sprite_partial_slabs[slab->locked][slab->size_class] = slab->next;
+	}
+	if (slab->next != SPRITE_SLAB_NONE) _sprite_slabs[slab->next].prev = slab->prev;
+}
 
-		for (i = 0; i != _spritecache_items; i++) {
-			SpriteCache *sc = GetSpriteCache(i);
-			if (sc->ptr != NULL) {
-				if (sc->lru >= 0) {
-					sc->lru = -1;
-				} else if (sc->lru != -32768) {
-					sc->lru--;
-				}
+/**
+ * Find free slabs in the sprite cache. Single slabs are taken from the
+ * start of the cache and runs of slabs from the end, so slabs of large
+ * sprites do not end up between the slabs of small sprites.
+ * @param count Number of consecutive free slabs to find.
+ * @return The first of the slabs, or #SPRITE_SLAB_NONE if there are not enough consecutive free slabs.
+ */
+static uint FindFreeSpriteSlabs(uint count)
+{
+	if (count == 1) {
+		for (uint s = _sprite_slab_hint; s < _sprite_slab_count; s++) {
+			if (_sprite_slabs[s].size_class == SLAB_FREE) {
+				_sprite_slab_hint = s + 1;
+				return s;
 			}
 		}
-		_sprite_lru_counter = 0;
+		_sprite_slab_hint = _sprite_slab_count;
+		return SPRITE_SLAB_NONE;
 	}
 
-	/* Compact sprite cache every now and then. */
-	if (++_compact_cache_counter >= 740) {
-		CompactSpriteCache();
-		_compact_cache_counter = 0;
+	uint run = 0;
+	for (uint s = _sprite_slab_count; s-- > 0;) {
+		if (_sprite_slabs[s].size_class != SLAB_FREE) {
+			run = 0;
+		} else if (++run == count) {
+			return s;
+		}
 	}
+	return SPRITE_SLAB_NONE;
 }
 
 /**
- * Called when holes in the sprite cache should be removed.
- * That is accomplished by moving the cached data.
+ * Return a slab to the pool of free slabs.
+ * @param s The slab.
  */
-static void CompactSpriteCache()
+static inline void FreeSpriteSlab(uint s)
 {
-	MemBlock *s;
-
-	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
-
-	for (s = _spritecache_ptr; s->size != 0;) {
-		if (s->size & S_FREE_MASK) {
-			MemBlock *next = NextBlock(s);
-			MemBlock temp;
-			SpriteID i;
+	_sprite_slabs[s].size_class = SLAB_FREE;
+	_sprite_slab_hint = min(_sprite_slab_hint, s);
+}
 
-			/* Since free blocks are automatically coalesced, this should hold true. */
-			assert(!(next->size & S_FREE_MASK));
+/**
+ * Split a free slab into free blocks of a size class.
+ * @param s The slab.
+ * @param size_class The size class of the blocks.
+ * @param locked Whether the blocks are for sprites that are never evicted.
+ */
+static void InitSpriteSlab(uint s, uint size_class, bool locked)
+{
+	SpriteSlab *slab = &_sprite_slabs[s];
+	slab->size_class = size_class;
+	slab->locked = locked;
+	slab->used = 0;
+	slab->free = NULL;
+
+	/* Build the free list from the back, so blocks are handed out in order. */
+	uint size = _sprite_size_classes[size_class];
+	byte *base = _spritecache_ptr + ((size_t)s << SPRITE_SLAB_BITS);
+	for (uint i = SPRITE_SLAB_SIZE / size; i-- > 0;) {
+		SpriteBlock *block = (SpriteBlock *)(base + i * size);
+		block->sprite = SPRITE_BLOCK_FREE;
+		*(SpriteBlock **)block->data = slab->free;
+		slab->free = block;
+	}
 
-			/* If the next block is the sentinel block, we can safely return */
-			if (next->size == 0) break;
+	LinkSpriteSlab(s);
+}
 
-			/* Locate the sprite belonging to the next pointer. */
-			for (i = 0; GetSpriteCache(i)->ptr != next->data; i++) {
-				assert(i != _spritecache_items);
-			}
+/**
+ * Return a block to the sprite cache. Slabs without blocks in use return to
+ * the pool of free slabs, so they can be reused for blocks of any size.
+ * @param block The block.
+ */
+static void FreeSpriteBlock(SpriteBlock *block)
+{
+	uint s = GetSpriteSlabIndex(block);
+	SpriteSlab *slab = &_sprite_slabs[s];
 
-			GetSpriteCache(i)->ptr = s->data; // Adjust sprite array entry
-			/* Swap this and the next block */
-			temp = *s;
-			memmove(s, next, next->size);
-			s = NextBlock(s);
-			*s = temp;
+	if (slab->size_class == SLAB_LARGE) {
+		_sprite_cache_used -= slab->span * SPRITE_SLAB_SIZE;
+		for (uint i = 0; i < slab->span; i++) FreeSpriteSlab(s + i);
+		return;
+	}
 
-			/* Coalesce free blocks */
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		} else {
-			s = NextBlock(s);
-		}
+	_sprite_cache_used -= _sprite_size_classes[slab->size_class];
+	if (--slab->used == 0) {
+		if (slab->free != NULL) UnlinkSpriteSlab(s);
+		FreeSpriteSlab(s);
+		return;
 	}
+
+	block->sprite = SPRITE_BLOCK_FREE;
+	*(SpriteBlock **)block->data = slab->free;
+	if (slab->free == NULL) LinkSpriteSlab(s);
+	slab->free = block;
 }
 
 /**
@@ -711,80 +853,109 @@ static void CompactSpriteCache()
  */
 static void DeleteEntryFromSpriteCache(uint item)
 {
-	/* Mark the block as free (the block must be in use) */
-	MemBlock *s = (MemBlock*)GetSpriteCache(item)->ptr - 1;
-	assert(!(s->size & S_FREE_MASK));
-	s->size |= S_FREE_MASK;
-	GetSpriteCache(item)->ptr = NULL;
-
-	/* And coalesce adjacent free blocks */
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (s->size & S_FREE_MASK) {
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		}
-	}
+	SpriteCache *sc = GetSpriteCache(item);
+	assert(sc->ptr != NULL);
+
+	if (sc->type != ST_RECOLOUR) UnlinkSpriteLRU(item);
+	FreeSpriteBlock(GetSpriteBlock(sc->ptr));
+	sc->ptr = NULL;
 }
 
-static void DeleteEntryFromSpriteCache()
+/**
+ * Make room in the sprite cache by evicting the least recently used sprite.
+ * When that does not free a block of the requested size class, the other
+ * sprites in its slab are evicted as well, so the slab can be reused.
+ * @param size_class Size class of the block that is needed, or #SLAB_LARGE for a run of slabs.
+ */
+static void EvictSpriteFromSpriteCache(uint size_class)
 {
-	uint best = UINT_MAX;
-	int cur_lru;
-
-	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
-
-	cur_lru = 0xffff;
-	for (SpriteID i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != NULL && sc->lru < cur_lru) {
-			cur_lru = sc->lru;
-			best = i;
-		}
-	}
+	DEBUG(sprite, 3, "Evicting sprite from sprite cache, inuse=" PRINTF_SIZE, _sprite_cache_used);
 
 	/* Display an error message and die, in case we found no sprite at all.
 	 * This shouldn't really happen, unless all sprites are locked. */
-	if (best == UINT_MAX) error("Out of sprite memory");
+	if (_sprite_lru_tail == SPRITE_LRU_END) error("Out of sprite memory");
 
-	DeleteEntryFromSpriteCache(best);
-}
+	/* Recorded drawing might still use the sprites that are evicted. */
+	Blitter_Deferred::FlushActive();
 
-static void *AllocSprite(size_t mem_req)
-{
-	mem_req += sizeof(MemBlock);
+	uint s = GetSpriteSlabIndex(GetSpriteBlock(GetSpriteCache(_sprite_lru_tail)->ptr));
+	SpriteSlab *slab = &_sprite_slabs[s];
+	assert(!slab->locked);
 
-	/* Align this to correct boundary. This also makes sure at least one
-	 * bit is not used, so we can use it for other things. */
-	mem_req = Align(mem_req, S_FREE_MASK + 1);
+	_sprite_cache_stats.evictions++;
+	if (slab->size_class == size_class || slab->size_class == SLAB_LARGE) {
+		DeleteEntryFromSpriteCache(_sprite_lru_tail);
+		return;
+	}
 
-	for (;;) {
-		MemBlock *s;
+	_sprite_cache_stats.slab_reclaims++;
+	uint size = _sprite_size_classes[slab->size_class];
+	byte *base = _spritecache_ptr + ((size_t)s << SPRITE_SLAB_BITS);
+	for (uint i = 0; slab->size_class != SLAB_FREE; i++) {
+		SpriteBlock *block = (SpriteBlock *)(base + i * size);
+		if (block->sprite == SPRITE_BLOCK_FREE) continue;
+		if (block->sprite != _sprite_lru_tail) _sprite_cache_stats.evictions++;
+		DeleteEntryFromSpriteCache(block->sprite);
+	}
+}
 
-		for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-			if (s->size & S_FREE_MASK) {
-				size_t cur_size = s->size & ~S_FREE_MASK;
+/**
+ * Allocate a block in the sprite cache, evicting the least recently used
+ * sprites when the cache is full.
+ * @param mem_req Size of the data of the block.
+ * @param locked Whether the block is for a sprite that is never evicted.
+ * @return The block.
+ */
+static SpriteBlock *AllocSpriteBlock(size_t mem_req, bool locked)
+{
+	mem_req += sizeof(SpriteBlock);
+
+	if (mem_req > _sprite_size_classes[SPRITE_SIZE_CLASS_COUNT - 1]) {
+		/* Too large for a size class; give the sprite slabs of its own. */
+		uint count = CeilDiv((uint)mem_req, SPRITE_SLAB_SIZE);
+		if (count > _sprite_slab_count) error("Out of sprite memory");
+
+		uint s;
+		while ((s = FindFreeSpriteSlabs(count)) == SPRITE_SLAB_NONE) EvictSpriteFromSpriteCache(SLAB_LARGE);
+
+		for (uint i = 0; i < count; i++) _sprite_slabs[s + i].size_class = SLAB_LARGE_PART;
+		_sprite_slabs[s].size_class = SLAB_LARGE;
+		_sprite_slabs[s].locked = locked;
+		_sprite_slabs[s].span = count;
+		_sprite_cache_used += count * SPRITE_SLAB_SIZE;
+		return (SpriteBlock *)(_spritecache_ptr + ((size_t)s << SPRITE_SLAB_BITS));
+	}
 
-				/* Is the block exactly the size we need or
-				 * big enough for an additional free block? */
-				if (cur_size == mem_req ||
-						cur_size >= mem_req + sizeof(MemBlock)) {
-					/* Set size and in use */
-					s->size = mem_req;
+	uint size_class = GetSpriteSizeClass(mem_req);
+	uint32 &partial = _sprite_partial_slabs[locked][size_class];
+	while (partial == SPRITE_SLAB_NONE) {
+		uint s = FindFreeSpriteSlabs(1);
+		if (s != SPRITE_SLAB_NONE) {
+			InitSpriteSlab(s, size_class, locked);
+		} else {
+			/* Freeing a block of an evictable sprite does not help locked sprites. */
+			EvictSpriteFromSpriteCache(locked ? SLAB_LARGE : size_class);
+		}
+	}
 
-					/* Do we need to inject a free block too? */
-					if (cur_size != mem_req) {
-						NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
-					}
+	SpriteSlab *slab = &_sprite_slabs[partial];
+	SpriteBlock *block = slab->free;
+	slab->free = *(SpriteBlock **)block->data;
+	slab->used++;
+	if (slab->free == NULL) UnlinkSpriteSlab(partial);
 
-					return s->data;
-				}
-			}
-		}
+	_sprite_cache_used += _sprite_size_classes[size_class];
+	return block;
+}
 
-		/* Reached sentinel, but no block found yet. Delete some old entry. */
-		DeleteEntryFromSpriteCache();
-	}
+/**
+ * Allocator for sprites in the sprite cache.
+ * @param mem_req Size of the sprite.
+ * @return Memory for the sprite.
+ */
+static void *AllocSprite(size_t mem_req)
+{
+	return AllocSpriteBlock(mem_req, false)->data;
 }
 
 /**
@@ -859,19 +1030,267 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	if (allocator == NULL) {
 		/* Load sprite into/from spritecache */
 
-		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
+		if (sc->ptr != NULL) {
+			_sprite_cache_stats.hits++;
 
-		/* Load the sprite, if it is not loaded, yet */
-		if (sc->ptr == NULL) sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+			/* Update LRU; recolour sprites are never evicted, so they are not in the list. */
+			if (sc->type != ST_RECOLOUR && _sprite_lru_head != sprite) {
+				UnlinkSpriteLRU(sprite);
+				LinkSpriteLRU(sprite);
+			}
+			return sc->ptr;
+		}
 
+		/* Load the sprite, as it is not loaded yet */
+		_sprite_cache_stats.misses++;
+		sc->ptr = ReadSprite(sc, sprite, type, AllocSprite, BlitterFactory::GetCurrentBlitter());
+		if (sc->ptr != NULL) {
+			GetSpriteBlock(sc->ptr)->sprite = sprite;
+			LinkSpriteLRU(sprite);
+		}
 		return sc->ptr;
 	} else {
 		/* Do not use the spritecache, but a different allocator. */
-		return ReadSprite(sc, sprite, type, allocator);
+		return ReadSprite(sc, sprite, type, allocator, BlitterFactory::GetCurrentBlitter());
+	}
+}
+
+/**
+ * Read a normal sprite from disk and encode it for a blitter other than the
+ * current one, e.g. to compare blitters. The sprite cache is not used.
+ * @param sprite Sprite to read.
+ * @param blitter Blitter to encode the sprite for.
+ * @param allocator Allocator function to use.
+ * @return Sprite raw data.
+ */
+void *GetRawSpriteForBlitter(SpriteID sprite, Blitter *blitter, AllocatorProc *allocator)
+{
+	assert(SpriteExists(sprite) && GetSpriteType(sprite) == ST_NORMAL);
+	return ReadSprite(GetSpriteCache(sprite), sprite, ST_NORMAL, allocator, blitter);
+}
+
+
+/** Header in front of a sprite encoded by the threads prefetching sprites. */
+struct PrefetchedSprite {
+	size_t size; ///< Size of the sprite data.
+	byte data[]; ///< The sprite data.
+};
+
+/**
+ * A sprite to load into the sprite cache ahead of its use. The location of
+ * the sprite is copied, as the sprite cache may grow while it is decoded.
+ */
+struct SpritePrefetch {
+	SpriteID sprite;            ///< The sprite.
+	uint32 id;                  ///< ID of the sprite in its GRF.
+	size_t file_pos;            ///< Position of the sprite in its GRF.
+	uint16 file_slot;           ///< File slot of the GRF of the sprite.
+	byte container_ver;         ///< Container version of the GRF of the sprite.
+	size_t data_pos;            ///< Position of the file data of the sprite in SpritePrefetchBatch::data.
+	size_t data_size;           ///< Size of the file data of the sprite.
+	PrefetchedSprite *prepared; ///< The encoded sprite, or \c NULL if it could not be loaded.
+};
+
+/** Sprites that are decoded by the worker threads while the game goes on. */
+struct SpritePrefetchBatch {
+	SmallVector<SpritePrefetch, 64> sprites; ///< The sprites to decode.
+	ReusableBuffer<byte> data;               ///< Copy of the file data of the sprites.
+	Blitter *blitter;                        ///< The blitter to encode the sprites for.
+	bool load_32bpp;                         ///< Whether to try 32bpp sprites first.
+	bool started;                            ///< Whether the sprites are being decoded.
+	ParallelJob job;                         ///< The decoding by the worker threads.
+};
+
+static const uint SPRITE_PREFETCH_PER_THREAD = 32; ///< Number of sprites each thread decodes per batch.
+
+static SmallVector<SpriteID, 256> _sprite_prefetch_queue; ///< Sprites to prefetch; sorted by ID.
+static uint _sprite_prefetch_pos;                          ///< The next sprite in #_sprite_prefetch_queue to prefetch.
+static SpritePrefetchBatch _sprite_prefetch_batch;         ///< The sprites being decoded.
+
+/**
+ * Allocator for the sprites encoded by the threads prefetching sprites.
+ * @param size Size of the sprite.
+ * @return Memory for the sprite.
+ */
+static void *AllocPrefetchedSprite(size_t size)
+{
+	PrefetchedSprite *prepared = (PrefetchedSprite *)MallocT<byte>(sizeof(PrefetchedSprite) + size);
+	prepared->size = size;
+	return prepared->data;
+}
+
+/**
+ * Decode, resize and encode sprites from copies of their data; for #StartParallel.
+ * This does the same as #ReadSprite for normal sprites, but does not use the
+ * file, the sprite cache or the shared sprite buffers.
+ * @param param The #SpritePrefetchBatch.
+ * @param first First sprite to decode.
+ * @param last One past the last sprite to decode.
+ */
+static void DecodePrefetchedSprites(void *param, uint first, uint last)
+{
+	SpritePrefetchBatch *batch = (SpritePrefetchBatch *)param;
+	ReusableBuffer<SpriteLoader::CommonPixel> buffer[ZOOM_LVL_COUNT];
+
+	for (uint i = first; i < last; i++) {
+		SpritePrefetch *prefetch = &batch->sprites[i];
+		const byte *data = batch->data.GetBuffer() + prefetch->data_pos;
+		prefetch->prepared = NULL;
+
+		SpriteLoader::Sprite sprite[ZOOM_LVL_COUNT];
+		for (ZoomLevel zoom = ZOOM_LVL_BEGIN; zoom != ZOOM_LVL_END; zoom++) sprite[zoom].own_buffer = buffer;
+		sprite[ZOOM_LVL_NORMAL].type = ST_NORMAL;
+
+		SpriteLoaderGrf sprite_loader(prefetch->container_ver);
+		uint8 sprite_avail = 0;
+		if (batch->load_32bpp) {
+			sprite_avail = sprite_loader.LoadSpriteFromMemory(sprite, data, prefetch->data_size, prefetch->file_slot, prefetch->file_pos, ST_NORMAL, true);
+		}
+		if (sprite_avail == 0) {
+			sprite_avail = sprite_loader.LoadSpriteFromMemory(sprite, data, prefetch->data_size, prefetch->file_slot, prefetch->file_pos, ST_NORMAL, false);
+		}
+
+		/* Sprites that fail to load are left to #ReadSprite, which reports the problem. */
+		if (sprite_avail == 0 || !ResizeSprites(sprite, sprite_avail, prefetch->file_slot, prefetch->id)) continue;
+
+		Sprite *encoded = batch->blitter->Encode(sprite, AllocPrefetchedSprite);
+		prefetch->prepared = (PrefetchedSprite *)((byte *)encoded - sizeof(PrefetchedSprite));
+	}
+}
+
+/**
+ * Wait till the sprites being prefetched are decoded, and throw them away.
+ * This must be done before the sprite cache is cleared, or the blitter
+ * or the settings the sprites are encoded with change.
+ */
+void CancelSpritePrefetch()
+{
+	SpritePrefetchBatch *batch = &_sprite_prefetch_batch;
+	if (!batch->started) return;
+
+	WaitForParallelJob(&batch->job);
+	for (uint i = 0; i < batch->sprites.Length(); i++) free(batch->sprites[i].prepared);
+	batch->sprites.Clear();
+	batch->started = false;
+}
+
+/** Sort sprite IDs in ascending order. */
+static int CDECL SpriteIDSorter(const SpriteID *a, const SpriteID *b)
+{
+	return (int)*a - (int)*b;
+}
+
+/**
+ * Queue sprites to be loaded into the sprite cache ahead of their use by
+ * #ProcessSpritePrefetch. This replaces the sprites queued before.
+ * @param sprites The sprites; duplicates and sprites that are already cached are skipped.
+ * @param count Number of sprites.
+ */
+void QueueSpritePrefetch(const SpriteID *sprites, uint count)
+{
+	_sprite_prefetch_queue.Clear();
+	_sprite_prefetch_pos = 0;
+
+	for (uint i = 0; i < count; i++) {
+		if (!SpriteExists(sprites[i])) continue;
+
+		const SpriteCache *sc = GetSpriteCache(sprites[i]);
+		if (sc->ptr == NULL && sc->type == ST_NORMAL) *_sprite_prefetch_queue.Append() = sprites[i];
 	}
+
+	/* Sorting by ID makes removing duplicates easy, and reads the files mostly sequentially. */
+	QSortT(_sprite_prefetch_queue.Begin(), _sprite_prefetch_queue.Length(), &SpriteIDSorter);
+	uint unique = 0;
+	for (uint i = 0; i < _sprite_prefetch_queue.Length(); i++) {
+		if (unique == 0 || _sprite_prefetch_queue[unique - 1] != _sprite_prefetch_queue[i]) _sprite_prefetch_queue[unique++] = _sprite_prefetch_queue[i];
+	}
+	_sprite_prefetch_queue.Resize(unique);
 }
 
+/**
+ * Copy the sprites the worker threads decoded into the sprite cache,
+ * unless they were loaded in the mean time.
+ * @param batch The decoded sprites.
+ */
+static void CollectPrefetchedSprites(SpritePrefetchBatch *batch)
+{
+	for (uint i = 0; i < batch->sprites.Length(); i++) {
+		PrefetchedSprite *prepared = batch->sprites[i].prepared;
+		if (prepared == NULL) continue;
+
+		SpriteID id = batch->sprites[i].sprite;
+		SpriteCache *sc = GetSpriteCache(id);
+		if (sc->ptr == NULL) {
+			void *ptr = AllocSprite(prepared->size);
+			memcpy(ptr, prepared->data, prepared->size);
+			GetSpriteBlock(ptr)->sprite = id;
+			sc->ptr = ptr;
+			LinkSpriteLRU(id);
+			_sprite_cache_stats.prefetches++;
+		}
+		free(prepared);
+	}
+	batch->sprites.Clear();
+}
+
+/**
+ * Load the sprites queued by #QueueSpritePrefetch into the sprite cache in
+ * batches. The data of the sprites of a batch is read from the files by
+ * this thread, and then decoded, resized and encoded by the worker threads
+ * while the game goes on. A later call copies them into the sprite cache
+ * and starts the next batch.
+ */
+void ProcessSpritePrefetch()
+{
+	SpritePrefetchBatch *batch = &_sprite_prefetch_batch;
+	if (batch->started) {
+		if (!IsParallelJobDone(&batch->job)) return;
+		batch->started = false;
+		CollectPrefetchedSprites(batch);
+	}
+
+	if (_sprite_prefetch_pos == _sprite_prefetch_queue.Length()) return;
+
+	uint count = min(_sprite_prefetch_queue.Length() - _sprite_prefetch_pos, GetWorkerThreadCount() * SPRITE_PREFETCH_PER_THREAD);
+	size_t data_size = 0;
+
+	for (uint i = 0; i < count; i++) {
+		SpriteID id = _sprite_prefetch_queue[_sprite_prefetch_pos + i];
+		if (!SpriteExists(id)) continue;
+
+		const SpriteCache *sc = GetSpriteCache(id);
+		if (sc->ptr != NULL || sc->type != ST_NORMAL) continue;
+
+		SpriteLoaderGrf sprite_loader(sc->container_ver);
+		size_t size = sprite_loader.GetSpriteDataSize(sc->file_slot, sc->file_pos);
+		if (size == 0) continue;
+
+		SpritePrefetch *prefetch = batch->sprites.Append();
+		prefetch->sprite = id;
+		prefetch->id = sc->id;
+		prefetch->file_pos = sc->file_pos;
+		prefetch->file_slot = sc->file_slot;
+		prefetch->container_ver = sc->container_ver;
+		prefetch->data_pos = data_size;
+		prefetch->data_size = size;
+		prefetch->prepared = NULL;
+		data_size += size;
+	}
+	_sprite_prefetch_pos += count;
+	if (batch->sprites.Length() == 0) return;
+
+	byte *data = batch->data.ZeroAllocate(data_size);
+	for (uint i = 0; i < batch->sprites.Length(); i++) {
+		const SpritePrefetch *prefetch = &batch->sprites[i];
+		FioSeekToFile(prefetch->file_slot, prefetch->file_pos);
+		FioReadBlock(data + prefetch->data_pos, prefetch->data_size);
+	}
+
+	batch->blitter = BlitterFactory::GetCurrentBlitter();
+	batch->load_32bpp = batch->blitter->GetScreenDepth() == 32;
+	batch->started = true;
+	StartParallel(&batch->job, &DecodePrefetchedSprites, batch, batch->sprites.Length(), 1);
+}
 
 static void GfxInitSpriteCache()
 {
@@ -883,7 +1302,7 @@ static void GfxInitSpriteCache()
 	static uint last_alloc_attempt = 0;
 
 	if (_spritecache_ptr == NULL || (_allocated_sprite_cache_size != target_size && target_size != last_alloc_attempt)) {
-		delete[] reinterpret_cast<byte *>(_spritecache_ptr);
+		delete[] _spritecache_ptr;
 
 		last_alloc_attempt = target_size;
 		_allocated_sprite_cache_size = target_size;
@@ -891,15 +1310,15 @@ static void GfxInitSpriteCache()
 		do {
 			try {
 				/* Try to allocate 50% more to make sure we do not allocate almost all available. */
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size + _allocated_sprite_cache_size / 2]);
+				_spritecache_ptr = new byte[_allocated_sprite_cache_size + _allocated_sprite_cache_size / 2];
 			} catch (std::bad_alloc &) {
 				_spritecache_ptr = NULL;
 			}
 
 			if (_spritecache_ptr != NULL) {
 				/* Allocation succeeded, but we wanted less. */
-				delete[] reinterpret_cast<byte *>(_spritecache_ptr);
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size]);
+				delete[] _spritecache_ptr;
+				_spritecache_ptr = new byte[_allocated_sprite_cache_size];
 			} else if (_allocated_sprite_cache_size < 2 * 1024 * 1024) {
 				usererror("Cannot allocate spritecache");
 			} else {
@@ -918,14 +1337,24 @@ static void GfxInitSpriteCache()
 		}
 	}
 
-	/* A big free block */
-	_spritecache_ptr->size = (_allocated_sprite_cache_size - sizeof(MemBlock)) | S_FREE_MASK;
-	/* Sentinel block (identified by size == 0) */
-	NextBlock(_spritecache_ptr)->size = 0;
+	/* All slabs are free */
+	_sprite_slab_count = _allocated_sprite_cache_size >> SPRITE_SLAB_BITS;
+	_sprite_slabs = ReallocT(_sprite_slabs, _sprite_slab_count);
+	for (uint s = 0; s < _sprite_slab_count; s++) _sprite_slabs[s].size_class = SLAB_FREE;
+	_sprite_slab_hint = 0;
+	for (uint i = 0; i < SPRITE_SIZE_CLASS_COUNT; i++) {
+		_sprite_partial_slabs[false][i] = SPRITE_SLAB_NONE;
+		_sprite_partial_slabs[true][i] = SPRITE_SLAB_NONE;
+	}
+
+	_sprite_lru_head = SPRITE_LRU_END;
+	_sprite_lru_tail = SPRITE_LRU_END;
+	_sprite_cache_used = 0;
 }
 
 void GfxInitSpriteMem()
 {
+	CancelSpritePrefetch();
 	GfxInitSpriteCache();
 
 	/* Reset the spritecache 'pool' */
@@ -933,7 +1362,8 @@ void GfxInitSpriteMem()
 	_spritecache_items = 0;
 	_spritecache = NULL;
 
-	_compact_cache_counter = 0;
+	_sprite_prefetch_queue.Clear();
+	_sprite_prefetch_pos = 0;
 }
 
 /**
@@ -942,11 +1372,21 @@ void GfxInitSpriteMem()
  */
 void GfxClearSpriteCache()
 {
-	/* Clear sprite ptr for all cached items */
-	for (uint i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != NULL) DeleteEntryFromSpriteCache(i);
-	}
+	CancelSpritePrefetch();
+
+	/* All cached items except the recolour sprites are in the LRU list */
+	while (_sprite_lru_head != SPRITE_LRU_END) DeleteEntryFromSpriteCache(_sprite_lru_head);
+}
+
+/**
+ * Get the amount of memory of the sprite cache that is in use.
+ * @param[out] size Size of the sprite cache.
+ * @return Number of bytes in use.
+ */
+size_t GetSpriteCacheUsage(size_t *size)
+{
+	*size = (size_t)_sprite_slab_count * SPRITE_SLAB_SIZE;
+	return _sprite_cache_used;
 }
 
 /* static */ ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
@@ -23,11 +23,24 @@ struct Sprite {
 	byte data[];   ///< Sprite data.
 };
 
+/** Counters of the use of the sprite cache. */
+struct SpriteCacheStats {
+	uint64 hits;          ///< Number of requested sprites that were in the cache.
+	uint64 misses;        ///< Number of requested sprites that had to be loaded.
+	uint64 evictions;     ///< Number of sprites removed from the cache to make room for other sprites.
+	uint64 slab_reclaims; ///< Number of slabs emptied to make room for sprites of another size.
+	uint64 prefetches;    ///< Number of sprites loaded ahead of their use.
+};
+
 extern uint _sprite_cache_size;
+extern SpriteCacheStats _sprite_cache_stats;
 
 typedef void *AllocatorProc(size_t size);
 
+class Blitter;
+
 void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator = NULL);
+void *GetRawSpriteForBlitter(SpriteID sprite, Blitter *blitter, AllocatorProc *allocator);
 bool SpriteExists(SpriteID sprite);
 
 SpriteType GetSpriteType(SpriteID sprite);
@@ -50,7 +63,10 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
-void IncreaseSpriteLRU();
+size_t GetSpriteCacheUsage(size_t *size);
+void QueueSpritePrefetch(const SpriteID *sprites, uint count);
+void ProcessSpritePrefetch();
+void CancelSpritePrefetch();
 
 void ReadGRFSpriteOffsets(byte container_version);
 size_t GetGRFSpriteOffset(uint32 id);
@@ -19,6 +19,7 @@
 #include "../core/math_func.hpp"
 #include "../core/alloc_type.hpp"
 #include "../core/bitmath_func.hpp"
+#include "../spritecache.h"
 #include "grf.hpp"
 
 #include "../safeguards.h"
@@ -54,8 +55,75 @@ static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
 	return false;
 }
 
+/** Reads the data of a sprite from the file it is in. */
+struct SpriteFileReader {
+	static const bool REPORT_ERRORS = true; ///< Errors in the sprite are shown to the user.
+
+	inline void Seek(uint8 file_slot, size_t pos) { FioSeekToFile(file_slot, pos); }
+	inline size_t GetPos() const { return FioGetPos(); }
+	inline byte ReadByte() { return FioReadByte(); }
+	inline uint16 ReadWord() { return FioReadWord(); }
+	inline uint32 ReadDword() { return FioReadDword(); }
+	inline void SkipBytes(int n) { FioSkipBytes(n); }
+};
+
+/**
+ * Reads the data of a sprite from a copy of it in memory, so any thread can
+ * decode the sprite. Reading past the end of the copy yields zeroes.
+ */
+struct SpriteMemoryReader {
+	static const bool REPORT_ERRORS = false; ///< Errors are left to be reported when the sprite is loaded from the file.
+
+	const byte *data; ///< Copy of the data of the sprite.
+	size_t size;      ///< Size of the copy.
+	size_t file_pos;  ///< Position of the copy in the file.
+	size_t pos;       ///< Current position in the copy.
+
+	SpriteMemoryReader(const byte *data, size_t size, size_t file_pos) : data(data), size(size), file_pos(file_pos), pos(0) {}
+
+	inline void Seek(uint8 file_slot, size_t pos) { this->pos = pos - this->file_pos; }
+	inline size_t GetPos() const { return this->file_pos + this->pos; }
+
+	inline byte ReadByte()
+	{
+		byte b = this->pos < this->size ? this->data[this->pos] : 0;
+		this->pos++;
+		return b;
+	}
+
+	inline uint16 ReadWord()
+	{
+		byte b = this->ReadByte();
+		return (this->ReadByte() << 8) | b;
+	}
+
+	inline uint32 ReadDword()
+	{
+		uint b = this->ReadWord();
+		return (this->ReadWord() << 16) | b;
+	}
+
+	inline void SkipBytes(int n) { this->pos += n; }
+};
+
+/**
+ * Report a corrupted sprite, if the reader reports errors.
+ * @tparam Reader The reader of the sprite data.
+ * @param file_slot the file the errored sprite is in
+ * @param file_pos the location in the file of the errored sprite
+ * @param line the line where the error occurs.
+ * @return always false (to tell loading the sprite failed)
+ */
+template <class Reader>
+static inline bool CorruptSprite(uint8 file_slot, size_t file_pos, int line)
+{
+	return Reader::REPORT_ERRORS && WarnCorruptSprite(file_slot, file_pos, line);
+}
+
 /**
  * Decode the image data of a single sprite.
+ * @tparam Reader The reader of the sprite data.
+ * @param reader Reader positioned at the image data.
  * @param[in,out] sprite Filled with the sprite image data.
  * @param file_slot File slot.
  * @param file_pos File position.
@@ -67,7 +135,8 @@ static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
  * @param container_format Container format of the GRF this sprite is in.
  * @return True if the sprite was successfully loaded.
  */
-bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, int64 num, byte type, ZoomLevel zoom_lvl, byte colour_fmt, byte container_format)
+template <class Reader>
+static bool DecodeSingleSprite(Reader &reader, SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, int64 num, byte type, ZoomLevel zoom_lvl, byte colour_fmt, byte container_format)
 {
 	AutoFreePtr<byte> dest_orig(MallocT<byte>(num));
 	byte *dest = dest_orig;
@@ -75,24 +144,24 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 
 	/* Read the file, which has some kind of compression */
 	while (num > 0) {
-		int8 code = FioReadByte();
+		int8 code = reader.ReadByte();
 
 		if (code >= 0) {
 			/* Plain bytes to read */
 			int size = (code == 0) ? 0x80 : code;
 			num -= size;
-			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			if (num < 0) return CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 			for (; size > 0; size--) {
-				*dest = FioReadByte();
+				*dest = reader.ReadByte();
 				dest++;
 			}
 		} else {
 			/* Copy bytes from earlier in the sprite */
-			const uint data_offset = ((code & 7) << 8) | FioReadByte();
-			if (dest - data_offset < dest_orig) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			const uint data_offset = ((code & 7) << 8) | reader.ReadByte();
+			if (dest - data_offset < dest_orig) return CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 			int size = -(code >> 3);
 			num -= size;
-			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			if (num < 0) return CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 			for (; size > 0; size--) {
 				*dest = *(dest - data_offset);
 				dest++;
@@ -100,7 +169,7 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 		}
 	}
 
-	if (num != 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+	if (num != 0) return CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 
 	sprite->AllocateData(zoom_lvl, sprite->width * sprite->height);
 
@@ -127,7 +196,7 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 
 			do {
 				if (dest + (container_format >= 2 && sprite->width > 256 ? 4 : 2) > dest_orig + dest_size) {
-					return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+					return CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 				}
 
 				SpriteLoader::CommonPixel *data;
@@ -153,7 +222,7 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 				data = &sprite->data[y * sprite->width + skip];
 
 				if (skip + length > sprite->width || dest + length * bpp > dest_orig + dest_size) {
-					return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+					return CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 				}
 
 				for (int x = 0; x < length; x++) {
@@ -179,10 +248,10 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 		}
 	} else {
 		if (dest_size < sprite->width * sprite->height * bpp) {
-			return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			return CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 		}
 
-		if (dest_size > sprite->width * sprite->height * bpp) {
+		if (Reader::REPORT_ERRORS && dest_size > sprite->width * sprite->height * bpp) {
 			static byte warning_level = 0;
 			DEBUG(sprite, warning_level, "Ignoring " OTTD_PRINTF64 " unused extra bytes from the sprite from %s at position %i", dest_size - sprite->width * sprite->height * bpp, FioGetFilename(file_slot), (int)file_pos);
 			warning_level = 6;
@@ -215,30 +284,31 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 	return true;
 }
 
-uint8 LoadSpriteV1(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
+template <class Reader>
+static uint8 LoadSpriteV1(Reader &reader, SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
 {
 	/* Check the requested colour depth. */
 	if (load_32bpp) return 0;
 
 	/* Open the right file and go to the correct position */
-	FioSeekToFile(file_slot, file_pos);
+	reader.Seek(file_slot, file_pos);
 
 	/* Read the size and type */
-	int num = FioReadWord();
-	byte type = FioReadByte();
+	int num = reader.ReadWord();
+	byte type = reader.ReadByte();
 
 	/* Type 0xFF indicates either a colourmap or some other non-sprite info; we do not handle them here */
 	if (type == 0xFF) return 0;
 
 	ZoomLevel zoom_lvl = (sprite_type != ST_MAPGEN) ? ZOOM_LVL_OUT_4X : ZOOM_LVL_NORMAL;
 
-	sprite[zoom_lvl].height = FioReadByte();
-	sprite[zoom_lvl].width  = FioReadWord();
-	sprite[zoom_lvl].x_offs = FioReadWord();
-	sprite[zoom_lvl].y_offs = FioReadWord();
+	sprite[zoom_lvl].height = reader.ReadByte();
+	sprite[zoom_lvl].width  = reader.ReadWord();
+	sprite[zoom_lvl].x_offs = reader.ReadWord();
+	sprite[zoom_lvl].y_offs = reader.ReadWord();
 
 	if (sprite[zoom_lvl].width > INT16_MAX) {
-		WarnCorruptSprite(file_slot, file_pos, __LINE__);
+		CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 		return 0;
 	}
 
@@ -246,12 +316,13 @@ uint8 LoadSpriteV1(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 	 * In case it is uncompressed, the size is 'num' - 8 (header-size). */
 	num = (type & 0x02) ? sprite[zoom_lvl].width * sprite[zoom_lvl].height : num - 8;
 
-	if (DecodeSingleSprite(&sprite[zoom_lvl], file_slot, file_pos, sprite_type, num, type, zoom_lvl, SCC_PAL, 1)) return 1 << zoom_lvl;
+	if (DecodeSingleSprite(reader, &sprite[zoom_lvl], file_slot, file_pos, sprite_type, num, type, zoom_lvl, SCC_PAL, 1)) return 1 << zoom_lvl;
 
 	return 0;
 }
 
-uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
+template <class Reader>
+static uint8 LoadSpriteV2(Reader &reader, SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
 {
 	static const ZoomLevel zoom_lvl_map[6] = {ZOOM_LVL_OUT_4X, ZOOM_LVL_NORMAL, ZOOM_LVL_OUT_2X, ZOOM_LVL_OUT_8X, ZOOM_LVL_OUT_16X, ZOOM_LVL_OUT_32X};
 
@@ -259,39 +330,39 @@ uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 	if (file_pos == SIZE_MAX) return 0;
 
 	/* Open the right file and go to the correct position */
-	FioSeekToFile(file_slot, file_pos);
+	reader.Seek(file_slot, file_pos);
 
-	uint32 id = FioReadDword();
+	uint32 id = reader.ReadDword();
 
 	uint8 loaded_sprites = 0;
 	do {
-		int64 num = FioReadDword();
-		size_t start_pos = FioGetPos();
-		byte type = FioReadByte();
+		int64 num = reader.ReadDword();
+		size_t start_pos = reader.GetPos();
+		byte type = reader.ReadByte();
 
 		/* Type 0xFF indicates either a colourmap or some other non-sprite info; we do not handle them here. */
 		if (type == 0xFF) return 0;
 
 		byte colour = type & SCC_MASK;
-		byte zoom = FioReadByte();
+		byte zoom = reader.ReadByte();
 
 		if (colour != 0 && (load_32bpp ? colour != SCC_PAL : colour == SCC_PAL) && (sprite_type != ST_MAPGEN ? zoom < lengthof(zoom_lvl_map) : zoom == 0)) {
 			ZoomLevel zoom_lvl = (sprite_type != ST_MAPGEN) ? zoom_lvl_map[zoom] : ZOOM_LVL_NORMAL;
 
 			if (HasBit(loaded_sprites, zoom_lvl)) {
 				/* We already have this zoom level, skip sprite. */
-				DEBUG(sprite, 1, "Ignoring duplicate zoom level sprite %u from %s", id, FioGetFilename(file_slot));
-				FioSkipBytes(num - 2);
+				if (Reader::REPORT_ERRORS) DEBUG(sprite, 1, "Ignoring duplicate zoom level sprite %u from %s", id, FioGetFilename(file_slot));
+				reader.SkipBytes(num - 2);
 				continue;
 			}
 
-			sprite[zoom_lvl].height = FioReadWord();
-			sprite[zoom_lvl].width  = FioReadWord();
-			sprite[zoom_lvl].x_offs = FioReadWord();
-			sprite[zoom_lvl].y_offs = FioReadWord();
+			sprite[zoom_lvl].height = reader.ReadWord();
+			sprite[zoom_lvl].width  = reader.ReadWord();
+			sprite[zoom_lvl].x_offs = reader.ReadWord();
+			sprite[zoom_lvl].y_offs = reader.ReadWord();
 
 			if (sprite[zoom_lvl].width > INT16_MAX || sprite[zoom_lvl].height > INT16_MAX) {
-				WarnCorruptSprite(file_slot, file_pos, __LINE__);
+				CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 				return 0;
 			}
 
@@ -306,30 +377,87 @@ uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 
 			/* For chunked encoding we store the decompressed size in the file,
 			 * otherwise we can calculate it from the image dimensions. */
-			uint decomp_size = (type & 0x08) ? FioReadDword() : sprite[zoom_lvl].width * sprite[zoom_lvl].height * bpp;
+			uint decomp_size = (type & 0x08) ? reader.ReadDword() : sprite[zoom_lvl].width * sprite[zoom_lvl].height * bpp;
 
-			bool valid = DecodeSingleSprite(&sprite[zoom_lvl], file_slot, file_pos, sprite_type, decomp_size, type, zoom_lvl, colour, 2);
-			if (FioGetPos() != start_pos + num) {
-				WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			bool valid = DecodeSingleSprite(reader, &sprite[zoom_lvl], file_slot, file_pos, sprite_type, decomp_size, type, zoom_lvl, colour, 2);
+			if (reader.GetPos() != start_pos + num) {
+				CorruptSprite<Reader>(file_slot, file_pos, __LINE__);
 				return 0;
 			}
 
 			if (valid) SetBit(loaded_sprites, zoom_lvl);
 		} else {
 			/* Not the wanted zoom level or colour depth, continue searching. */
-			FioSkipBytes(num - 2);
+			reader.SkipBytes(num - 2);
 		}
 
-	} while (FioReadDword() == id);
+	} while (reader.ReadDword() == id);
 
 	return loaded_sprites;
 }
 
 uint8 SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
 {
+	SpriteFileReader reader;
+	if (this->container_ver >= 2) {
+		return LoadSpriteV2(reader, sprite, file_slot, file_pos, sprite_type, load_32bpp);
+	} else {
+		return LoadSpriteV1(reader, sprite, file_slot, file_pos, sprite_type, load_32bpp);
+	}
+}
+
+/**
+ * Load a sprite from a copy of its data in memory, made by #GetSpriteDataSize and FioReadBlock.
+ * Unlike #LoadSprite this does not use the file or any other shared state, so
+ * it may be called by any thread, as long as the sprites have their own buffers.
+ * Errors in the sprite are not reported.
+ * @param[out] sprite The sprites to fill with data.
+ * @param data        Copy of the data of the sprite.
+ * @param size        Size of the copy.
+ * @param file_slot   The file "descriptor" of the file the sprite is in.
+ * @param file_pos    The position within the file the data was copied from.
+ * @param sprite_type The type of sprite we're trying to load.
+ * @param load_32bpp  True if 32bpp sprites should be loaded, false for a 8bpp sprite.
+ * @return Bit mask of the zoom levels successfully loaded or 0 if no sprite could be loaded.
+ */
+uint8 SpriteLoaderGrf::LoadSpriteFromMemory(SpriteLoader::Sprite *sprite, const byte *data, size_t size, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
+{
+	SpriteMemoryReader reader(data, size, file_pos);
 	if (this->container_ver >= 2) {
-		return LoadSpriteV2(sprite, file_slot, file_pos, sprite_type, load_32bpp);
+		return LoadSpriteV2(reader, sprite, file_slot, file_pos, sprite_type, load_32bpp);
 	} else {
-		return LoadSpriteV1(sprite, file_slot, file_pos, sprite_type, load_32bpp);
+		return LoadSpriteV1(reader, sprite, file_slot, file_pos, sprite_type, load_32bpp);
 	}
 }
+
+/**
+ * Get the number of bytes of the file that make up a sprite, i.e. what has
+ * to be copied for #LoadSpriteFromMemory.
+ * @param file_slot The file "descriptor" of the file the sprite is in.
+ * @param file_pos  The position within the file the sprite begins.
+ * @return The size of the data of the sprite, or 0 if it is not a loadable sprite.
+ */
+size_t SpriteLoaderGrf::GetSpriteDataSize(uint8 file_slot, size_t file_pos)
+{
+	if (this->container_ver >= 2) {
+		/* Is the sprite not present/stripped in the GRF? */
+		if (file_pos == SIZE_MAX) return 0;
+
+		/* All zoom levels and colour depths of the sprite follow each other, up to a different sprite ID. */
+		FioSeekToFile(file_slot, file_pos);
+		uint32 id = FioReadDword();
+		do {
+			FioSkipBytes(FioReadDword());
+		} while (FioReadDword() == id);
+	} else {
+		FioSeekToFile(file_slot, file_pos);
+		uint16 num = FioReadWord();
+		byte type = FioReadByte();
+		if (type == 0xFF) return 0;
+
+		FioSkipBytes(7);
+		if (!SkipSpriteData(type, num - 8)) return 0;
+	}
+
+	return FioGetPos() - file_pos;
+}
@@ -1327,10 +1327,10 @@ CommandCost CmdBuildRailStation(TileIndex tile_org, DoCommandFlag flags, uint32
 					TriggerStationAnimation(st, tile, SAT_BUILT);
 				}
 
+				YapfNotifyTrackLayoutChange(tile, track);
 				tile += tile_delta;
 			} while (--w);
 			AddTrackToSignalBuffer(tile_track, track, _current_company);
-			YapfNotifyTrackLayoutChange(tile_track, track);
 			tile_track += tile_delta ^ TileDiffXY(1, 1); // perpendicular to tile_delta
 		} while (--numtracks);
 
@@ -1862,6 +1862,7 @@ CommandCost CmdBuildRoadStop(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 			DirtyCompanyInfrastructureWindows(st->owner);
 
 			MarkTileDirtyByTile(cur_tile);
+			YapfNotifyRoadLayoutChange(cur_tile);
 		}
 	}
 
@@ -1965,6 +1966,7 @@ static CommandCost RemoveRoadStop(TileIndex tile, DoCommandFlag flags)
 		} else {
 			DoClearSquare(tile);
 		}
+		YapfNotifyRoadLayoutChange(tile);
 
 		SetWindowWidgetDirty(WC_STATION_VIEW, st->index, WID_SV_ROADVEHS);
 		delete cur_stop;
@@ -3488,7 +3490,8 @@ void DeleteStaleLinks(Station *from)
 						Vehicle *v = *iter;
 
 						LinkRefresher::Run(v, false); // Don't allow merging. Otherwise lg might get deleted.
-						if (edge.LastUpdate() == _date) {
+						/* Look the edge up again; refreshing may have added edges and moved it. */
+						if ((*lg)[ge.node][to->goods[c].node].LastUpdate() == _date) {
 							updated = true;
 							break;
 						}
@@ -3507,7 +3510,7 @@ void DeleteStaleLinks(Station *from)
 
 				if (!updated) {
 					/* If it's still considered dead remove it. */
-					node.RemoveEdge(to->goods[c].node);
+					(*lg)[ge.node].RemoveEdge(to->goods[c].node);
 					ge.flows.DeleteFlows(to->index);
 					RerouteCargo(from, c, to->index, from->index);
 				}
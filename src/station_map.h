@@ -406,6 +406,7 @@ static inline bool HasStationReservation(TileIndex t)
 static inline void SetRailStationReservation(TileIndex t, bool b)
 {
 	assert(HasStationRail(t));
+	_rail_state_epoch++;
 	SB(_me[t].m6, 2, 1, b ? 1 : 0);
 }
 
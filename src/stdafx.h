@@ -151,6 +151,7 @@
 	/* Warn about functions using 'printf' format syntax. First argument determines which parameter
 	 * is the format string, second argument is start of values passed to printf. */
 	#define WARN_FORMAT(string, args) __attribute__ ((format (printf, string, args)))
+	#define THREAD_LOCAL __thread
 	#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)
 		#define FINAL final
 	#else
@@ -163,6 +164,7 @@
 	#define CDECL
 	#define GCC_PACK
 	#define WARN_FORMAT(string, args)
+	#define THREAD_LOCAL __declspec(thread)
 	#define FINAL
 	#include <malloc.h>
 #endif /* __WATCOMC__ */
@@ -233,6 +235,7 @@
 
 	#define GCC_PACK
 	#define WARN_FORMAT(string, args)
+	#define THREAD_LOCAL __declspec(thread)
 	#define FINAL sealed
 
 	#if defined(WINCE)
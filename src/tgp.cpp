@@ -16,6 +16,7 @@
 #include "genworld.h"
 #include "core/random_func.hpp"
 #include "landscape_type.h"
+#include "thread/thread.h"
 
 #include "safeguards.h"
 
@@ -328,6 +329,41 @@ static inline void FreeHeightMap()
 	_height_map.h = NULL;
 }
 
+/** Table of new heights for the heights in the height map. */
+struct HeightMapTable {
+	const height_t *heights; ///< New heights, indexed by old height minus offset.
+	height_t offset;         ///< Lowest old height in the table.
+};
+
+/**
+ * Look up new heights for a range of the height map; for #RunParallel.
+ * @param param The #HeightMapTable to use.
+ * @param first First item of the height map to change.
+ * @param last One past the last item of the height map to change.
+ */
+static void HeightMapApplyTableProc(void *param, uint first, uint last)
+{
+	const HeightMapTable *table = (const HeightMapTable *)param;
+	height_t *end = _height_map.h + last;
+	for (height_t *h = _height_map.h + first; h < end; h++) {
+		*h = table->heights[*h - table->offset];
+	}
+}
+
+/**
+ * Replace every height in the height map by the new height given for it in
+ * a table. Transformations depending on nothing but the height itself are
+ * done like this, so they are calculated once per height instead of once
+ * per tile.
+ * @param heights New heights; there must be one for every height in the height map.
+ * @param offset Lowest height in the height map, for which the first new height is given.
+ */
+static void HeightMapApplyTable(const height_t *heights, height_t offset)
+{
+	HeightMapTable table = { heights, offset };
+	RunParallel(&HeightMapApplyTableProc, &table, _height_map.total_size, 1 << 16);
+}
+
 /**
  * Generates new random height in given amplitude (generated numbers will range from - amplitude to + amplitude)
  * @param rMax Limit of result
@@ -443,80 +479,173 @@ static int *HeightMapMakeHistogram(height_t h_min, height_t h_max, int *hist_buf
 	return hist;
 }
 
+/**
+ * Apply the sine wave redistribution to a single height.
+ * @param height Height to transform; at least h_min.
+ * @param h_min Lowest height to transform.
+ * @param h_max Highest height after the transformation.
+ * @return The transformed height.
+ */
+static height_t SineTransformHeight(height_t height, height_t h_min, height_t h_max)
+{
+	double fheight;
+
+	/* Transform height into 0..1 space */
+	fheight = (double)(height - h_min) / (double)(h_max - h_min);
+	/* Apply sine transform depending on landscape type */
+	switch (_settings_game.game_creation.landscape) {
+		case LT_TOYLAND:
+		case LT_TEMPERATE:
+			/* Move and scale 0..1 into -1..+1 */
+			fheight = 2 * fheight - 1;
+			/* Sine transform */
+			fheight = sin(fheight * M_PI_2);
+			/* Transform it back from -1..1 into 0..1 space */
+			fheight = 0.5 * (fheight + 1);
+			break;
+
+		case LT_ARCTIC:
+			{
+				/* Arctic terrain needs special height distribution.
+				 * Redistribute heights to have more tiles at highest (75%..100%) range */
+				double sine_upper_limit = 0.75;
+				double linear_compression = 2;
+				if (fheight >= sine_upper_limit) {
+					/* Over the limit we do linear compression up */
+					fheight = 1.0 - (1.0 - fheight) / linear_compression;
+				} else {
+					double m = 1.0 - (1.0 - sine_upper_limit) / linear_compression;
+					/* Get 0..sine_upper_limit into -1..1 */
+					fheight = 2.0 * fheight / sine_upper_limit - 1.0;
+					/* Sine wave transform */
+					fheight = sin(fheight * M_PI_2);
+					/* Get -1..1 back to 0..(1 - (1 - sine_upper_limit) / linear_compression) == 0.0..m */
+					fheight = 0.5 * (fheight + 1.0) * m;
+				}
+			}
+			break;
+
+		case LT_TROPIC:
+			{
+				/* Desert terrain needs special height distribution.
+				 * Half of tiles should be at lowest (0..25%) heights */
+				double sine_lower_limit = 0.5;
+				double linear_compression = 2;
+				if (fheight <= sine_lower_limit) {
+					/* Under the limit we do linear compression down */
+					fheight = fheight / linear_compression;
+				} else {
+					double m = sine_lower_limit / linear_compression;
+					/* Get sine_lower_limit..1 into -1..1 */
+					fheight = 2.0 * ((fheight - sine_lower_limit) / (1.0 - sine_lower_limit)) - 1.0;
+					/* Sine wave transform */
+					fheight = sin(fheight * M_PI_2);
+					/* Get -1..1 back to (sine_lower_limit / linear_compression)..1.0 */
+					fheight = 0.5 * ((1.0 - m) * fheight + (1.0 + m));
+				}
+			}
+			break;
+
+		default:
+			NOT_REACHED();
+			break;
+	}
+	/* Transform it back into h_min..h_max space */
+	height = (height_t)(fheight * (h_max - h_min) + h_min);
+	if (height < 0) height = I2H(0);
+	if (height >= h_max) height = h_max - 1;
+	return height;
+}
+
 /** Applies sine wave redistribution onto height map */
 static void HeightMapSineTransform(height_t h_min, height_t h_max)
 {
-	height_t *h;
+	height_t h_lowest, h_highest;
+	HeightMapGetMinMaxAvg(&h_lowest, &h_highest, NULL);
 
-	FOR_ALL_TILES_IN_HEIGHT(h) {
-		double fheight;
-
-		if (*h < h_min) continue;
-
-		/* Transform height into 0..1 space */
-		fheight = (double)(*h - h_min) / (double)(h_max - h_min);
-		/* Apply sine transform depending on landscape type */
-		switch (_settings_game.game_creation.landscape) {
-			case LT_TOYLAND:
-			case LT_TEMPERATE:
-				/* Move and scale 0..1 into -1..+1 */
-				fheight = 2 * fheight - 1;
-				/* Sine transform */
-				fheight = sin(fheight * M_PI_2);
-				/* Transform it back from -1..1 into 0..1 space */
-				fheight = 0.5 * (fheight + 1);
-				break;
-
-			case LT_ARCTIC:
-				{
-					/* Arctic terrain needs special height distribution.
-					 * Redistribute heights to have more tiles at highest (75%..100%) range */
-					double sine_upper_limit = 0.75;
-					double linear_compression = 2;
-					if (fheight >= sine_upper_limit) {
-						/* Over the limit we do linear compression up */
-						fheight = 1.0 - (1.0 - fheight) / linear_compression;
-					} else {
-						double m = 1.0 - (1.0 - sine_upper_limit) / linear_compression;
-						/* Get 0..sine_upper_limit into -1..1 */
-						fheight = 2.0 * fheight / sine_upper_limit - 1.0;
-						/* Sine wave transform */
-						fheight = sin(fheight * M_PI_2);
-						/* Get -1..1 back to 0..(1 - (1 - sine_upper_limit) / linear_compression) == 0.0..m */
-						fheight = 0.5 * (fheight + 1.0) * m;
-					}
-				}
-				break;
-
-			case LT_TROPIC:
-				{
-					/* Desert terrain needs special height distribution.
-					 * Half of tiles should be at lowest (0..25%) heights */
-					double sine_lower_limit = 0.5;
-					double linear_compression = 2;
-					if (fheight <= sine_lower_limit) {
-						/* Under the limit we do linear compression down */
-						fheight = fheight / linear_compression;
-					} else {
-						double m = sine_lower_limit / linear_compression;
-						/* Get sine_lower_limit..1 into -1..1 */
-						fheight = 2.0 * ((fheight - sine_lower_limit) / (1.0 - sine_lower_limit)) - 1.0;
-						/* Sine wave transform */
-						fheight = sin(fheight * M_PI_2);
-						/* Get -1..1 back to (sine_lower_limit / linear_compression)..1.0 */
-						fheight = 0.5 * ((1.0 - m) * fheight + (1.0 + m));
-					}
-				}
-				break;
+	height_t *heights = MallocT<height_t>(h_highest - h_lowest + 1);
+	for (int h = h_lowest; h <= h_highest; h++) {
+		heights[h - h_lowest] = h < h_min ? (height_t)h : SineTransformHeight(h, h_min, h_max);
+	}
+	HeightMapApplyTable(heights, h_lowest);
+	free(heights);
+}
+
+/** Position of a row or column of the height map within the grid of curve maps. */
+struct CurveGridPos {
+	uint p1;  ///< Lower grid position.
+	uint p2;  ///< Upper grid position.
+	float r;  ///< Bi-linear ratio of the upper grid position.
+	float ri; ///< Bi-linear ratio of the lower grid position.
 
-			default:
-				NOT_REACHED();
-				break;
+	/**
+	 * Determine the grid positions and ratios for a row or column.
+	 * @param pos Position of the row or column on the height map.
+	 * @param size Size of the height map in this direction.
+	 * @param grid_size Size of the grid in this direction.
+	 */
+	void Init(int pos, int size, uint grid_size)
+	{
+		float f = (float)(grid_size * pos) / size + 1.0f;
+		this->p1 = (uint)f;
+		this->p2 = this->p1;
+		this->r = 2.0f * (f - this->p1) - 1.0f;
+		this->r = sin(this->r * M_PI_2);
+		this->r = sin(this->r * M_PI_2);
+		this->r = 0.5f * (this->r + 1.0f);
+		this->ri = 1.0f - this->r;
+
+		if (this->p1 > 0) {
+			this->p1--;
+			if (this->p2 >= grid_size) this->p2--;
+		}
+	}
+};
+
+/** Everything the rows of the height map need to have the curve maps applied. */
+struct HeightMapCurvesData {
+	const byte *grid;         ///< Curve map to use for each grid section.
+	uint grid_size_x;         ///< Number of grid sections in x direction.
+	const CurveGridPos *xpos; ///< Grid positions of the columns.
+	const CurveGridPos *ypos; ///< Grid positions of the rows.
+	const height_t *curves;   ///< Curved heights, for each curve map all heights above sea level.
+	height_t max_height;      ///< Number of heights above sea level in each curve map.
+};
+
+/**
+ * Apply the curve maps to a range of rows of the height map; for #RunParallel.
+ * @param param The #HeightMapCurvesData to use.
+ * @param first First row to change.
+ * @param last One past the last row to change.
+ */
+static void HeightMapCurvesProc(void *param, uint first, uint last)
+{
+	const HeightMapCurvesData *data = (const HeightMapCurvesData *)param;
+	const byte *c = data->grid;
+	uint sx = data->grid_size_x;
+
+	for (int y = first; y < (int)last; y++) {
+		const CurveGridPos &yp = data->ypos[y];
+		height_t *h = &_height_map.height(0, y);
+
+		for (int x = 0; x < _height_map.size_x; x++, h++) {
+			/* Do not touch sea level */
+			if (*h < I2H(1)) continue;
+
+			assert(*h - I2H(1) < data->max_height);
+			const CurveGridPos &xp = data->xpos[x];
+			const height_t *ht = data->curves + (*h - I2H(1));
+			height_t ht_a = ht[c[xp.p1 + sx * yp.p1] * data->max_height];
+			height_t ht_b = ht[c[xp.p1 + sx * yp.p2] * data->max_height];
+			height_t ht_c = ht[c[xp.p2 + sx * yp.p1] * data->max_height];
+			height_t ht_d = ht[c[xp.p2 + sx * yp.p2] * data->max_height];
+
+			/* Apply interpolation of curve map results. */
+			*h = (height_t)((ht_a * yp.ri + ht_b * yp.r) * xp.ri + (ht_c * yp.ri + ht_d * yp.r) * xp.r);
+
+			/* Readd sea level */
+			*h += I2H(1);
 		}
-		/* Transform it back into h_min..h_max space */
-		*h = (height_t)(fheight * (h_max - h_min) + h_min);
-		if (*h < 0) *h = I2H(0);
-		if (*h >= h_max) *h = h_max - 1;
 	}
 }
 
@@ -565,9 +694,6 @@ static void HeightMapCurves(uint level)
 		{ lengthof(curve_map_4), curve_map_4 },
 	};
 
-	height_t ht[lengthof(curve_maps)];
-	MemSetT(ht, 0, lengthof(ht));
-
 	/* Set up a grid to choose curve maps based on location; attempt to get a somewhat square grid */
 	float factor = sqrt((float)_height_map.size_x / (float)_height_map.size_y);
 	uint sx = Clamp((int)(((1 << level) * factor) + 0.5), 1, 128);
@@ -578,88 +704,34 @@ static void HeightMapCurves(uint level)
 		c[i] = Random() % lengthof(curve_maps);
 	}
 
-	/* Apply curves */
-	for (int x = 0; x < _height_map.size_x; x++) {
-
-		/* Get our X grid positions and bi-linear ratio */
-		float fx = (float)(sx * x) / _height_map.size_x + 1.0f;
-		uint x1 = (uint)fx;
-		uint x2 = x1;
-		float xr = 2.0f * (fx - x1) - 1.0f;
-		xr = sin(xr * M_PI_2);
-		xr = sin(xr * M_PI_2);
-		xr = 0.5f * (xr + 1.0f);
-		float xri = 1.0f - xr;
-
-		if (x1 > 0) {
-			x1--;
-			if (x2 >= sx) x2--;
+	/* Get the grid positions and bi-linear ratios of all columns and rows */
+	CurveGridPos *xpos = MallocT<CurveGridPos>(_height_map.size_x);
+	CurveGridPos *ypos = MallocT<CurveGridPos>(_height_map.size_y);
+	for (int x = 0; x < _height_map.size_x; x++) xpos[x].Init(x, _height_map.size_x, sx);
+	for (int y = 0; y < _height_map.size_y; y++) ypos[y].Init(y, _height_map.size_y, sy);
+
+	/* Scale every height above sea level with every curve map once, instead of once per tile */
+	height_t *curves = MallocT<height_t>(lengthof(curve_maps) * mh);
+	for (uint t = 0; t < lengthof(curve_maps); t++) {
+		const control_point_t *cm = curve_maps[t].list;
+		uint i = 0;
+		for (height_t h = 0; h < mh; h++) {
+			while (i < curve_maps[t].length - 1 && h >= cm[i + 1].x) i++;
+			assert(i < curve_maps[t].length - 1 && h >= cm[i].x);
+
+			const control_point_t &p1 = cm[i];
+			const control_point_t &p2 = cm[i + 1];
+			curves[t * mh + h] = p1.y + (h - p1.x) * (p2.y - p1.y) / (p2.x - p1.x);
 		}
+	}
 
-		for (int y = 0; y < _height_map.size_y; y++) {
-
-			/* Get our Y grid position and bi-linear ratio */
-			float fy = (float)(sy * y) / _height_map.size_y + 1.0f;
-			uint y1 = (uint)fy;
-			uint y2 = y1;
-			float yr = 2.0f * (fy - y1) - 1.0f;
-			yr = sin(yr * M_PI_2);
-			yr = sin(yr * M_PI_2);
-			yr = 0.5f * (yr + 1.0f);
-			float yri = 1.0f - yr;
-
-			if (y1 > 0) {
-				y1--;
-				if (y2 >= sy) y2--;
-			}
-
-			uint corner_a = c[x1 + sx * y1];
-			uint corner_b = c[x1 + sx * y2];
-			uint corner_c = c[x2 + sx * y1];
-			uint corner_d = c[x2 + sx * y2];
-
-			/* Bitmask of which curve maps are chosen, so that we do not bother
-			 * calculating a curve which won't be used. */
-			uint corner_bits = 0;
-			corner_bits |= 1 << corner_a;
-			corner_bits |= 1 << corner_b;
-			corner_bits |= 1 << corner_c;
-			corner_bits |= 1 << corner_d;
-
-			height_t *h = &_height_map.height(x, y);
-
-			/* Do not touch sea level */
-			if (*h < I2H(1)) continue;
-
-			/* Only scale above sea level */
-			*h -= I2H(1);
-
-			/* Apply all curve maps that are used on this tile. */
-			for (uint t = 0; t < lengthof(curve_maps); t++) {
-				if (!HasBit(corner_bits, t)) continue;
-
-				bool found = false;
-				const control_point_t *cm = curve_maps[t].list;
-				for (uint i = 0; i < curve_maps[t].length - 1; i++) {
-					const control_point_t &p1 = cm[i];
-					const control_point_t &p2 = cm[i + 1];
-
-					if (*h >= p1.x && *h < p2.x) {
-						ht[t] = p1.y + (*h - p1.x) * (p2.y - p1.y) / (p2.x - p1.x);
-						found = true;
-						break;
-					}
-				}
-				assert(found);
-			}
-
-			/* Apply interpolation of curve map results. */
-			*h = (height_t)((ht[corner_a] * yri + ht[corner_b] * yr) * xri + (ht[corner_c] * yri + ht[corner_d] * yr) * xr);
+	/* Apply curves */
+	HeightMapCurvesData data = { c, sx, xpos, ypos, curves, mh };
+	RunParallel(&HeightMapCurvesProc, &data, _height_map.size_y, max(1, (1 << 16) / _height_map.size_x));
 
-			/* Readd sea level */
-			*h += I2H(1);
-		}
-	}
+	free(curves);
+	free(ypos);
+	free(xpos);
 }
 
 /** Adjusts heights in height map to contain required amount of water tiles */
@@ -667,7 +739,6 @@ static void HeightMapAdjustWaterLevel(amplitude_t water_percent, height_t h_max_
 {
 	height_t h_min, h_max, h_avg, h_water_level;
 	int64 water_tiles, desired_water_tiles;
-	height_t *h;
 	int *hist;
 
 	HeightMapGetMinMaxAvg(&h_min, &h_max, &h_avg);
@@ -691,19 +762,97 @@ static void HeightMapAdjustWaterLevel(amplitude_t water_percent, height_t h_max_
 	 *   values from range: h_min..h_water_level will become negative so it will be clamped to 0
 	 *   values from range: h_water_level..h_max are transformed into 0..h_max_new
 	 *   where h_max_new is depending on terrain type and map size.
+	 * The heights are only in the range h_min..h_max, so calculate the new
+	 * height once for each of them and look them up.
 	 */
-	FOR_ALL_TILES_IN_HEIGHT(h) {
+	height_t *heights = MallocT<height_t>(h_max - h_min + 1);
+	for (int i = h_min; i <= h_max; i++) {
 		/* Transform height from range h_water_level..h_max into 0..h_max_new range */
-		*h = (height_t)(((int)h_max_new) * (*h - h_water_level) / (h_max - h_water_level)) + I2H(1);
+		height_t h = (height_t)(((int)h_max_new) * (i - h_water_level) / (h_max - h_water_level)) + I2H(1);
 		/* Make sure all values are in the proper range (0..h_max_new) */
-		if (*h < 0) *h = I2H(0);
-		if (*h >= h_max_new) *h = h_max_new - 1;
+		if (h < 0) h = I2H(0);
+		if (h >= h_max_new) h = h_max_new - 1;
+		heights[i - h_min] = h;
 	}
+	HeightMapApplyTable(heights, h_min);
 
+	free(heights);
 	free(hist_buf);
 }
 
-static double perlin_coast_noise_2D(const double x, const double y, const double p, const int prime);
+static double int_noise(const long x, const long y, const int prime);
+static inline double linear_interpolate(const double a, const double b, const double x);
+
+/** Number of octaves of the Perlin noise of the coast lines. */
+static const int COAST_NOISE_OCTAVES = 6;
+
+/**
+ * A similar noise to the main perlin noise calculation, but it uses the value
+ * p passed as a parameter rather than selected from the predefined sequences.
+ * It is used to create the indented coastline, which is just another perlin
+ * sequence. Consecutive samples along a coast mostly fall between the same
+ * grid points, so the noise of the grid points of the last sample is kept
+ * for every octave instead of being calculated again.
+ */
+struct CoastNoise {
+	int prime;                                    ///< Prime selecting the series of the noise.
+	double amplitude[COAST_NOISE_OCTAVES];        ///< Amplitude of each octave.
+	int grid_x[COAST_NOISE_OCTAVES];              ///< X of the grid point of the last sample of each octave.
+	int grid_y[COAST_NOISE_OCTAVES];              ///< Y of the grid point of the last sample of each octave.
+	double corners[COAST_NOISE_OCTAVES][4];       ///< Noise at the grid points around the last sample of each octave.
+
+	/**
+	 * Create the noise.
+	 * @param p Persistence of the noise; the amplitude of an octave relative to the previous one.
+	 * @param prime Prime selecting the series of the noise.
+	 */
+	CoastNoise(const double p, const int prime) : prime(prime)
+	{
+		for (int i = 0; i < COAST_NOISE_OCTAVES; i++) {
+			this->amplitude[i] = pow(p, (double)i);
+			this->grid_x[i] = INT_MIN;
+			this->grid_y[i] = INT_MIN;
+		}
+	}
+
+	/**
+	 * Get the noise at a position.
+	 * @param x X of the position.
+	 * @param y Y of the position.
+	 * @return The noise.
+	 */
+	double Get(const double x, const double y)
+	{
+		double total = 0.0;
+
+		for (int i = 0; i < COAST_NOISE_OCTAVES; i++) {
+			const double frequency = (double)(1 << i);
+			const double sx = (x * frequency) / 64.0;
+			const double sy = (y * frequency) / 64.0;
+
+			const int integer_X = (int)sx;
+			const int integer_Y = (int)sy;
+			double *v = this->corners[i];
+			if (integer_X != this->grid_x[i] || integer_Y != this->grid_y[i]) {
+				this->grid_x[i] = integer_X;
+				this->grid_y[i] = integer_Y;
+				v[0] = int_noise(integer_X,     integer_Y,     this->prime);
+				v[1] = int_noise(integer_X + 1, integer_Y,     this->prime);
+				v[2] = int_noise(integer_X,     integer_Y + 1, this->prime);
+				v[3] = int_noise(integer_X + 1, integer_Y + 1, this->prime);
+			}
+
+			const double fractional_X = sx - (double)integer_X;
+			const double fractional_Y = sy - (double)integer_Y;
+			const double i1 = linear_interpolate(v[0], v[1], fractional_X);
+			const double i2 = linear_interpolate(v[2], v[3], fractional_X);
+
+			total += linear_interpolate(i1, i2, fractional_Y) * this->amplitude[i];
+		}
+
+		return total;
+	}
+};
 
 /**
  * This routine sculpts in from the edge a random amount, again a Perlin
@@ -732,12 +881,16 @@ static void HeightMapCoastLines(uint8 water_borders)
 	int y, x;
 	double max_x;
 	double max_y;
+	CoastNoise ne_noise1(0.9, 53), ne_noise2(0.35, 179);
+	CoastNoise sw_noise1(0.85, 101), sw_noise2(0.45, 67);
+	CoastNoise nw_noise1(0.9, 167), nw_noise2(0.4, 211);
+	CoastNoise se_noise1(0.85, 71), se_noise2(0.35, 193);
 
 	/* Lower to sea level */
 	for (y = 0; y <= _height_map.size_y; y++) {
 		if (HasBit(water_borders, BORDER_NE)) {
 			/* Top right */
-			max_x = abs((perlin_coast_noise_2D(_height_map.size_y - y, y, 0.9, 53) + 0.25) * 5 + (perlin_coast_noise_2D(y, y, 0.35, 179) + 1) * 12);
+			max_x = abs((ne_noise1.Get(_height_map.size_y - y, y) + 0.25) * 5 + (ne_noise2.Get(y, y) + 1) * 12);
 			max_x = max((smallest_size * smallest_size / 64) + max_x, (smallest_size * smallest_size / 64) + margin - max_x);
 			if (smallest_size < 8 && max_x > 5) max_x /= 1.5;
 			for (x = 0; x < max_x; x++) {
@@ -747,7 +900,7 @@ static void HeightMapCoastLines(uint8 water_borders)
 
 		if (HasBit(water_borders, BORDER_SW)) {
 			/* Bottom left */
-			max_x = abs((perlin_coast_noise_2D(_height_map.size_y - y, y, 0.85, 101) + 0.3) * 6 + (perlin_coast_noise_2D(y, y, 0.45,  67) + 0.75) * 8);
+			max_x = abs((sw_noise1.Get(_height_map.size_y - y, y) + 0.3) * 6 + (sw_noise2.Get(y, y) + 0.75) * 8);
 			max_x = max((smallest_size * smallest_size / 64) + max_x, (smallest_size * smallest_size / 64) + margin - max_x);
 			if (smallest_size < 8 && max_x > 5) max_x /= 1.5;
 			for (x = _height_map.size_x; x > (_height_map.size_x - 1 - max_x); x--) {
@@ -760,7 +913,7 @@ static void HeightMapCoastLines(uint8 water_borders)
 	for (x = 0; x <= _height_map.size_x; x++) {
 		if (HasBit(water_borders, BORDER_NW)) {
 			/* Top left */
-			max_y = abs((perlin_coast_noise_2D(x, _height_map.size_y / 2, 0.9, 167) + 0.4) * 5 + (perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.4, 211) + 0.7) * 9);
+			max_y = abs((nw_noise1.Get(x, _height_map.size_y / 2) + 0.4) * 5 + (nw_noise2.Get(x, _height_map.size_y / 3) + 0.7) * 9);
 			max_y = max((smallest_size * smallest_size / 64) + max_y, (smallest_size * smallest_size / 64) + margin - max_y);
 			if (smallest_size < 8 && max_y > 5) max_y /= 1.5;
 			for (y = 0; y < max_y; y++) {
@@ -770,7 +923,7 @@ static void HeightMapCoastLines(uint8 water_borders)
 
 		if (HasBit(water_borders, BORDER_SE)) {
 			/* Bottom right */
-			max_y = abs((perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.85, 71) + 0.25) * 6 + (perlin_coast_noise_2D(x, _height_map.size_y / 3, 0.35, 193) + 0.75) * 12);
+			max_y = abs((se_noise1.Get(x, _height_map.size_y / 3) + 0.25) * 6 + (se_noise2.Get(x, _height_map.size_y / 3) + 0.75) * 12);
 			max_y = max((smallest_size * smallest_size / 64) + max_y, (smallest_size * smallest_size / 64) + margin - max_y);
 			if (smallest_size < 8 && max_y > 5) max_y /= 1.5;
 			for (y = _height_map.size_y; y > (_height_map.size_y - 1 - max_y); y--) {
@@ -842,16 +995,36 @@ static void HeightMapSmoothCoasts(uint8 water_borders)
  */
 static void HeightMapSmoothSlopes(height_t dh_max)
 {
+	/* Limiting a tile by its neighbour in the previous row and by its
+	 * neighbour in the previous column can be done one after the other. The
+	 * first is independent for every tile of the row, so that simple loop
+	 * can be vectorised by the compiler; only the second is a scan. */
 	for (int y = 0; y <= (int)_height_map.size_y; y++) {
-		for (int x = 0; x <= (int)_height_map.size_x; x++) {
-			height_t h_max = min(_height_map.height(x > 0 ? x - 1 : x, y), _height_map.height(x, y > 0 ? y - 1 : y)) + dh_max;
-			if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+		height_t *h = &_height_map.height(0, y);
+		if (y > 0) {
+			const height_t *prev = h - _height_map.dim_x;
+			for (int x = 0; x <= (int)_height_map.size_x; x++) {
+				height_t h_max = prev[x] + dh_max;
+				if (h[x] > h_max) h[x] = h_max;
+			}
+		}
+		for (int x = 1; x <= (int)_height_map.size_x; x++) {
+			height_t h_max = h[x - 1] + dh_max;
+			if (h[x] > h_max) h[x] = h_max;
 		}
 	}
 	for (int y = _height_map.size_y; y >= 0; y--) {
-		for (int x = _height_map.size_x; x >= 0; x--) {
-			height_t h_max = min(_height_map.height(x < _height_map.size_x ? x + 1 : x, y), _height_map.height(x, y < _height_map.size_y ? y + 1 : y)) + dh_max;
-			if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+		height_t *h = &_height_map.height(0, y);
+		if (y < _height_map.size_y) {
+			const height_t *next = h + _height_map.dim_x;
+			for (int x = _height_map.size_x; x >= 0; x--) {
+				height_t h_max = next[x] + dh_max;
+				if (h[x] > h_max) h[x] = h_max;
+			}
+		}
+		for (int x = _height_map.size_x - 1; x >= 0; x--) {
+			height_t h_max = h[x + 1] + dh_max;
+			if (h[x] > h_max) h[x] = h_max;
 		}
 	}
 }
@@ -917,51 +1090,6 @@ static inline double linear_interpolate(const double a, const double b, const do
 }
 
 
-/**
- * This routine returns the smoothed interpolated noise for an x and y, using
- * the values from the surrounding positions.
- */
-static double interpolated_noise(const double x, const double y, const int prime)
-{
-	const int integer_X = (int)x;
-	const int integer_Y = (int)y;
-
-	const double fractional_X = x - (double)integer_X;
-	const double fractional_Y = y - (double)integer_Y;
-
-	const double v1 = int_noise(integer_X,     integer_Y,     prime);
-	const double v2 = int_noise(integer_X + 1, integer_Y,     prime);
-	const double v3 = int_noise(integer_X,     integer_Y + 1, prime);
-	const double v4 = int_noise(integer_X + 1, integer_Y + 1, prime);
-
-	const double i1 = linear_interpolate(v1, v2, fractional_X);
-	const double i2 = linear_interpolate(v3, v4, fractional_X);
-
-	return linear_interpolate(i1, i2, fractional_Y);
-}
-
-
-/**
- * This is a similar function to the main perlin noise calculation, but uses
- * the value p passed as a parameter rather than selected from the predefined
- * sequences. as you can guess by its title, i use this to create the indented
- * coastline, which is just another perlin sequence.
- */
-static double perlin_coast_noise_2D(const double x, const double y, const double p, const int prime)
-{
-	double total = 0.0;
-
-	for (int i = 0; i < 6; i++) {
-		const double frequency = (double)(1 << i);
-		const double amplitude = pow(p, (double)i);
-
-		total += interpolated_noise((x * frequency) / 64.0, (y * frequency) / 64.0, prime) * amplitude;
-	}
-
-	return total;
-}
-
-
 /** A small helper function to initialize the terrain */
 static void TgenSetTileHeight(TileIndex tile, int height)
 {
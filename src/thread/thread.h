@@ -123,4 +123,31 @@ private:
  */
 uint GetCPUCoreCount();
 
+/**
+ * Definition of the functions doing a part of the work given to #RunParallel.
+ * @param param The parameter given to #RunParallel.
+ * @param first The first item to work on.
+ * @param last  One past the last item to work on.
+ */
+typedef void (*ParallelWorkProc)(void *param, uint first, uint last);
+
+/** Work divided over the worker threads by #StartParallel, that is not waited for. */
+struct ParallelJob {
+	ParallelWorkProc proc; ///< The function doing the work.
+	void *param;           ///< The parameter to pass to #proc.
+	uint count;            ///< The number of items to work on.
+	uint ranges;           ///< The number of ranges the items are divided in.
+	uint next_range;       ///< The next range to hand out to a thread.
+	uint pending;          ///< The number of ranges that are not done yet.
+
+	ParallelJob() : ranges(0), next_range(0), pending(0) {}
+};
+
+uint GetWorkerThreadCount();
+void DisableParallel();
+void RunParallel(ParallelWorkProc proc, void *param, uint count, uint min_items);
+void StartParallel(ParallelJob *job, ParallelWorkProc proc, void *param, uint count, uint min_items);
+bool IsParallelJobDone(const ParallelJob *job);
+void WaitForParallelJob(ParallelJob *job);
+
 #endif /* THREAD_H */
@@ -0,0 +1,295 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file thread_parallel.cpp Dividing work over a pool of worker threads, independent of the used thread implementation. */
+
+#include "../stdafx.h"
+#include "../core/math_func.hpp"
+#include "../core/mem_func.hpp"
+#include "../core/smallvec_type.hpp"
+#include "../settings_type.h"
+#include "../gfx_func.h"
+#include "thread.h"
+
+#include "../safeguards.h"
+
+static ThreadMutex *_parallel_mutex = ThreadMutex::New();      ///< Guards the queue and the jobs in it; idle workers wait on it for work.
+static ThreadMutex *_parallel_done_mutex = ThreadMutex::New(); ///< The caller of #RunParallel waits on it till its job is done.
+static SmallVector<ParallelJob *, 4> _parallel_queue;          ///< Jobs with ranges that have not been handed out yet.
+static uint _parallel_threads = 0;                             ///< Number of started worker threads; they are never stopped.
+static bool _parallel_waiting = false;                         ///< Whether a caller of #RunParallel is waiting for its job.
+static bool _parallel_disabled = false;                        ///< Whether all work is done by the calling thread, see #DisableParallel.
+
+/**
+ * Hand out the next range of a job to a thread.
+ * @pre The caller is in the critical section of #_parallel_mutex.
+ * @param index Index of the job in #_parallel_queue.
+ * @param first [out] The first item of the range.
+ * @param last [out] One past the last item of the range.
+ * @return The job the range belongs to.
+ */
+static ParallelJob *TakeParallelRange(uint index, uint *first, uint *last)
+{
+	ParallelJob *job = _parallel_queue[index];
+	uint range = job->next_range++;
+	*first = (uint)((uint64)job->count * range / job->ranges);
+	*last = (uint)((uint64)job->count * (range + 1) / job->ranges);
+	if (job->next_range == job->ranges) _parallel_queue.ErasePreservingOrder(index);
+	return job;
+}
+
+/**
+ * Mark a range of a job as done, and wake the caller of #RunParallel when
+ * that was the last range of its job.
+ * @pre The caller is in the critical section of #_parallel_mutex.
+ * @param job The job.
+ * @post The caller is in the critical section of #_parallel_mutex, but it has been left in between.
+ */
+static void FinishParallelRange(ParallelJob *job)
+{
+	if (--job->pending != 0) return;
+
+	/* The job may be gone as soon as the critical section is left. */
+	_parallel_mutex->EndCritical();
+	_parallel_done_mutex->BeginCritical();
+	_parallel_done_mutex->SendSignal();
+	_parallel_done_mutex->EndCritical();
+	_parallel_mutex->BeginCritical();
+}
+
+/**
+ * Entry point of the worker threads. They wait for jobs and work on their
+ * ranges until the game exits.
+ * @param arg Unused.
+ */
+static void ParallelWorkerThread(void *arg)
+{
+	_parallel_mutex->BeginCritical();
+	for (;;) {
+		while (_parallel_queue.Length() == 0) _parallel_mutex->WaitForSignal();
+
+		uint first, last;
+		ParallelJob *job = TakeParallelRange(0, &first, &last);
+
+		/* Only one waiting worker is woken at a time, so pass the work on. */
+		if (_parallel_queue.Length() != 0) _parallel_mutex->SendSignal();
+		_parallel_mutex->EndCritical();
+
+		job->proc(job->param, first, last);
+
+		_parallel_mutex->BeginCritical();
+		FinishParallelRange(job);
+	}
+}
+
+/**
+ * Get the number of threads work may be divided over.
+ * @return The configured number of worker threads, or the number of cores when not configured.
+ */
+uint GetWorkerThreadCount()
+{
+	uint threads = _settings_client.gui.worker_threads;
+	if (threads == 0) threads = GetCPUCoreCount();
+	return max(threads, 1U);
+}
+
+/**
+ * Do all work given to #RunParallel and #StartParallel in the calling thread
+ * from now on, without touching the worker threads or their mutexes. For a
+ * forked process: it only has the thread that called fork(), and a mutex
+ * may have been held by one of the other threads at the time of the fork.
+ */
+void DisableParallel()
+{
+	_parallel_disabled = true;
+}
+
+/**
+ * Start the worker threads that are still missing.
+ * @pre The caller is in the critical section of #_parallel_mutex.
+ * @param threads The number of worker threads that are wanted.
+ */
+static void StartWorkerThreads(uint threads)
+{
+	while (_parallel_threads < threads) {
+		if (!ThreadObject::New(&ParallelWorkerThread, NULL, NULL, "ottd:worker")) break;
+		_parallel_threads++;
+	}
+}
+
+/**
+ * Put a job in the queue of the worker threads.
+ * @pre The caller is in the critical section of #_parallel_mutex.
+ * @param job The job.
+ * @param proc The function doing the work on a range of items.
+ * @param param The parameter to pass to \a proc.
+ * @param count The number of items to work on.
+ * @param ranges The number of ranges to divide the items in.
+ * @param urgent Whether the job goes before the jobs already queued.
+ */
+static void QueueParallelJob(ParallelJob *job, ParallelWorkProc proc, void *param, uint count, uint ranges, bool urgent)
+{
+	job->proc = proc;
+	job->param = param;
+	job->count = count;
+	job->ranges = ranges;
+	job->next_range = 0;
+	job->pending = ranges;
+
+	*_parallel_queue.Append() = job;
+	if (urgent) {
+		MemMoveT(_parallel_queue.Begin() + 1, _parallel_queue.Begin(), _parallel_queue.Length() - 1);
+		_parallel_queue[0] = job;
+	}
+	_parallel_mutex->SendSignal();
+}
+
+/**
+ * Work on the ranges of a job that no worker thread has taken yet, and wait
+ * till the worker threads finished the other ranges.
+ * @pre The caller is in the critical section of #_parallel_mutex.
+ * @param job The job.
+ * @post The caller is not in the critical section of #_parallel_mutex.
+ */
+static void FinishParallelJob(ParallelJob *job)
+{
+	while (job->next_range < job->ranges) {
+		uint first, last;
+		TakeParallelRange(_parallel_queue.FindIndex(job), &first, &last);
+		_parallel_mutex->EndCritical();
+
+		job->proc(job->param, first, last);
+
+		_parallel_mutex->BeginCritical();
+		job->pending--;
+	}
+
+	if (_parallel_waiting) {
+		/* Only one thread can wait for a signal; this should be rare, so just poll. */
+		while (job->pending != 0) {
+			_parallel_mutex->EndCritical();
+			CSleep(1);
+			_parallel_mutex->BeginCritical();
+		}
+		_parallel_mutex->EndCritical();
+		return;
+	}
+	_parallel_waiting = true;
+	_parallel_mutex->EndCritical();
+
+	_parallel_done_mutex->BeginCritical();
+	for (;;) {
+		_parallel_mutex->BeginCritical();
+		bool done = job->pending == 0;
+		if (done) _parallel_waiting = false;
+		_parallel_mutex->EndCritical();
+		if (done) break;
+
+		_parallel_done_mutex->WaitForSignal();
+	}
+	_parallel_done_mutex->EndCritical();
+}
+
+/**
+ * Divide work over the worker threads and wait till all of it has been done.
+ * The items are divided in consecutive ranges, so the work on one item must
+ * not depend on the work on any other item. The calling thread works on the
+ * ranges as well. The worker threads are started on first use and kept
+ * around for later calls. When they cannot be started, or another thread
+ * is already waiting for its work, all work is done by the calling thread.
+ * @param proc      The function doing the work on a range of items.
+ * @param param     The parameter to pass to \a proc.
+ * @param count     The number of items to work on.
+ * @param min_items The minimum number of items worth handing to another thread.
+ */
+void RunParallel(ParallelWorkProc proc, void *param, uint count, uint min_items)
+{
+	if (count == 0) return;
+
+	uint threads = Clamp(count / max(min_items, 1U), 1U, GetWorkerThreadCount());
+	if (threads == 1 || _parallel_disabled) {
+		proc(param, 0, count);
+		return;
+	}
+
+	_parallel_mutex->BeginCritical();
+	StartWorkerThreads(GetWorkerThreadCount() - 1);
+	if (_parallel_threads == 0 || _parallel_waiting) {
+		_parallel_mutex->EndCritical();
+		proc(param, 0, count);
+		return;
+	}
+
+	ParallelJob job;
+	QueueParallelJob(&job, proc, param, count, threads, true);
+	FinishParallelJob(&job);
+}
+
+/**
+ * Divide work over the worker threads without waiting for it; see
+ * #RunParallel for the division. Use #IsParallelJobDone to find out when
+ * all work has been done. When no worker threads can be started, all
+ * work is done by the calling thread before returning.
+ * @param job       The job; it must be kept until all work has been done.
+ * @param proc      The function doing the work on a range of items.
+ * @param param     The parameter to pass to \a proc.
+ * @param count     The number of items to work on.
+ * @param min_items The minimum number of items worth handing to another thread.
+ */
+void StartParallel(ParallelJob *job, ParallelWorkProc proc, void *param, uint count, uint min_items)
+{
+	if (_parallel_disabled) {
+		job->ranges = 0;
+		job->next_range = 0;
+		job->pending = 0;
+		if (count != 0) proc(param, 0, count);
+		return;
+	}
+
+	_parallel_mutex->BeginCritical();
+	StartWorkerThreads(GetWorkerThreadCount() - 1);
+	if (_parallel_threads == 0 || count == 0) {
+		_parallel_mutex->EndCritical();
+		job->ranges = 0;
+		job->next_range = 0;
+		job->pending = 0;
+		if (count != 0) proc(param, 0, count);
+		return;
+	}
+
+	uint threads = Clamp(count / max(min_items, 1U), 1U, _parallel_threads);
+	QueueParallelJob(job, proc, param, count, threads, false);
+	_parallel_mutex->EndCritical();
+}
+
+/**
+ * Check whether all work of a job started by #StartParallel has been done.
+ * @param job The job.
+ * @return True when the job is done, or was never started.
+ */
+bool IsParallelJobDone(const ParallelJob *job)
+{
+	if (_parallel_disabled) return true;
+
+	ThreadMutexLocker lock(_parallel_mutex);
+	return job->pending == 0;
+}
+
+/**
+ * Wait till all work of a job started by #StartParallel has been done.
+ * The calling thread works on the ranges that have not been taken yet.
+ * @param job The job.
+ */
+void WaitForParallelJob(ParallelJob *job)
+{
+	if (_parallel_disabled) return;
+
+	_parallel_mutex->BeginCritical();
+	FinishParallelJob(job);
+}
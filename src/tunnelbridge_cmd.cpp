@@ -539,6 +539,12 @@ CommandCost CmdBuildBridge(TileIndex end_tile, DoCommandFlag flags, uint32 p1, u
 		Track track = AxisToTrack(direction);
 		AddSideToSignalBuffer(tile_start, INVALID_DIAGDIR, company);
 		YapfNotifyTrackLayoutChange(tile_start, track);
+		YapfNotifyTrackLayoutChange(tile_end, track);
+	}
+
+	if ((flags & DC_EXEC) && transport_type == TRANSPORT_ROAD) {
+		YapfNotifyRoadLayoutChange(tile_start);
+		YapfNotifyRoadLayoutChange(tile_end);
 	}
 
 	/* for human player that builds the bridge he gets a selection to choose from bridges (DC_QUERY_COST)
@@ -724,6 +730,7 @@ CommandCost CmdBuildTunnel(TileIndex start_tile, DoCommandFlag flags, uint32 p1,
 			MakeRailTunnel(end_tile,   company, ReverseDiagDir(direction), railtype);
 			AddSideToSignalBuffer(start_tile, INVALID_DIAGDIR, company);
 			YapfNotifyTrackLayoutChange(start_tile, DiagDirToDiagTrack(direction));
+			YapfNotifyTrackLayoutChange(end_tile, DiagDirToDiagTrack(direction));
 		} else {
 			if (c != NULL) {
 				RoadType rt;
@@ -733,6 +740,8 @@ CommandCost CmdBuildTunnel(TileIndex start_tile, DoCommandFlag flags, uint32 p1,
 			}
 			MakeRoadTunnel(start_tile, company, direction,                 rts);
 			MakeRoadTunnel(end_tile,   company, ReverseDiagDir(direction), rts);
+			YapfNotifyRoadLayoutChange(start_tile);
+			YapfNotifyRoadLayoutChange(end_tile);
 		}
 		DirtyCompanyInfrastructureWindows(company);
 	}
@@ -865,6 +874,9 @@ static CommandCost DoClearTunnel(TileIndex tile, DoCommandFlag flags)
 
 			DoClearSquare(tile);
 			DoClearSquare(endtile);
+
+			YapfNotifyRoadLayoutChange(tile);
+			YapfNotifyRoadLayoutChange(endtile);
 		}
 	}
 	return CommandCost(EXPENSES_CONSTRUCTION, _price[PR_CLEAR_TUNNEL] * len);
@@ -961,6 +973,9 @@ static CommandCost DoClearBridge(TileIndex tile, DoCommandFlag flags)
 			YapfNotifyTrackLayoutChange(endtile, track);
 
 			if (v != NULL) TryPathReserve(v, true);
+		} else {
+			YapfNotifyRoadLayoutChange(tile);
+			YapfNotifyRoadLayoutChange(endtile);
 		}
 	}
 
@@ -107,6 +107,7 @@ static inline void SetTunnelBridgeReservation(TileIndex t, bool b)
 {
 	assert(IsTileType(t, MP_TUNNELBRIDGE));
 	assert(GetTunnelBridgeTransportType(t) == TRANSPORT_RAIL);
+	_rail_state_epoch++;
 	SB(_m[t].m5, 4, 1, b ? 1 : 0);
 }
 
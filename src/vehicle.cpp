@@ -341,32 +341,56 @@ byte VehicleRandomBits()
 	return GB(Random(), 0, 8);
 }
 
-/* Size of the hash, 6 = 64 x 64, 7 = 128 x 128. Larger sizes will (in theory) reduce hash
- * lookup times at the expense of memory usage. */
-const int HASH_BITS = 7;
-const int HASH_SIZE = 1 << HASH_BITS;
-const int HASH_MASK = HASH_SIZE - 1;
-const int TOTAL_HASH_SIZE = 1 << (HASH_BITS * 2);
-const int TOTAL_HASH_MASK = TOTAL_HASH_SIZE - 1;
-
-/* Resolution of the hash, 0 = 1*1 tile, 1 = 2*2 tiles, 2 = 4*4 tiles, etc.
- * Profiling results show that 0 is fastest. */
-const int HASH_RES = 0;
-
-static Vehicle *_vehicle_tile_hash[TOTAL_HASH_SIZE];
-
-static Vehicle *VehicleFromTileHash(int xl, int yl, int xu, int yu, void *data, VehicleFromPosProc *proc, bool find_first)
-{
-	for (int y = yl; ; y = (y + (1 << HASH_BITS)) & (HASH_MASK << HASH_BITS)) {
-		for (int x = xl; ; x = (x + 1) & HASH_MASK) {
-			Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-			for (; v != NULL; v = v->hash_tile_next) {
+/*
+ * Vehicles are hashed on the tile they are on, in a grid of buckets that is
+ * scaled to the map but holds at most 1 << VEHICLE_TILE_HASH_MAX_BITS buckets.
+ * Maps that fit get a bucket for every tile, so looking up the vehicles on a
+ * tile only visits the vehicles on that tile. Larger maps are folded onto the
+ * grid, like the old fixed 128x128 hash, so the memory use stays bounded.
+ */
+static const uint VEHICLE_TILE_HASH_MAX_BITS = 16; ///< Log2 of the maximum number of buckets of the tile hash.
+
+static Vehicle **_vehicle_tile_hash = NULL; ///< First vehicle of every bucket of the tile hash.
+static uint _vehicle_tile_hash_size = 0;    ///< Number of buckets of the tile hash.
+static uint _vehicle_tile_hash_log_x;       ///< Log2 of the number of buckets along the X axis.
+static uint _vehicle_tile_hash_log_y;       ///< Log2 of the number of buckets along the Y axis.
+VehicleTileHashStats _vehicle_tile_hash_stats; ///< Statistics of the maintenance of the tile hash.
+
+/**
+ * Get a bucket of the tile hash.
+ * @param x X coordinate of a tile.
+ * @param y Y coordinate of a tile.
+ * @return The first vehicle of the bucket.
+ */
+static inline Vehicle **GetVehicleTileHashBucket(uint x, uint y)
+{
+	/* Masking folds large maps onto the grid; it also keeps vehicles on a tile outside the map, like disasters flying off the edge, inside the hash. */
+	return &_vehicle_tile_hash[(GB(y, 0, _vehicle_tile_hash_log_y) << _vehicle_tile_hash_log_x) + GB(x, 0, _vehicle_tile_hash_log_x)];
+}
+
+/**
+ * Get the bucket of the tile hash for a tile.
+ * @param tile The tile.
+ * @return The first vehicle of the bucket.
+ */
+static inline Vehicle **GetVehicleTileHash(TileIndex tile)
+{
+	return GetVehicleTileHashBucket(TileX(tile), TileY(tile));
+}
+
+static Vehicle *VehicleFromTileHash(uint xl, uint yl, uint xu, uint yu, void *data, VehicleFromPosProc *proc, bool find_first)
+{
+	/* Don't visit a bucket twice when the area wraps around a folded grid. */
+	xu = min(xu, xl + (1U << _vehicle_tile_hash_log_x) - 1);
+	yu = min(yu, yl + (1U << _vehicle_tile_hash_log_y) - 1);
+
+	for (uint y = yl; y <= yu; y++) {
+		for (uint x = xl; x <= xu; x++) {
+			for (Vehicle *v = *GetVehicleTileHashBucket(x, y); v != NULL; v = v->hash_tile_next) {
 				Vehicle *a = proc(v, data);
 				if (find_first && a != NULL) return a;
 			}
-			if (x == xu) break;
 		}
-		if (y == yu) break;
 	}
 
 	return NULL;
@@ -388,11 +412,11 @@ static Vehicle *VehicleFromPosXY(int x, int y, void *data, VehicleFromPosProc *p
 {
 	const int COLL_DIST = 6;
 
-	/* Hash area to scan is from xl,yl to xu,yu */
-	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
-	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
+	/* Tile area to scan is from xl,yl to xu,yu, limited to the map. */
+	uint xl = Clamp((x - COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxX());
+	uint xu = Clamp((x + COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxX());
+	uint yl = Clamp((y - COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxY());
+	uint yu = Clamp((y + COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxY());
 
 	return VehicleFromTileHash(xl, yl, xu, yu, data, proc, find_first);
 }
@@ -444,11 +468,7 @@ bool HasVehicleOnPosXY(int x, int y, void *data, VehicleFromPosProc *proc)
  */
 static Vehicle *VehicleFromPos(TileIndex tile, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	int x = GB(TileX(tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(tile), HASH_RES, HASH_BITS) << HASH_BITS;
-
-	Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-	for (; v != NULL; v = v->hash_tile_next) {
+	for (Vehicle *v = *GetVehicleTileHash(tile); v != NULL; v = v->hash_tile_next) {
 		if (v->tile != tile) continue;
 
 		Vehicle *a = proc(v, data);
@@ -588,17 +608,11 @@ CommandCost EnsureNoTrainOnTrackBits(TileIndex tile, TrackBits track_bits)
 static void UpdateVehicleTileHash(Vehicle *v, bool remove)
 {
 	Vehicle **old_hash = v->hash_tile_current;
-	Vehicle **new_hash;
-
-	if (remove) {
-		new_hash = NULL;
-	} else {
-		int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-		int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-		new_hash = &_vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-	}
+	Vehicle **new_hash = remove ? NULL : GetVehicleTileHash(v->tile);
 
+	_vehicle_tile_hash_stats.updates++;
 	if (old_hash == new_hash) return;
+	_vehicle_tile_hash_stats.moves++;
 
 	/* Remove from the old position in the hash table */
 	if (old_hash != NULL) {
@@ -646,12 +660,53 @@ static void UpdateVehicleViewportHash(Vehicle *v, int x, int y)
 	}
 }
 
+/**
+ * Empty the vehicle hashes, and scale the tile hash to the current map.
+ */
 void ResetVehicleHash()
 {
 	Vehicle *v;
 	FOR_ALL_VEHICLES(v) { v->hash_tile_current = NULL; }
 	memset(_vehicle_viewport_hash, 0, sizeof(_vehicle_viewport_hash));
-	memset(_vehicle_tile_hash, 0, sizeof(_vehicle_tile_hash));
+
+	/* Shrink the longest side of the grid until it fits. */
+	_vehicle_tile_hash_log_x = MapLogX();
+	_vehicle_tile_hash_log_y = MapLogY();
+	while (_vehicle_tile_hash_log_x + _vehicle_tile_hash_log_y > VEHICLE_TILE_HASH_MAX_BITS) {
+		if (_vehicle_tile_hash_log_x >= _vehicle_tile_hash_log_y) {
+			_vehicle_tile_hash_log_x--;
+		} else {
+			_vehicle_tile_hash_log_y--;
+		}
+	}
+
+	uint size = 1U << (_vehicle_tile_hash_log_x + _vehicle_tile_hash_log_y);
+	if (size != _vehicle_tile_hash_size) {
+		free(_vehicle_tile_hash);
+		_vehicle_tile_hash = MallocT<Vehicle *>(size);
+		_vehicle_tile_hash_size = size;
+	}
+	MemSetT(_vehicle_tile_hash, 0, size);
+	MemSetT(&_vehicle_tile_hash_stats, 0);
+}
+
+/**
+ * Get the statistics of the vehicle tile hash.
+ * @param[out] occupied Number of buckets with at least one vehicle.
+ * @param[out] longest Number of vehicles in the fullest bucket.
+ * @return Number of buckets.
+ */
+uint GetVehicleTileHashUsage(uint *occupied, uint *longest)
+{
+	*occupied = 0;
+	*longest = 0;
+	for (uint i = 0; i < _vehicle_tile_hash_size; i++) {
+		uint length = 0;
+		for (const Vehicle *v = _vehicle_tile_hash[i]; v != NULL; v = v->hash_tile_next) length++;
+		if (length != 0) (*occupied)++;
+		*longest = max(*longest, length);
+	}
+	return _vehicle_tile_hash_size;
 }
 
 void ResetVehicleColourMap()
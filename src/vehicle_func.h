@@ -40,6 +40,14 @@ bool IsValidImageIndex(uint8 image_index);
 
 typedef Vehicle *VehicleFromPosProc(Vehicle *v, void *data);
 
+/** Statistics of the maintenance of the vehicle tile hash since it was last reset. */
+struct VehicleTileHashStats {
+	uint64 updates; ///< Number of times the position of a vehicle in the hash was updated.
+	uint64 moves;   ///< Number of those updates that moved the vehicle to another bucket.
+};
+
+extern VehicleTileHashStats _vehicle_tile_hash_stats;
+
 void VehicleServiceInDepot(Vehicle *v);
 uint CountVehiclesInChain(const Vehicle *v);
 void FindVehicleOnPos(TileIndex tile, void *data, VehicleFromPosProc *proc);
@@ -53,6 +61,7 @@ void VehicleLengthChanged(const Vehicle *u);
 
 byte VehicleRandomBits();
 void ResetVehicleHash();
+uint GetVehicleTileHashUsage(uint *occupied, uint *longest);
 void ResetVehicleColourMap();
 
 byte GetBestFittingSubType(Vehicle *v_from, Vehicle *v_for, CargoID dest_cargo_type);
@@ -24,6 +24,7 @@
 #include "../network/network.h"
 #include "../core/random_func.hpp"
 #include "../core/math_func.hpp"
+#include "../cpu.h"
 #include "allegro_v.h"
 #include <allegro.h>
 
@@ -458,22 +459,14 @@ void VideoDriver_Allegro::Stop()
 	if (--_allegro_instance_count == 0) allegro_exit();
 }
 
-#if defined(UNIX) || defined(__OS2__) || defined(PSP) || defined(DOS)
-# include <sys/time.h> /* gettimeofday */
-
-static uint32 GetTime()
-{
-	struct timeval tim;
-
-	gettimeofday(&tim, NULL);
-	return tim.tv_usec / 1000 + tim.tv_sec * 1000;
-}
-#else
+/**
+ * Get the time in milliseconds.
+ * @return The time; it wraps around every 49 days.
+ */
 static uint32 GetTime()
 {
-	return GetTickCount();
+	return (uint32)(GetMicroseconds() / 1000);
 }
-#endif
 
 
 void VideoDriver_Allegro::MainLoop()
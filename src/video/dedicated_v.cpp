@@ -24,6 +24,7 @@
 #include "../company_func.h"
 #include "../core/random_func.hpp"
 #include "../saveload/saveload.h"
+#include "../cpu.h"
 #include "dedicated_v.h"
 
 #ifdef BEOS_NET_SERVER
@@ -212,14 +213,6 @@ static bool InputWaiting()
 	return select(STDIN + 1, &readfds, NULL, NULL, &tv) > 0;
 }
 
-static uint32 GetTime()
-{
-	struct timeval tim;
-
-	gettimeofday(&tim, NULL);
-	return tim.tv_usec / 1000 + tim.tv_sec * 1000;
-}
-
 #else
 
 static bool InputWaiting()
@@ -227,13 +220,17 @@ static bool InputWaiting()
 	return WaitForSingleObject(_hInputReady, 1) == WAIT_OBJECT_0;
 }
 
+#endif
+
+/**
+ * Get the time in milliseconds.
+ * @return The time; it wraps around every 49 days.
+ */
 static uint32 GetTime()
 {
-	return GetTickCount();
+	return (uint32)(GetMicroseconds() / 1000);
 }
 
-#endif
-
 static void DedicatedHandleKeyInput()
 {
 	static char input_line[1024] = "";
@@ -82,8 +82,11 @@
 #include "tilehighlight_func.h"
 #include "window_gui.h"
 #include "linkgraph/linkgraph_gui.h"
+#include "smallmap_gui.h"
 #include "viewport_sprite_sorter.h"
 #include "bridge_map.h"
+#include "spritecache.h"
+#include "core/sort_func.hpp"
 
 #include <map>
 
@@ -167,6 +170,8 @@ struct ViewportDrawer {
 	FoundationPart foundation_part;                  ///< Currently active foundation for ground sprite drawing.
 	int *last_foundation_child[FOUNDATION_PART_END]; ///< Tail of ChildSprite list of the foundations. (index into child_screen_sprites_to_draw)
 	Point foundation_offset[FOUNDATION_PART_END];    ///< Pixel offset for ground sprites on the foundations.
+
+	SmallVector<SpriteID, 256> *prefetch_sprites;    ///< When not \c NULL, only collect the sprites that would be drawn in here.
 };
 
 static void MarkViewportDirty(const ViewPort *vp, int left, int top, int right, int bottom);
@@ -178,7 +183,7 @@ static TileInfo *_cur_ti;
 bool _draw_bounding_boxes = false;
 bool _draw_dirty_blocks = false;
 uint _dirty_block_colour = 0;
-static VpSpriteSorter _vp_sprite_sorter = NULL;
+static VpSpriteSorter _vp_sprite_sorter = NULL; ///< Pairwise sprite sorter, used to check #ViewportSortParentSprites.
 
 static Point MapXYZToViewport(const ViewPort *vp, int x, int y, int z)
 {
@@ -528,6 +533,11 @@ static void AddTileSpriteToDraw(SpriteID image, PaletteID pal, int32 x, int32 y,
 {
 	assert((image & SPRITE_MASK) < MAX_SPRITES);
 
+	if (_vd.prefetch_sprites != NULL) {
+		*_vd.prefetch_sprites->Append() = image & SPRITE_MASK;
+		return;
+	}
+
 	TileSpriteToDraw *ts = _vd.tile_sprites_to_draw.Append();
 	ts->image = image;
 	ts->pal = pal;
@@ -697,6 +707,11 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 		pal = PALETTE_TO_TRANSPARENT;
 	}
 
+	if (_vd.prefetch_sprites != NULL) {
+		*_vd.prefetch_sprites->Append() = image & SPRITE_MASK;
+		return;
+	}
+
 	if (_vd.combine_sprites == SPRITE_COMBINE_ACTIVE) {
 		AddCombinedSprite(image, pal, x, y, z, sub);
 		return;
@@ -844,6 +859,11 @@ void AddChildSpriteScreen(SpriteID image, PaletteID pal, int x, int y, bool tran
 {
 	assert((image & SPRITE_MASK) < MAX_SPRITES);
 
+	if (_vd.prefetch_sprites != NULL) {
+		*_vd.prefetch_sprites->Append() = image & SPRITE_MASK;
+		return;
+	}
+
 	/* If the ParentSprite was clipped by the viewport bounds, do not draw the ChildSprites either */
 	if (_vd.last_child == NULL) return;
 
@@ -1200,7 +1220,7 @@ static void ViewportAddLandscape()
 				_vd.last_foundation_child[1] = NULL;
 
 				_tile_type_procs[tile_type]->draw_tile_proc(&tile_info);
-				if (tile_info.tile != INVALID_TILE) DrawTileSelection(&tile_info);
+				if (tile_info.tile != INVALID_TILE && _vd.prefetch_sprites == NULL) DrawTileSelection(&tile_info);
 			}
 		}
 	}
@@ -1370,13 +1390,163 @@ static void ViewportDrawTileSprites(const TileSpriteToDrawVector *tstdv)
 }
 
 /** This fallback sprite checker always exists. */
-static bool ViewportSortParentSpritesChecker()
+static bool ViewportSortParentSpritesPairwiseChecker()
 {
 	return true;
 }
 
-/** Sort parent sprites pointer array */
+static const uint32 PARENT_SPRITE_ORDER_COMPARED = UINT32_MAX;     ///< #ParentSpriteToDraw::order of a sprite whose preceding sprites are known.
+static const uint32 PARENT_SPRITE_ORDER_DONE     = UINT32_MAX - 1; ///< #ParentSpriteToDraw::order of a sprite that has been put in its final place.
+
+/** Sort parent sprites by the sum of the minimal X and Y coordinate of their bounding box. */
+static int CDECL ParentSpriteMinXYSorter(ParentSpriteToDraw * const *a, ParentSpriteToDraw * const *b)
+{
+	return ((*a)->xmin + (*a)->ymin) - ((*b)->xmin + (*b)->ymin);
+}
+
+/** Sort parent sprites by the order in which they are to be examined. */
+static int CDECL ParentSpriteOrderSorter(ParentSpriteToDraw * const *a, ParentSpriteToDraw * const *b)
+{
+	if ((*a)->order == (*b)->order) return 0;
+	return (*a)->order < (*b)->order ? -1 : 1;
+}
+
+/**
+ * Sort parent sprites pointer array.
+ * Like the pairwise sorters, the sprites are examined in order and the sprites
+ * that have to be drawn before the examined sprite are moved in front of it.
+ * Instead of comparing with all other sprites, only the sprites that are not
+ * examined yet and whose bounding box starts before the examined bounding box
+ * ends are considered; those are found in a list sorted by xmin + ymin.
+ * The sprites that still need to be examined are kept on a stack, as they
+ * are mostly in the right order already.
+ * @param psdv The sprites to sort.
+ */
 static void ViewportSortParentSprites(ParentSpriteToSortVector *psdv)
+{
+	uint count = psdv->Length();
+	if (count < 2) return;
+
+	/* The sprites to examine; the top of the stack is the next one. A sprite
+	 * can be on the stack multiple times, only the topmost one counts. */
+	SmallVector<ParentSpriteToDraw *, 64> stack;
+	uint32 next_order = 0;
+	for (ParentSpriteToDraw **psd = psdv->End(); psd != psdv->Begin();) {
+		ParentSpriteToDraw *ps = *--psd;
+		ps->order = next_order++;
+		*stack.Append() = ps;
+	}
+
+	/* The sprites that have not been examined yet, sorted by xmin + ymin and
+	 * linked by next. Index count is both the head and the end of the list. */
+	ParentSpriteToDraw **list = MallocT<ParentSpriteToDraw *>(count);
+	MemCpyT(list, psdv->Begin(), count);
+	QSortT(list, count, &ParentSpriteMinXYSorter);
+	uint *next = MallocT<uint>(count + 1);
+	for (uint i = 0; i < count; i++) next[i] = i + 1;
+	next[count] = 0;
+
+	SmallVector<ParentSpriteToDraw *, 16> preceding;
+	ParentSpriteToDraw **out = psdv->Begin();
+	while (stack.Length() != 0) {
+		ParentSpriteToDraw *ps = *(stack.End() - 1);
+		stack.Resize(stack.Length() - 1);
+
+		if (ps->order == PARENT_SPRITE_ORDER_DONE) continue;
+		if (ps->order == PARENT_SPRITE_ORDER_COMPARED) {
+			ps->order = PARENT_SPRITE_ORDER_DONE;
+			*out++ = ps;
+			continue;
+		}
+
+		/* Only sprites with xmin <= ps->xmax and ymin <= ps->ymax can be drawn before ps.
+		 * The bounding box of a sprite can be inverted, so use the largest coordinates to
+		 * make sure ps itself is found and removed from the list. */
+		int max_xy = max(ps->xmax, ps->xmin) + max(ps->ymax, ps->ymin);
+		uint preceding_prev = count;
+		preceding.Clear();
+		for (uint prev = count, i = next[count]; i != count && list[i]->xmin + list[i]->ymin <= max_xy;) {
+			ParentSpriteToDraw *ps2 = list[i];
+			if (ps2 == ps) {
+				next[prev] = next[i];
+				i = next[i];
+				continue;
+			}
+
+			uint ps2_prev = prev;
+			prev = i;
+			i = next[i];
+
+			/* Same decision as the pairwise sorters; see ViewportSortParentSpritesPairwise. */
+			if (ps->xmax < ps2->xmin || ps->ymax < ps2->ymin || ps->zmax < ps2->zmin) continue;
+			if (ps->xmin <= ps2->xmax && ps->ymin <= ps2->ymax && ps->zmin <= ps2->zmax &&
+					ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax <=
+					ps2->xmin + ps2->xmax + ps2->ymin + ps2->ymax + ps2->zmin + ps2->zmax) {
+				continue;
+			}
+
+			*preceding.Append() = ps2;
+			preceding_prev = ps2_prev;
+		}
+
+		if (preceding.Length() == 0) {
+			ps->order = PARENT_SPRITE_ORDER_DONE;
+			*out++ = ps;
+			continue;
+		}
+
+		if (preceding.Length() == 1) {
+			/* When no other sprite can be drawn before the single preceding sprite, draw both right away. */
+			ParentSpriteToDraw *ps2 = preceding[0];
+			if (ps2->xmax <= ps->xmax && ps2->ymax <= ps->ymax && ps2->zmax <= ps->zmax) {
+				next[preceding_prev] = next[next[preceding_prev]];
+				ps2->order = PARENT_SPRITE_ORDER_DONE;
+				ps->order = PARENT_SPRITE_ORDER_DONE;
+				*out++ = ps2;
+				*out++ = ps;
+				continue;
+			}
+		}
+
+		/* Examine the preceding sprites first, moving them in front in the same order as the pairwise sorters do. */
+		QSortT(preceding.Begin(), preceding.Length(), &ParentSpriteOrderSorter, true);
+		ps->order = PARENT_SPRITE_ORDER_COMPARED;
+		*stack.Append() = ps;
+		for (ParentSpriteToDraw **psd = preceding.Begin(); psd != preceding.End(); psd++) {
+			(*psd)->order = next_order++;
+			*stack.Append() = *psd;
+		}
+	}
+	assert(out == psdv->End());
+
+	free(next);
+	free(list);
+}
+
+/**
+ * Sort parent sprites pointer array, and check the result against the pairwise sorter.
+ * Differences are only expected for sprites whose bounding boxes do not give a definite order.
+ * @param psdv The sprites to sort.
+ */
+static void ViewportSortAndCheckParentSprites(ParentSpriteToSortVector *psdv)
+{
+	ParentSpriteToSortVector reference;
+	reference.Assign(*psdv);
+
+	ViewportSortParentSprites(psdv);
+
+	for (ParentSpriteToDraw **psd = reference.Begin(); psd != reference.End(); psd++) (*psd)->comparison_done = false;
+	_vp_sprite_sorter(&reference);
+
+	uint differences = 0;
+	for (uint i = 0; i < psdv->Length(); i++) {
+		if ((*psdv)[i] != reference[i]) differences++;
+	}
+	if (differences != 0) DEBUG(sprite, 5, "Spatial sprite sorter differs from pairwise sorter at %u of %u parent sprites", differences, psdv->Length());
+}
+
+/** Sort parent sprites pointer array by comparing every pair of sprites. */
+static void ViewportSortParentSpritesPairwise(ParentSpriteToSortVector *psdv)
 {
 	ParentSpriteToDraw **psdvend = psdv->End();
 	ParentSpriteToDraw **psd = psdv->Begin();
@@ -1567,7 +1737,11 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 		*_vd.parent_sprites_to_sort.Append() = it;
 	}
 
-	_vp_sprite_sorter(&_vd.parent_sprites_to_sort);
+	if (_debug_sprite_level >= 5) {
+		ViewportSortAndCheckParentSprites(&_vd.parent_sprites_to_sort);
+	} else {
+		ViewportSortParentSprites(&_vd.parent_sprites_to_sort);
+	}
 	ViewportDrawParentSprites(&_vd.parent_sprites_to_sort, &_vd.child_screen_sprites_to_draw);
 
 	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&_vd.parent_sprites_to_sort);
@@ -1780,6 +1954,62 @@ static inline void ClampViewportToMap(const ViewPort *vp, int &x, int &y)
 	y -= vp->virtual_height / 2;
 }
 
+/**
+ * Queue the sprites of the area around a viewport for loading into the
+ * sprite cache, so they are ready before the viewport is scrolled or zoomed
+ * out to them. The area extends half the size of the viewport beyond each
+ * edge, and is determined again once the viewport has moved a quarter of
+ * its size towards an edge of the area.
+ * @param vp The viewport.
+ */
+static void ViewportPrefetchSprites(const ViewPort *vp)
+{
+	static Rect area;
+	static ZoomLevel area_zoom = ZOOM_LVL_END;
+
+	/* Further out the area covers so many tiles that finding their sprites costs more than loading them when needed. */
+	if (vp->zoom > ZOOM_LVL_DETAIL) return;
+
+	int margin_x = vp->virtual_width / 2;
+	int margin_y = vp->virtual_height / 2;
+	if (vp->zoom == area_zoom &&
+			vp->virtual_left - margin_x / 2 >= area.left &&
+			vp->virtual_top - margin_y / 2 >= area.top &&
+			vp->virtual_left + vp->virtual_width + margin_x / 2 <= area.right &&
+			vp->virtual_top + vp->virtual_height + margin_y / 2 <= area.bottom) {
+		return;
+	}
+
+	area.left = vp->virtual_left - margin_x;
+	area.top = vp->virtual_top - margin_y;
+	area.right = vp->virtual_left + vp->virtual_width + margin_x;
+	area.bottom = vp->virtual_top + vp->virtual_height + margin_y;
+	area_zoom = vp->zoom;
+
+	/* Run the tile drawing procedures over the area, but only collect the sprites. */
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_cur_dpi = &_vd.dpi;
+
+	int mask = ScaleByZoom(-1, vp->zoom);
+	_vd.dpi.zoom = vp->zoom;
+	_vd.dpi.left = area.left & mask;
+	_vd.dpi.top = area.top & mask;
+	_vd.dpi.width = (area.right - area.left) & mask;
+	_vd.dpi.height = (area.bottom - area.top) & mask;
+	_vd.dpi.dst_ptr = NULL;
+	_vd.combine_sprites = SPRITE_COMBINE_NONE;
+	_vd.last_child = NULL;
+
+	SmallVector<SpriteID, 256> sprites;
+	_vd.prefetch_sprites = &sprites;
+	ViewportAddLandscape();
+	_vd.prefetch_sprites = NULL;
+
+	_cur_dpi = old_dpi;
+
+	QueueSpritePrefetch(sprites.Begin(), sprites.Length());
+}
+
 /**
  * Update the viewport position being displayed.
  * @param w %Window owning the viewport.
@@ -1822,6 +2052,11 @@ void UpdateViewportPosition(Window *w)
 		SetViewportPosition(w, w->viewport->scrollpos_x, w->viewport->scrollpos_y);
 		if (update_overlay) RebuildViewportOverlay(w);
 	}
+
+	if (w->window_class == WC_MAIN_WINDOW && _settings_client.gui.sprite_prefetch) {
+		ViewportPrefetchSprites(w->viewport);
+		ProcessSpritePrefetch();
+	}
 }
 
 /**
@@ -1909,6 +2144,7 @@ void MarkTileDirtyByTile(TileIndex tile, int bridge_level_offset)
 			pt.y - MAX_TILE_EXTENT_TOP - ZOOM_LVL_BASE * TILE_HEIGHT * bridge_level_offset,
 			pt.x + MAX_TILE_EXTENT_RIGHT,
 			pt.y + MAX_TILE_EXTENT_BOTTOM);
+	MarkSmallMapTileDirty(tile);
 }
 
 /**
@@ -3236,10 +3472,10 @@ static ViewportSSCSS _vp_sprite_sorters[] = {
 #ifdef WITH_SSE
 	{ &ViewportSortParentSpritesSSE41Checker, &ViewportSortParentSpritesSSE41 },
 #endif
-	{ &ViewportSortParentSpritesChecker, &ViewportSortParentSprites }
+	{ &ViewportSortParentSpritesPairwiseChecker, &ViewportSortParentSpritesPairwise }
 };
 
-/** Choose the "best" sprite sorter and set _vp_sprite_sorter. */
+/** Choose the "best" pairwise sprite sorter and set _vp_sprite_sorter. */
 void InitializeSpriteSorter()
 {
 	for (uint i = 0; i < lengthof(_vp_sprite_sorters); i++) {
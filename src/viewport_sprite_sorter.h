@@ -38,7 +38,10 @@ struct ParentSpriteToDraw {
 	int32 top;                      ///< minimal screen Y coordinate of sprite (= y + sprite->y_offs), reference point for child sprites
 
 	int first_child;                ///< the first child to draw.
-	bool comparison_done;           ///< Used during sprite sorting: true if sprite has been compared with all other sprites
+	union {
+		bool comparison_done;       ///< Used during pairwise sprite sorting: true if sprite has been compared with all other sprites
+		uint32 order;               ///< Used during spatial sprite sorting: position in the order of examination
+	};
 };
 
 typedef SmallVector<ParentSpriteToDraw*, 64> ParentSpriteToSortVector;